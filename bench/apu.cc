@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "../src/nes.h"
+
+/* APU cost per emulated frame with all four tone channels sounding, including the blip output */
+static void BM_APUFrame(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    unique_ptr<APU> apu(new APU(*cpu));
+    int16_t samples[MAX_SAMPLES_PER_FRAME];
+
+    apu->write_register(APU_STATUS, STATUS_PULSE1 | STATUS_PULSE2 | STATUS_TRIANGLE | STATUS_NOISE);
+    apu->write_register(APU_PULSE1, 0xBF);
+    apu->write_register(APU_PULSE1 + 2, 0xFD);
+    apu->write_register(APU_PULSE1 + 3, 0x00);
+    apu->write_register(APU_PULSE2, 0x7F);
+    apu->write_register(APU_PULSE2 + 2, 0x7E);
+    apu->write_register(APU_PULSE2 + 3, 0x00);
+    apu->write_register(APU_TRIANGLE, 0xFF);
+    apu->write_register(APU_TRIANGLE + 2, 0xFD);
+    apu->write_register(APU_TRIANGLE + 3, 0x00);
+    apu->write_register(APU_NOISE, 0x38);
+    apu->write_register(APU_NOISE + 2, 0x04);
+    apu->write_register(APU_NOISE + 3, 0x00);
+
+    for (auto _ : state) {
+        cpu->set_cycles(cpu->get_cycles() + 29781);
+        apu->end_frame();
+        benchmark::DoNotOptimize(apu->read_samples(samples, MAX_SAMPLES_PER_FRAME));
+    }
+}
+BENCHMARK(BM_APUFrame)->Unit(benchmark::kMicrosecond);
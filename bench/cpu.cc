@@ -0,0 +1,236 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/counters.h"
+#include "../src/debugger.h"
+#include "../src/profiler.h"
+#include "fixtures.h"
+
+enum DebugSetup {
+    DEBUG_NONE,             // No debugger
+    DEBUG_IDLE,             // Debugger attached, nothing set
+    DEBUG_WATCH_ELSEWHERE,  // A watchpoint on a page the loop never touches
+    DEBUG_BREAK_ELSEWHERE   // A breakpoint on a page the loop never runs: the checking loop
+};
+
+/* Cycles the CPU runs in one NTSC frame */
+const uint64_t FRAME_CYCLES = 29781;
+
+/* A CPU at $0300, in a loop copying page $04 to page $05 forever */
+static unique_ptr<CPU> loop_cpu()
+{
+    unique_ptr<CPU> cpu(new CPU());
+    load_program(*cpu, 0x0300, {
+        0xBD, 0x00, 0x04,   // LDA $0400,X
+        0x9D, 0x00, 0x05,   // STA $0500,X
+        0xE8,               // INX
+        0xD0, 0xF7,         // BNE -9
+        0x4C, 0x00, 0x03    // JMP $0300
+    });
+    return cpu;
+}
+
+/* Instructions per second of a load/store/branch loop with debugging compiled in */
+static void BM_CpuRun(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu = loop_cpu();
+    unique_ptr<Debugger> debugger(new Debugger(*cpu));
+
+    switch (state.range(0)) {
+        case DEBUG_NONE:
+            debugger.reset();
+            break;
+        case DEBUG_WATCH_ELSEWHERE:
+            debugger->add_watchpoint(0x0700);
+            break;
+        case DEBUG_BREAK_ELSEWHERE:
+            debugger->add_breakpoint(0x0700);
+            break;
+    }
+
+    for (auto _ : state)
+        cpu->run(cpu->get_cycles() + FRAME_CYCLES);
+
+    state.counters["cycles/s"] = benchmark::Counter(state.iterations() * FRAME_CYCLES, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_CpuRun)->DenseRange(DEBUG_NONE, DEBUG_BREAK_ELSEWHERE)->Unit(benchmark::kMicrosecond);
+
+/* One frame's worth of cycles untraced (0), traced raw (1) and traced as text (2), lossless */
+static void BM_TraceFrame(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu = loop_cpu();
+
+    unique_ptr<Tracer> tracer;
+    if (state.range(0))
+        tracer.reset(new Tracer("/dev/null", state.range(0) == 1 ? TRACE_RAW : TRACE_TEXT, true));
+    cpu->set_tracer(tracer.get());
+
+    for (auto _ : state)
+        cpu->run(cpu->get_cycles() + FRAME_CYCLES);
+
+    if (tracer) {
+        tracer->close();
+        state.counters["records"] = tracer->get_written();
+    }
+}
+BENCHMARK(BM_TraceFrame)->DenseRange(0, 2)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+/* One frame's worth of cycles without (0) and with (1) execution counters */
+static void BM_CountFrame(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu = loop_cpu();
+    ExecCounters counters;
+    cpu->set_counters(state.range(0) ? &counters : nullptr);
+
+    for (auto _ : state)
+        cpu->run(cpu->get_cycles() + FRAME_CYCLES);
+
+    state.counters["cycles/s"] = benchmark::Counter(state.iterations() * FRAME_CYCLES, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_CountFrame)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+
+/* One frame's worth of cycles of a call-heavy loop without (0) and with (1) the profiler */
+static void BM_ProfileFrame(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    Profiler profiler;
+    const vector<uint8_t> program = {
+        0x20, 0x00, 0x04,   // JSR $0400
+        0x4C, 0x00, 0x03    // JMP $0300
+    };
+    const vector<uint8_t> routine = {
+        0xBD, 0x00, 0x04,   // LDA $0400,X
+        0x9D, 0x00, 0x05,   // STA $0500,X
+        0xE8,               // INX
+        0xD0, 0xF7,         // BNE -9
+        0x60                // RTS
+    };
+
+    load_program(*cpu, 0x0300, program);
+    load_program(*cpu, 0x0400, routine);
+    cpu->set_pc(0x0300);
+    cpu->set_profiler(state.range(0) ? &profiler : nullptr);
+
+    for (auto _ : state)
+        cpu->run(cpu->get_cycles() + FRAME_CYCLES);
+
+    state.counters["cycles/s"] = benchmark::Counter(state.iterations() * FRAME_CYCLES, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ProfileFrame)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+
+/* Operands for the exec() benchmarks: $0400 absolute, $00 zero page pointing at $0400 */
+static unique_ptr<CPU> exec_cpu()
+{
+    unique_ptr<CPU> cpu(new CPU());
+    cpu->set_mem8(0x0301, 0x00);
+    cpu->set_mem8(0x0302, 0x04);
+    cpu->set_mem16(0x0000, 0x0400);
+    return cpu;
+}
+
+/* Decode, address resolution and dispatch of one official opcode through CPU::exec */
+static void BM_Exec(benchmark::State& state, uint8_t opcode)
+{
+    unique_ptr<CPU> cpu = exec_cpu();
+
+    for (auto _ : state) {
+        cpu->set_pc(0x0300);
+        cpu->exec(opcode);
+    }
+
+    benchmark::DoNotOptimize(cpu->get_a());
+}
+
+static bool register_exec_benchmarks()
+{
+    const char* hex = "0123456789ABCDEF";
+
+    for (size_t opcode = 0; opcode < NUM_OPCODES; opcode++) {
+        if (MAPPING_MODES[opcode] == NO_MAP)
+            continue;
+
+        string name = string("BM_Exec/") + hex[opcode >> 4] + hex[opcode & 0xF] + "_" + MNEMONICS[opcode];
+        benchmark::RegisterBenchmark(name.c_str(), BM_Exec, (uint8_t) opcode);
+    }
+
+    return true;
+}
+static bool exec_benchmarks = register_exec_benchmarks();
+
+/* A cheap instruction per addressing mode, so what differs is the address resolution */
+const uint8_t MODE_OPCODES[NO_MAP] = {
+    0xB5,   // ZERO_X:      LDA $00,X
+    0xB6,   // ZERO_Y:      LDX $00,Y
+    0xBD,   // ABSOLUTE_X:  LDA $0400,X
+    0xB9,   // ABSOLUTE_Y:  LDA $0400,Y
+    0xA1,   // INDIRECT_X:  LDA ($00,X)
+    0xB1,   // INDIRECT_Y:  LDA ($00),Y
+    0xEA,   // IMPLICIT:    NOP
+    0x0A,   // ACCUMULATOR: ASL A
+    0xA9,   // IMMEDIATE:   LDA #$00
+    0xA5,   // ZERO:        LDA $00
+    0xAD,   // ABSOLUTE:    LDA $0400
+    0xF0,   // RELATIVE:    BEQ, not taken
+    0x6C    // INDIRECT:    JMP ($0400)
+};
+
+static void BM_AddressMode(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu = exec_cpu();
+    uint8_t opcode = MODE_OPCODES[state.range(0)];
+
+    for (auto _ : state) {
+        cpu->set_pc(0x0300);
+        cpu->set_p(FLAG_UNUSED);
+        cpu->exec(opcode);
+    }
+
+    state.SetLabel(MODE_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_AddressMode)->DenseRange(ZERO_X, INDIRECT);
+
+static void BM_HandleFlags(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    uint8_t val = 0;
+
+    for (auto _ : state)
+        cpu->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, val++);
+
+    benchmark::DoNotOptimize(cpu->get_p());
+}
+BENCHMARK(BM_HandleFlags);
+
+/* Two pushes and the matching 16-bit pull, as JSR/RTS do */
+static void BM_PushPull(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    uint16_t sum = 0;
+
+    for (auto _ : state) {
+        cpu->push8(0x12);
+        cpu->push8(0x34);
+        sum += cpu->pull16();
+    }
+
+    benchmark::DoNotOptimize(sum);
+}
+BENCHMARK(BM_PushPull);
+
+static void BM_GetMem16(benchmark::State& state)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    size_t addr = 0;
+    uint16_t sum = 0;
+
+    for (auto _ : state) {
+        sum += cpu->get_mem16(addr);
+        addr = (addr + 1) & (RAM_SIZE - 1);
+    }
+
+    benchmark::DoNotOptimize(sum);
+}
+BENCHMARK(BM_GetMem16);
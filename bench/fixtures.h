@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../src/nes.h"
+
+using namespace std;
+
+const char* const SMB_ROM_PATH = "rom/Super Mario Bros (E).nes";
+
+/* A fresh console with rom loaded, run headless for frames frames */
+inline unique_ptr<NES> boot_rom(ROM& rom, unsigned frames = 0)
+{
+    unique_ptr<NES> nes(new NES());
+    nes->load(rom);
+
+    for (unsigned i = 0; i < frames; i++)
+        nes->emulate_frame(false, false);
+
+    return nes;
+}
+
+inline unique_ptr<NES> boot_smb(unsigned frames = 0)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    return boot_rom(rom, frames);
+}
+
+/* Super Mario Bros. a second past power-on through run_frame(), with rendering forced on first if render */
+inline unique_ptr<NES> warm_smb(bool render)
+{
+    unique_ptr<NES> nes = boot_smb();
+    if (render)
+        nes->get_ppu().write_register(PPUMASK, MASK_BG | MASK_SPRITES);
+
+    for (size_t i = 0; i < 60; i++)
+        nes->run_frame();
+
+    return nes;
+}
+
+/* Copies program to addr and points the CPU at it */
+inline void load_program(CPU& cpu, uint16_t addr, const vector<uint8_t>& program)
+{
+    for (size_t i = 0; i < program.size(); i++)
+        cpu.set_mem8(addr + i, program[i]);
+    cpu.set_pc(addr);
+}
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/frontend.h"
+#include "../src/timeline.h"
+
+/*
+ * Frame completion in the core to availability in another process: the child blocks on the
+ * frame eventfd and reports how long after present_target() it saw the frame. Rendering is not
+ * timed, only the hand-off, so the target is filled with a memset standing in for the PPU.
+ */
+static void BM_FrontendLatency(benchmark::State& state)
+{
+    FrontendServer server;
+    int results[2];
+
+    if (!server.is_open() || pipe(results) < 0) {
+        state.SkipWithError("could not set up the frontend");
+        return;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        close(results[0]);
+        FrontendClient client(dup(server.get_memory_fd()), dup(server.get_frame_fd()));
+
+        for (;;) {
+            const SharedFrame* frame = client.wait_frame(-1);
+            uint64_t latency = Timeline::now() - frame->published_ns;
+
+            if (frame->frame == UINT64_MAX || write(results[1], &latency, sizeof(latency)) < 0)
+                _exit(0);
+        }
+    }
+    close(results[1]);
+
+    uint64_t frame = 0;
+    uint64_t total = 0;
+    uint64_t worst = 0;
+
+    for (auto _ : state) {
+        memset(server.next_target(), (int) frame, FRAME_PIXELS);
+        server.present_target(frame++);
+
+        uint64_t latency;
+        if (read(results[0], &latency, sizeof(latency)) != sizeof(latency)) {
+            state.SkipWithError("frontend process went away");
+            break;
+        }
+
+        total += latency;
+        worst = max(worst, latency);
+    }
+
+    server.present_target(UINT64_MAX);
+    waitpid(child, nullptr, 0);
+    close(results[0]);
+
+    state.counters["mean_us"] = frame ? total / 1e3 / frame : 0;
+    state.counters["max_us"] = worst / 1e3;
+}
+BENCHMARK(BM_FrontendLatency)->UseRealTime()->Unit(benchmark::kMicrosecond);
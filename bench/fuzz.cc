@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "../src/fuzz.h"
+#include "fixtures.h"
+
+/* Stores all over RAM and cartridge RAM, then spins: the kind of input a fuzzer throws in */
+static const vector<uint8_t> FUZZ_CODE = {
+    0xA9, 0x42,         // LDA #$42
+    0x8D, 0x00, 0x03,   // STA $0300
+    0x8D, 0x00, 0x07,   // STA $0700
+    0x8D, 0x00, 0x60,   // STA $6000
+    0x20, 0x10, 0x02,   // JSR $0210
+    0x4C, 0x0E, 0x02,   // JMP $020E
+    0x60                // $0210: RTS
+};
+
+enum FuzzSetup {
+    FUZZ_FRESH_CPU,         // A CPU constructed per input, no coverage
+    FUZZ_PERSISTENT,        // The harness without coverage: what the dirty-page reset costs
+    FUZZ_COVERAGE           // The harness with edge coverage
+};
+
+/* Execs per second of a short input running FUZZ_CPU_CYCLES */
+static void BM_FuzzCpu(benchmark::State& state)
+{
+    vector<uint8_t> coverage(COVERAGE_MAP_SIZE);
+    FuzzHarness harness(state.range(0) == FUZZ_COVERAGE ? coverage.data() : nullptr);
+
+    for (auto _ : state) {
+        if (state.range(0) != FUZZ_FRESH_CPU) {
+            harness.run(FUZZ_CODE.data(), FUZZ_CODE.size());
+            continue;
+        }
+
+        unique_ptr<CPU> cpu(new CPU());
+        for (size_t i = 0; i < FUZZ_CODE.size(); i++)
+            cpu->write8(FUZZ_CODE_ADDR + i, FUZZ_CODE[i]);
+        cpu->set_pc(FUZZ_CODE_ADDR);
+        cpu->run(FUZZ_CPU_CYCLES);
+        benchmark::DoNotOptimize(cpu->get_a());
+    }
+
+    state.counters["execs/s"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_FuzzCpu)->DenseRange(FUZZ_FRESH_CPU, FUZZ_COVERAGE)->Unit(benchmark::kMicrosecond);
+
+/* Eight frames of input from a full load_state() (0) and from the harness's dirty pages (1), no coverage */
+static void BM_FuzzInput(benchmark::State& state)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    const vector<uint8_t> input = { 0, BUTTON_START, 0, 0, BUTTON_RIGHT, BUTTON_RIGHT, BUTTON_A, 0 };
+    FuzzHarness harness(rom, 60, nullptr);
+    unique_ptr<NES> nes = boot_rom(rom, 60);
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+
+    nes->save_state(*snap);
+
+    for (auto _ : state) {
+        if (state.range(0)) {
+            harness.run(input.data(), input.size());
+            continue;
+        }
+
+        nes->load_state(*snap);
+        for (uint8_t buttons : input) {
+            nes->get_controllers().set_buttons(0, buttons);
+            nes->emulate_frame(false, false);
+        }
+    }
+
+    state.counters["execs/s"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+    state.counters["dirty_pages"] = harness.get_dirty_count();
+}
+BENCHMARK(BM_FuzzInput)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
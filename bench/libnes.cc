@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+
+#include "../src/libnes.h"
+
+/* Reading the 2KB of work RAM in one call, or one byte per call as value getters make FFI do */
+static void BM_ReadRam(benchmark::State& state)
+{
+    nes_t* nes = nes_create("rom/Super Mario Bros (E).nes");
+    uint8_t ram[0x800];
+    size_t chunk = state.range(0);
+
+    for (auto _ : state) {
+        for (size_t addr = 0; addr < sizeof(ram); addr += chunk)
+            nes_read_memory(nes, (uint16_t) addr, ram + addr, chunk);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * sizeof(ram));
+    nes_destroy(nes);
+}
+BENCHMARK(BM_ReadRam)->Arg(1)->Arg(0x800);
+
+static void BM_SaveLoadStateBuffer(benchmark::State& state)
+{
+    nes_t* nes = nes_create("rom/Super Mario Bros (E).nes");
+    size_t size = nes_state_size();
+    uint64_t* buffer = new uint64_t[(size + 7) / 8];
+
+    for (auto _ : state) {
+        nes_save_state(nes, buffer, size);
+        nes_load_state(nes, buffer, size);
+    }
+
+    delete[] buffer;
+    nes_destroy(nes);
+}
+BENCHMARK(BM_SaveLoadStateBuffer);
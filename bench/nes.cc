@@ -0,0 +1,128 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include <sys/resource.h>
+
+#include "../src/counters.h"
+#include "../src/nes.h"
+#include "../src/telemetry.h"
+#include "fixtures.h"
+
+/* One save plus one load, the fixed part of run-ahead's cost */
+static void BM_SaveLoadState(benchmark::State& state)
+{
+    unique_ptr<NES> nes = warm_smb(true);
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+
+    for (auto _ : state) {
+        nes->save_state(*snap);
+        nes->load_state(*snap);
+    }
+}
+BENCHMARK(BM_SaveLoadState);
+
+/* Wall-clock time per host frame running N frames ahead, inline (0) or on a second instance (1) */
+static void BM_RunAhead(benchmark::State& state)
+{
+    unique_ptr<NES> nes = warm_smb(true);
+    nes->set_run_ahead(state.range(0), state.range(1) ? RUN_AHEAD_THREADED : RUN_AHEAD_INLINE);
+
+    for (auto _ : state)
+        nes->run_frame();
+
+    nes->sync_run_ahead();
+}
+BENCHMARK(BM_RunAhead)
+    ->ArgsProduct({ { 0, 1, 2, 3, 4 }, { 0, 1 } })
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+/* A rollback of N frames: load the state, re-run N frames without video or audio */
+static void BM_Rollback(benchmark::State& state)
+{
+    unique_ptr<NES> nes = warm_smb(true);
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    nes->save_state(*snap);
+
+    for (auto _ : state) {
+        nes->load_state(*snap);
+        for (int64_t i = 0; i < state.range(0); i++)
+            nes->emulate_frame(false, false);
+    }
+}
+BENCHMARK(BM_Rollback)->DenseRange(1, 8)->Unit(benchmark::kMicrosecond);
+
+/* One frame without (0) and with (1) a timeline; the timeline is emptied outside the timing */
+static void BM_TimelineFrame(benchmark::State& state)
+{
+    unique_ptr<NES> nes = warm_smb(true);
+    unique_ptr<Timeline> timeline;
+
+    for (auto _ : state) {
+        if (state.range(0) && (!timeline || timeline->get_event_count() > DEFAULT_TIMELINE_CAPACITY / 2)) {
+            state.PauseTiming();
+            timeline.reset(new Timeline());
+            nes->set_timeline(timeline.get());
+            state.ResumeTiming();
+        }
+
+        nes->run_frame();
+    }
+
+    nes->set_timeline(nullptr);
+}
+BENCHMARK(BM_TimelineFrame)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+
+const size_t THROUGHPUT_FRAMES = 1200;
+
+/*
+ * Power on and THROUGHPUT_FRAMES frames of attract mode, headless. Emulation is deterministic,
+ * so instructions are counted on an untimed run first. scripts/bench-gate.sh compares these
+ * counters with bench/throughput.baseline.
+ */
+static void BM_Throughput(benchmark::State& state)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    unique_ptr<NES> counted = boot_rom(rom);
+    ExecCounters counters;
+
+    counted->get_cpu().set_counters(&counters);
+    for (size_t i = 0; i < THROUGHPUT_FRAMES; i++)
+        counted->run_frame();
+    counted->get_cpu().set_counters(nullptr);
+
+    uint64_t cycles = counted->get_cpu().get_cycles();
+    uint64_t instructions = counters.get_total().count;
+    counted.reset();
+
+    for (auto _ : state) {
+        unique_ptr<NES> nes = boot_rom(rom);
+
+        for (size_t i = 0; i < THROUGHPUT_FRAMES; i++)
+            nes->run_frame();
+
+        benchmark::DoNotOptimize(nes->get_cpu().get_cycles());
+    }
+
+    /* ru_maxrss is process-wide: peak_rss_mb is this benchmark's own only when it runs alone, as under bench-gate */
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    state.counters["cpu_mhz"] = benchmark::Counter(state.iterations() * cycles / 1e6, benchmark::Counter::kIsRate);
+    state.counters["fps"] = benchmark::Counter(state.iterations() * THROUGHPUT_FRAMES, benchmark::Counter::kIsRate);
+    state.counters["ips"] = benchmark::Counter(state.iterations() * instructions, benchmark::Counter::kIsRate);
+    state.counters["peak_rss_mb"] = usage.ru_maxrss / 1024.0;
+}
+BENCHMARK(BM_Throughput)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/* One telemetry publish without (0) and with (1) the RAM copy; the frame itself is not timed */
+static void BM_TelemetryPublish(benchmark::State& state)
+{
+    unique_ptr<NES> nes = warm_smb(true);
+    Telemetry telemetry("bench", state.range(0) ? 1 : 0);
+
+    for (auto _ : state)
+        telemetry.publish(*nes, 800000);
+}
+BENCHMARK(BM_TelemetryPublish)->DenseRange(0, 1);
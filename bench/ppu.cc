@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "../src/nes.h"
+#include "fixtures.h"
+
+/* Cost of the render thread's share of a frame: replaying a log into pixels */
+static void BM_RenderFrame(benchmark::State& state)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    unique_ptr<NES> nes = boot_rom(rom);
+
+    unique_ptr<Renderer> renderer(new Renderer());
+    unique_ptr<FrameLog> log(new FrameLog());
+    renderer->set_cartridge(rom.get_chr_rom().data(), MIRROR_VERTICAL);
+    log->start = nes->get_ppu().get_state();
+    log->start.mask = MASK_BG | MASK_SPRITES | MASK_BG_LEFT | MASK_SPRITES_LEFT;
+
+    for (size_t i = 0; i < OAM_SIZE; i++)
+        log->start.oam[i] = i * 37;
+
+    for (size_t i = 0; i < VRAM_SIZE; i++)
+        log->start.vram[i] = i * 13;
+
+    for (uint32_t line = 0; line < VISIBLE_LINES; line += 16)
+        log->entries.push_back({ (line + 1) * DOTS_PER_LINE, LOG_WRITE, PPUSCROLL, (uint8_t) line });
+
+    for (auto _ : state) {
+        renderer->render(*log);
+        benchmark::DoNotOptimize(renderer->get_frame_buffer());
+    }
+}
+BENCHMARK(BM_RenderFrame)->Unit(benchmark::kMicrosecond);
+
+/* Wall-clock time per emulated frame with the PPU rendered inline (0) or pipelined on a thread (1) */
+static void BM_RunFrame(benchmark::State& state)
+{
+    unique_ptr<NES> nes = boot_smb();
+    nes->get_cpu().set_pc(nes->get_cpu().get_mem16(0xFFFC));
+    nes->get_ppu().set_render_mode(state.range(0) ? RENDER_THREADED : RENDER_INLINE);
+    nes->get_ppu().write_register(PPUMASK, MASK_BG | MASK_SPRITES);
+
+    for (auto _ : state)
+        nes->run_frame();
+
+    nes->get_ppu().sync();
+    state.counters["skipped"] = nes->get_ppu().get_skipped_frames();
+}
+BENCHMARK(BM_RunFrame)->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+/* One $4014 write: bulk page copy into OAM plus the render log entry */
+static void BM_OamDma(benchmark::State& state)
+{
+    unique_ptr<NES> nes(new NES());
+    CPU& cpu = nes->get_cpu();
+
+    nes->get_ppu().begin_frame();
+
+    for (auto _ : state) {
+        cpu.write8(OAM_DMA_REG, 0x02);
+        state.PauseTiming();
+        nes->get_ppu().begin_frame(); // Keep the log from growing without bound
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_OamDma);
@@ -0,0 +1,20 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "../src/resampler.h"
+
+/* One frame's worth of APU output (96 kHz) converted to the host rate */
+static void BM_ResampleFrame(benchmark::State& state)
+{
+    Resampler resampler(96000.0, state.range(0));
+    vector<int16_t> in(1608);
+    vector<int16_t> out(2048);
+
+    for (size_t i = 0; i < in.size(); i++)
+        in[i] = (int16_t) (i * 97);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(resampler.process(in.data(), in.size(), out.data(), out.size()));
+}
+BENCHMARK(BM_ResampleFrame)->Arg(44100)->Arg(48000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,32 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "../src/rom.h"
+
+/* Header check alone: an iNES image with no PRG or CHR pages */
+static void BM_RomHeader(benchmark::State& state)
+{
+    const char* path = "/tmp/nes-bench-header.nes";
+    const char header[16] = { 'N', 'E', 'S', 0x1A };
+    ofstream(path, ios::binary).write(header, sizeof(header));
+
+    for (auto _ : state) {
+        ROM rom(path);
+        benchmark::DoNotOptimize(rom.is_valid());
+    }
+
+    remove(path);
+}
+BENCHMARK(BM_RomHeader);
+
+/* Header and 40 KB of PRG/CHR data */
+static void BM_RomLoad(benchmark::State& state)
+{
+    for (auto _ : state) {
+        ROM rom("rom/Super Mario Bros (E).nes");
+        benchmark::DoNotOptimize(rom.get_prg_rom().data());
+    }
+}
+BENCHMARK(BM_RomLoad)->Unit(benchmark::kMicrosecond);
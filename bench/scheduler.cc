@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/nes.h"
+#include "../src/scheduler.h"
+#include "fixtures.h"
+
+/*
+ * Sessions per core: boots SMB sessions at the PAL frame rate on one worker until admission
+ * control refuses one, then hosts them all for two seconds and reports what that cost in misses
+ * and lateness. The first session runs alone briefly so there is a measured cost to go on.
+ */
+static void BM_HostedSessions(benchmark::State& state)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+
+    for (auto _ : state) {
+        vector<unique_ptr<NES>> consoles;
+        SessionScheduler scheduler(state.range(0));
+
+        for (;;) {
+            unique_ptr<NES> nes = boot_rom(rom);
+
+            NES* console = nes.get();
+            if (scheduler.add_session([console] { console->run_frame(); }, PAL_FRAME_NS) < 0)
+                break;
+
+            consoles.push_back(move(nes));
+            if (consoles.size() == 1)
+                this_thread::sleep_for(chrono::milliseconds(200));
+        }
+
+        SchedulerStats before = scheduler.get_stats();
+        this_thread::sleep_for(chrono::seconds(2));
+        SchedulerStats after = scheduler.get_stats();
+
+        state.counters["sessions"] = consoles.size();
+        state.counters["utilization"] = scheduler.get_utilization();
+        state.counters["miss_pct"] = 100.0 * (after.misses - before.misses) / max(after.frames - before.frames, (uint64_t) 1);
+        state.counters["lateness_p99_ms"] = after.lateness_p99_ns / 1e6;
+        state.counters["lateness_max_ms"] = after.lateness_max_ns / 1e6;
+    }
+}
+BENCHMARK(BM_HostedSessions)->Arg(1)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "../src/search.h"
+#include "fixtures.h"
+
+/* Hash of the whole machine: the per-state cost deduplication adds to a search */
+static void BM_HashState(benchmark::State& state)
+{
+    unique_ptr<NES> nes = warm_smb(false);
+    uint64_t h = 0;
+
+    for (auto _ : state)
+        h ^= nes->hash_state();
+
+    benchmark::DoNotOptimize(h);
+}
+BENCHMARK(BM_HashState);
+
+/* A four-level beam search over the default inputs, one frame per step, on 0 or 1 extra threads */
+static void BM_StateSearch(benchmark::State& state)
+{
+    unique_ptr<NES> nes = warm_smb(false);
+    SearchConfig config;
+    config.frames_per_step = 1;
+    config.depth = 4;
+    config.beam_width = 32;
+    config.threads = state.range(0);
+    uint64_t explored = 0;
+    uint64_t duplicates = 0;
+
+    /* Mario's X position on screen */
+    StateSearch search(*nes, config, [](NES& n) { return (double) n.get_cpu().read8(0x0086); });
+
+    for (auto _ : state) {
+        SearchResult result = search.run();
+        explored += result.explored;
+        duplicates += result.duplicates;
+    }
+
+    state.counters["states/s"] = benchmark::Counter(explored, benchmark::Counter::kIsRate);
+    state.counters["dup_pct"] = 100.0 * duplicates / explored;
+}
+BENCHMARK(BM_StateSearch)->DenseRange(0, 1)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <memory>
+
+#include "../src/state_file.h"
+#include "fixtures.h"
+
+/*
+ * Restoring a console from a state file already in the page cache: the mapped snapshot loaded
+ * in place (0), read() into a snapshot, one bulk copy (1), and read() of a compressed file (2)
+ */
+static void BM_StateFileLoad(benchmark::State& state)
+{
+    const char* path = "/tmp/nes-bench-state.nst";
+    unique_ptr<NES> nes = boot_smb(60);
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+
+    nes->save_state(*snap);
+    write_state_file(path, *snap, state.range(0) == 2 ? COMPRESS_ALL : COMPRESS_NONE);
+
+    StateFile file(path);
+
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            nes->load_state(*file.get_snapshot());
+            continue;
+        }
+
+        file.read(*snap);
+        nes->load_state(*snap);
+    }
+
+    state.SetBytesProcessed(state.iterations() * sizeof(NESSnapshot));
+    state.counters["file_bytes"] = file.get_header().file_size;
+    remove(path);
+}
+BENCHMARK(BM_StateFileLoad)->DenseRange(0, 2);
+
+/* validate() of an uncompressed (0) and a compressed (1) file: hashing and decoding every section */
+static void BM_StateFileValidate(benchmark::State& state)
+{
+    const char* path = "/tmp/nes-bench-validate.nst";
+    unique_ptr<NES> nes = boot_smb();
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+
+    nes->save_state(*snap);
+    write_state_file(path, *snap, state.range(0) ? COMPRESS_ALL : COMPRESS_NONE);
+
+    StateFile file(path);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(file.validate());
+
+    state.SetBytesProcessed(state.iterations() * sizeof(NESSnapshot));
+    remove(path);
+}
+BENCHMARK(BM_StateFileValidate)->DenseRange(0, 1);
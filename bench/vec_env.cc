@@ -0,0 +1,31 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <vector>
+
+#include "../src/vec_env.h"
+#include "fixtures.h"
+
+/* One batched step of N environments on every core, frame skip 4, with (1) or without (0) observations */
+static void BM_VecEnvStep(benchmark::State& state)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    VecEnvConfig config;
+    config.start_frames = 60;
+    config.max_episode_frames = 600;
+    config.threads = max(thread::hardware_concurrency(), 1u) - 1;
+    VecEnv env(rom, state.range(0), config);
+
+    size_t n = env.size();
+    vector<uint8_t> actions(n, BUTTON_RIGHT);
+    vector<uint8_t> obs(n * ENV_OBSERVATION_SIZE);
+    vector<uint8_t> ram(n * ENV_RAM_SIZE);
+    vector<uint8_t> dones(n);
+
+    for (auto _ : state)
+        env.step(actions.data(), state.range(1) ? obs.data() : nullptr, ram.data(), dones.data());
+
+    state.counters["steps/s"] = benchmark::Counter(state.iterations() * n, benchmark::Counter::kIsRate);
+    state.counters["frames/s"] = benchmark::Counter(state.iterations() * n * config.frame_skip, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_VecEnvStep)->ArgsProduct({ { 16, 64 }, { 0, 1 } })->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "../src/video.h"
+
+static vector<uint8_t> make_frame()
+{
+    vector<uint8_t> frame(FRAME_PIXELS);
+
+    for (size_t i = 0; i < FRAME_PIXELS; i++)
+        frame[i] = (i * 7 + i / FRAME_WIDTH) & PALETTE_INDEX_MASK;
+
+    return frame;
+}
+
+/* Per-frame cost of the post-process stage. Args: output scale, worker threads */
+static void BM_ConvertRGBA(benchmark::State& state)
+{
+    vector<uint8_t> frame = make_frame();
+    VideoConverter converter(state.range(0), FILTER_NONE, 0);
+    vector<uint32_t> out(converter.get_width() * converter.get_height());
+
+    for (auto _ : state) {
+        converter.convert(frame.data(), out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_ConvertRGBA)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+static void BM_ConvertNTSC(benchmark::State& state)
+{
+    vector<uint8_t> frame = make_frame();
+    VideoConverter converter(state.range(0), FILTER_NTSC, state.range(1));
+    vector<uint32_t> out(converter.get_width() * converter.get_height());
+    unsigned phase = 0;
+
+    for (auto _ : state) {
+        converter.convert(frame.data(), out.data(), phase);
+        phase ^= 4;
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_ConvertNTSC)
+    ->ArgsProduct({ { 1, 2 }, { 0, 1, 3 } })
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+/* What the emulation thread pays per frame to hand a finished frame to the post-process stage */
+static void BM_PostProcessorSubmit(benchmark::State& state)
+{
+    vector<uint8_t> frame = make_frame();
+    PostProcessor post(state.range(0), FILTER_NTSC, 0, PostProcessor::Sink());
+
+    for (auto _ : state)
+        post.submit(frame.data());
+
+    post.flush();
+    state.counters["dropped"] = post.get_dropped();
+}
+BENCHMARK(BM_PostProcessorSubmit)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# Runs BM_Throughput in the optimised configuration and fails if fps, cpu_mhz or ips fell more
+# than MAX_REGRESSION percent (default 10) below bench/throughput.baseline. With --update the
+# baseline is rewritten from this run instead.
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+RESET='\033[0m'
+
+BASELINE='bench/throughput.baseline'
+RESULTS='bin/nes-throughput.json'
+COUNTERS='fps cpu_mhz ips'
+MAX_REGRESSION=${MAX_REGRESSION:-10}
+
+run_benchmark() {
+	make bench BENCH_OUTPUT=${RESULTS} BENCH_ARGS='--benchmark_filter=^BM_Throughput' || exit 1
+}
+
+# Value of a counter in the Google Benchmark JSON output
+measured() {
+	sed -n "s/^ *\"$1\": \([-+.0-9eE]*\),\{0,1\}$/\1/p" ${RESULTS} | head -n 1
+}
+
+baseline() {
+	sed -n "s/^$1 \([-+.0-9eE]*\)$/\1/p" ${BASELINE}
+}
+
+update_baseline() {
+	echo "# BM_Throughput reference results; refresh with scripts/bench-gate.sh --update" > ${BASELINE}
+	for counter in ${COUNTERS}; do
+		echo "${counter} $(measured ${counter})" >> ${BASELINE}
+	done
+	echo "${GREEN}Baseline updated.${RESET}"
+}
+
+check_baseline() {
+	failed=0
+
+	for counter in ${COUNTERS}; do
+		if ! awk -v now="$(measured ${counter})" -v base="$(baseline ${counter})" -v max="${MAX_REGRESSION}" \
+			-v name="${counter}" 'BEGIN {
+				change = (now - base) * 100 / base
+				printf "%-8s %14.2f  baseline %14.2f  %+6.1f%%\n", name, now, base, change
+				exit change < -max
+			}'
+		then
+			failed=1
+		fi
+	done
+
+	if [ ${failed} -ne 0 ]; then
+		echo "${RED}Throughput dropped more than ${MAX_REGRESSION}% below the baseline.${RESET}"
+		exit 1
+	fi
+
+	echo "${GREEN}Throughput is within ${MAX_REGRESSION}% of the baseline.${RESET}"
+}
+
+main() {
+	run_benchmark
+
+	if [ "$1" = '--update' ]; then
+		update_baseline
+	else
+		check_baseline
+	fi
+}
+
+main "$@"
@@ -0,0 +1,549 @@
+#include "apu.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "state_hash.h"
+
+const float APU_OUTPUT_GAIN = 30000.0f;
+const uint16_t SWEEP_MAX_PERIOD = 0x7FF;
+const uint16_t DMC_SAMPLE_BASE = 0xC000;
+
+/* Runs a timer with the given reload period for elapsed cycles, returns how often it expired */
+static uint64_t advance_timer(uint32_t& timer, uint32_t period, uint64_t elapsed)
+{
+    if (elapsed < timer) {
+        timer -= elapsed;
+        return 0;
+    }
+
+    elapsed -= timer;
+    timer = period - elapsed % period;
+    return 1 + elapsed / period;
+}
+
+static void clock_envelope(Envelope& env)
+{
+    if (env.start) {
+        env.start = false;
+        env.decay = 15;
+        env.divider = env.period;
+    } else if (env.divider == 0) {
+        env.divider = env.period;
+        if (env.decay > 0)
+            env.decay--;
+        else if (env.loop)
+            env.decay = 15;
+    } else {
+        env.divider--;
+    }
+}
+
+static uint8_t envelope_volume(const Envelope& env)
+{
+    return env.constant ? env.period : env.decay;
+}
+
+APU::APU(CPU& cpu, double sample_rate) :
+    cpu(cpu),
+    blip(CPU_CLOCK_RATE, sample_rate, MAX_SAMPLES_PER_FRAME)
+{
+    this->pulse_table[0] = 0.0f;
+    for (size_t n = 1; n < 31; n++)
+        this->pulse_table[n] = 95.52f / (8128.0f / n + 100.0f);
+
+    this->tnd_table[0] = 0.0f;
+    for (size_t n = 1; n < 203; n++)
+        this->tnd_table[n] = 163.67f / (24329.0f / n + 100.0f);
+
+    this->reset();
+}
+
+void APU::reset()
+{
+    memset(&this->state, 0, sizeof(this->state));
+
+    for (PulseState& p : this->state.pulse)
+        p.timer = this->pulse_period(p);
+
+    this->state.triangle.timer = 1;
+    this->state.noise.shift = 1;
+    this->state.noise.period = NOISE_PERIODS[0];
+    this->state.noise.timer = NOISE_PERIODS[0];
+    this->state.dmc.silence = true;
+    this->state.dmc.bits = 8;
+    this->state.dmc.period = DMC_PERIODS[0];
+    this->state.dmc.timer = DMC_PERIODS[0];
+
+    this->state.time = this->cpu.get_cycles();
+    this->state.sequence_start = this->state.time;
+    this->frame_start = this->state.time;
+    this->amplitude = this->mix();
+}
+
+uint32_t APU::pulse_period(const PulseState& p)
+{
+    return (p.period + 1) * 2; // Pulse timers run on the APU clock, every other CPU cycle
+}
+
+uint16_t APU::sweep_target(const PulseState& p, bool ones_complement)
+{
+    int change = p.period >> p.sweep_shift;
+
+    if (p.sweep_negate)
+        return (uint16_t) max(0, p.period - change - (ones_complement ? 1 : 0));
+
+    return p.period + change;
+}
+
+bool APU::pulse_muted(const PulseState& p)
+{
+    return p.period < 8 || (!p.sweep_negate && this->sweep_target(p, false) > SWEEP_MAX_PERIOD);
+}
+
+void APU::clock_sweep(PulseState& p, bool ones_complement)
+{
+    if (p.sweep_divider == 0 && p.sweep_enabled && p.sweep_shift > 0 && !this->pulse_muted(p))
+        p.period = this->sweep_target(p, ones_complement);
+
+    if (p.sweep_divider == 0 || p.sweep_reload) {
+        p.sweep_divider = p.sweep_period;
+        p.sweep_reload = false;
+    } else {
+        p.sweep_divider--;
+    }
+}
+
+void APU::dmc_restart()
+{
+    this->state.dmc.addr = this->state.dmc.sample_addr;
+    this->state.dmc.remaining = this->state.dmc.sample_length;
+}
+
+void APU::dmc_step()
+{
+    DMCState& d = this->state.dmc;
+
+    if (!d.silence) {
+        if (d.shift & 1) {
+            if (d.level <= 125)
+                d.level += 2;
+        } else if (d.level >= 2) {
+            d.level -= 2;
+        }
+    }
+
+    d.shift >>= 1;
+
+    if (--d.bits > 0)
+        return;
+
+    d.bits = 8;
+
+    if (d.remaining == 0) {
+        d.silence = true;
+        return;
+    }
+
+    /* Sample fetches go straight to the bus; the CPU stall they cause is not modelled */
+    d.shift = this->cpu.read8(d.addr);
+    d.addr = (d.addr == 0xFFFF) ? 0x8000 : d.addr + 1;
+    d.silence = false;
+
+    if (--d.remaining == 0) {
+        if (d.loop)
+            this->dmc_restart();
+        else if (d.irq_enabled)
+            this->state.dmc_irq = true;
+    }
+}
+
+float APU::mix()
+{
+    const APUState& s = this->state;
+    uint8_t pulse = 0;
+
+    for (const PulseState& p : s.pulse) {
+        if (p.length > 0 && !this->pulse_muted(p) && ((DUTY_TABLE[p.duty] >> p.step) & 1))
+            pulse += envelope_volume(p.envelope);
+    }
+
+    uint8_t triangle = TRIANGLE_TABLE[s.triangle.step];
+    uint8_t noise = (s.noise.length > 0 && !(s.noise.shift & 1)) ? envelope_volume(s.noise.envelope) : 0;
+
+    return this->pulse_table[pulse] + this->tnd_table[3 * triangle + 2 * noise + s.dmc.level];
+}
+
+void APU::update_output()
+{
+    float a = this->mix();
+
+    if (a != this->amplitude) {
+        if (!this->muted)
+            this->blip.add_delta(this->state.time - this->frame_start, a - this->amplitude);
+        this->amplitude = a;
+    }
+}
+
+void APU::run_channels(uint64_t until)
+{
+    APUState& s = this->state;
+
+    while (s.time < until) {
+        /* Only channels whose output can change need their steps visited one by one; silent
+           channels just have their timers advanced arithmetically */
+        bool pulse_active[2];
+        for (size_t i = 0; i < 2; i++) {
+            const PulseState& p = s.pulse[i];
+            pulse_active[i] = p.length > 0 && !this->pulse_muted(p) && envelope_volume(p.envelope) > 0;
+        }
+        bool triangle_active = s.triangle.length > 0 && s.triangle.linear > 0 && s.triangle.period >= 2;
+        bool noise_active = s.noise.length > 0 && envelope_volume(s.noise.envelope) > 0;
+        bool dmc_active = !s.dmc.silence || s.dmc.remaining > 0;
+
+        uint64_t next = until;
+        for (size_t i = 0; i < 2; i++) {
+            if (pulse_active[i])
+                next = min(next, s.time + s.pulse[i].timer);
+        }
+        if (triangle_active)
+            next = min(next, s.time + s.triangle.timer);
+        if (noise_active)
+            next = min(next, s.time + s.noise.timer);
+        if (dmc_active)
+            next = min(next, s.time + s.dmc.timer);
+
+        uint64_t elapsed = next - s.time;
+
+        for (PulseState& p : s.pulse) {
+            uint64_t steps = advance_timer(p.timer, this->pulse_period(p), elapsed);
+            p.step = (p.step + steps) & 7;
+        }
+
+        uint64_t steps = advance_timer(s.triangle.timer, s.triangle.period + 1, elapsed);
+        if (triangle_active)
+            s.triangle.step = (s.triangle.step + steps) & 31;
+
+        steps = advance_timer(s.noise.timer, s.noise.period, elapsed);
+        if (noise_active && steps) {
+            uint16_t feedback = (s.noise.shift ^ (s.noise.shift >> (s.noise.mode ? 6 : 1))) & 1;
+            s.noise.shift = (s.noise.shift >> 1) | (feedback << 14);
+        }
+
+        steps = advance_timer(s.dmc.timer, s.dmc.period, elapsed);
+        if (dmc_active && steps)
+            this->dmc_step();
+
+        s.time = next;
+        this->update_output();
+    }
+}
+
+void APU::clock_quarter_frame()
+{
+    APUState& s = this->state;
+
+    clock_envelope(s.pulse[0].envelope);
+    clock_envelope(s.pulse[1].envelope);
+    clock_envelope(s.noise.envelope);
+
+    if (s.triangle.linear_reload)
+        s.triangle.linear = s.triangle.linear_period;
+    else if (s.triangle.linear > 0)
+        s.triangle.linear--;
+
+    if (!s.triangle.control)
+        s.triangle.linear_reload = false;
+}
+
+void APU::clock_half_frame()
+{
+    APUState& s = this->state;
+
+    for (PulseState& p : s.pulse) {
+        if (!p.halt && p.length > 0)
+            p.length--;
+    }
+    if (!s.triangle.control && s.triangle.length > 0)
+        s.triangle.length--;
+    if (!s.noise.halt && s.noise.length > 0)
+        s.noise.length--;
+
+    this->clock_sweep(s.pulse[0], true);
+    this->clock_sweep(s.pulse[1], false);
+}
+
+void APU::clock_frame_step()
+{
+    APUState& s = this->state;
+
+    switch (s.frame_step) {
+        case 0:
+        case 2:
+            this->clock_quarter_frame();
+            break;
+        case 1:
+            this->clock_quarter_frame();
+            this->clock_half_frame();
+            break;
+        case 3:
+            if (!s.five_step) {
+                this->clock_quarter_frame();
+                this->clock_half_frame();
+                s.frame_irq |= !s.irq_inhibit;
+            }
+            break;
+        case 4:
+            if (s.five_step) {
+                this->clock_quarter_frame();
+                this->clock_half_frame();
+            } else {
+                s.frame_irq |= !s.irq_inhibit;
+            }
+            break;
+    }
+
+    if (++s.frame_step == NUM_FRAME_STEPS) {
+        s.frame_step = 0;
+        s.sequence_start += FRAME_SEQUENCE_CYCLES[s.five_step];
+    }
+
+    this->update_output();
+}
+
+void APU::run(uint64_t until)
+{
+    while (this->state.time < until) {
+        uint64_t step = this->state.sequence_start + FRAME_STEP_CYCLES[this->state.five_step][this->state.frame_step];
+
+        this->run_channels(min(until, step));
+
+        if (this->state.time == step)
+            this->clock_frame_step();
+    }
+}
+
+void APU::write_register(uint16_t addr, uint8_t val)
+{
+    this->run(this->cpu.get_cycles());
+
+    APUState& s = this->state;
+
+    switch (addr) {
+        case APU_PULSE1:
+        case APU_PULSE2: {
+            PulseState& p = s.pulse[addr == APU_PULSE2];
+            p.duty = val >> 6;
+            p.halt = p.envelope.loop = val & 0x20;
+            p.envelope.constant = val & 0x10;
+            p.envelope.period = val & 0x0F;
+            break;
+        }
+        case APU_PULSE1 + 1:
+        case APU_PULSE2 + 1: {
+            PulseState& p = s.pulse[addr == APU_PULSE2 + 1];
+            p.sweep_enabled = val & 0x80;
+            p.sweep_period = (val >> 4) & 0x07;
+            p.sweep_negate = val & 0x08;
+            p.sweep_shift = val & 0x07;
+            p.sweep_reload = true;
+            break;
+        }
+        case APU_PULSE1 + 2:
+        case APU_PULSE2 + 2: {
+            PulseState& p = s.pulse[addr == APU_PULSE2 + 2];
+            p.period = (p.period & 0x700) | val;
+            break;
+        }
+        case APU_PULSE1 + 3:
+        case APU_PULSE2 + 3: {
+            PulseState& p = s.pulse[addr == APU_PULSE2 + 3];
+            p.period = (p.period & 0xFF) | ((val & 0x07) << 8);
+            if (p.enabled)
+                p.length = LENGTH_TABLE[val >> 3];
+            p.step = 0;
+            p.envelope.start = true;
+            break;
+        }
+        case APU_TRIANGLE:
+            s.triangle.control = val & 0x80;
+            s.triangle.linear_period = val & 0x7F;
+            break;
+        case APU_TRIANGLE + 2:
+            s.triangle.period = (s.triangle.period & 0x700) | val;
+            break;
+        case APU_TRIANGLE + 3:
+            s.triangle.period = (s.triangle.period & 0xFF) | ((val & 0x07) << 8);
+            if (s.triangle.enabled)
+                s.triangle.length = LENGTH_TABLE[val >> 3];
+            s.triangle.linear_reload = true;
+            break;
+        case APU_NOISE:
+            s.noise.halt = s.noise.envelope.loop = val & 0x20;
+            s.noise.envelope.constant = val & 0x10;
+            s.noise.envelope.period = val & 0x0F;
+            break;
+        case APU_NOISE + 2:
+            s.noise.mode = val & 0x80;
+            s.noise.period = NOISE_PERIODS[val & 0x0F];
+            break;
+        case APU_NOISE + 3:
+            if (s.noise.enabled)
+                s.noise.length = LENGTH_TABLE[val >> 3];
+            s.noise.envelope.start = true;
+            break;
+        case APU_DMC:
+            s.dmc.irq_enabled = val & 0x80;
+            if (!s.dmc.irq_enabled)
+                s.dmc_irq = false;
+            s.dmc.loop = val & 0x40;
+            s.dmc.period = DMC_PERIODS[val & 0x0F];
+            break;
+        case APU_DMC + 1:
+            s.dmc.level = val & 0x7F;
+            break;
+        case APU_DMC + 2:
+            s.dmc.sample_addr = DMC_SAMPLE_BASE + val * 64;
+            break;
+        case APU_DMC + 3:
+            s.dmc.sample_length = val * 16 + 1;
+            break;
+        case APU_STATUS:
+            s.pulse[0].enabled = val & STATUS_PULSE1;
+            s.pulse[1].enabled = val & STATUS_PULSE2;
+            s.triangle.enabled = val & STATUS_TRIANGLE;
+            s.noise.enabled = val & STATUS_NOISE;
+            for (PulseState& p : s.pulse) {
+                if (!p.enabled)
+                    p.length = 0;
+            }
+            if (!s.triangle.enabled)
+                s.triangle.length = 0;
+            if (!s.noise.enabled)
+                s.noise.length = 0;
+            if (!(val & STATUS_DMC))
+                s.dmc.remaining = 0;
+            else if (s.dmc.remaining == 0)
+                this->dmc_restart();
+            s.dmc_irq = false;
+            break;
+        case APU_FRAME_COUNTER:
+            s.five_step = val & FRAME_FIVE_STEP;
+            s.irq_inhibit = val & FRAME_IRQ_INHIBIT;
+            if (s.irq_inhibit)
+                s.frame_irq = false;
+            /* The sequencer restarts a few cycles after the write; 5-step mode clocks at once */
+            s.sequence_start = s.time + 3;
+            s.frame_step = 0;
+            if (s.five_step) {
+                this->clock_quarter_frame();
+                this->clock_half_frame();
+            }
+            break;
+    }
+
+    this->update_output();
+}
+
+uint8_t APU::read_status()
+{
+    this->run(this->cpu.get_cycles());
+
+    APUState& s = this->state;
+    uint8_t status = 0;
+
+    if (s.pulse[0].length > 0)
+        status |= STATUS_PULSE1;
+    if (s.pulse[1].length > 0)
+        status |= STATUS_PULSE2;
+    if (s.triangle.length > 0)
+        status |= STATUS_TRIANGLE;
+    if (s.noise.length > 0)
+        status |= STATUS_NOISE;
+    if (s.dmc.remaining > 0)
+        status |= STATUS_DMC;
+    if (s.frame_irq)
+        status |= STATUS_FRAME_IRQ;
+    if (s.dmc_irq)
+        status |= STATUS_DMC_IRQ;
+
+    s.frame_irq = false;
+    return status;
+}
+
+size_t APU::end_frame()
+{
+    this->run(this->cpu.get_cycles());
+
+    if (!this->muted)
+        this->blip.end_frame(this->state.time - this->frame_start);
+
+    this->frame_start = this->state.time;
+    return this->muted ? 0 : this->blip.samples_avail();
+}
+
+size_t APU::read_samples(int16_t* out, size_t count)
+{
+    return this->blip.read_samples(out, count, APU_OUTPUT_GAIN);
+}
+
+bool APU::irq_pending()
+{
+    this->run(this->cpu.get_cycles());
+    return this->state.frame_irq || this->state.dmc_irq;
+}
+
+uint64_t APU::get_next_irq_cycle()
+{
+    const APUState& s = this->state;
+
+    /* Once raised, the line stays up until a register access clears it */
+    if (s.frame_irq || s.dmc_irq)
+        return NO_APU_EVENT;
+
+    uint64_t next = NO_APU_EVENT;
+
+    if (!s.five_step && !s.irq_inhibit) {
+        size_t step = max(s.frame_step, (size_t) 3);
+        next = s.sequence_start + FRAME_STEP_CYCLES[0][step];
+    }
+
+    /* The last sample byte is fetched when the shift register next runs dry after the others */
+    const DMCState& d = s.dmc;
+    if (d.irq_enabled && !d.loop && d.remaining > 0) {
+        uint64_t expiries = (d.bits - 1) + 8 * (uint64_t) (d.remaining - 1);
+        next = min(next, s.time + d.timer + expiries * d.period);
+    }
+
+    return next;
+}
+
+void APU::set_muted(bool muted)
+{
+    this->muted = muted;
+}
+
+void APU::save_state(APUSnapshot& snap)
+{
+    snap.state = this->state;
+    snap.frame_start = this->frame_start;
+    snap.amplitude = this->amplitude;
+}
+
+void APU::load_state(const APUSnapshot& snap)
+{
+    this->state = snap.state;
+    this->frame_start = snap.frame_start;
+    this->amplitude = snap.amplitude;
+}
+
+/* The state is cleared with memset and only ever copied whole, so its padding is always zero */
+uint64_t APU::hash_state(uint64_t seed)
+{
+    return hash_bytes(&this->state, sizeof(this->state), seed);
+}
+
+APUState& APU::get_state()
+{
+    return this->state;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstdint>
+
+#include "blip_buffer.h"
+#include "cpu.h"
+
+using namespace std;
+
+const double CPU_CLOCK_RATE = 1789773.0;
+const double DEFAULT_SAMPLE_RATE = 48000.0;
+const size_t MAX_SAMPLES_PER_FRAME = 4096;
+const uint64_t NO_APU_EVENT = UINT64_MAX;
+
+enum APURegister : uint16_t {
+    APU_PULSE1          = 0x4000,
+    APU_PULSE2          = 0x4004,
+    APU_TRIANGLE        = 0x4008,
+    APU_NOISE           = 0x400C,
+    APU_DMC             = 0x4010,
+    APU_STATUS          = 0x4015,
+    APU_FRAME_COUNTER   = 0x4017
+};
+
+enum APUStatusFlag : uint8_t {
+    STATUS_PULSE1       = 1 << 0,
+    STATUS_PULSE2       = 1 << 1,
+    STATUS_TRIANGLE     = 1 << 2,
+    STATUS_NOISE        = 1 << 3,
+    STATUS_DMC          = 1 << 4,
+    STATUS_FRAME_IRQ    = 1 << 6,
+    STATUS_DMC_IRQ      = 1 << 7
+};
+
+enum FrameCounterFlag : uint8_t {
+    FRAME_IRQ_INHIBIT   = 1 << 6,
+    FRAME_FIVE_STEP     = 1 << 7
+};
+
+/* Frame sequencer steps, in CPU cycles since the sequencer was last reset */
+const size_t NUM_FRAME_STEPS = 5;
+const uint32_t FRAME_STEP_CYCLES[2][NUM_FRAME_STEPS] = {
+    { 7457, 14913, 22371, 29829, 29830 },
+    { 7457, 14913, 22371, 29829, 37281 }
+};
+const uint32_t FRAME_SEQUENCE_CYCLES[2] = { 29830, 37282 };
+
+const uint8_t LENGTH_TABLE[32] = {
+    10, 254, 20,  2, 40,  4, 80,  6, 160,  8, 60, 10, 14, 12, 26, 14,
+    12,  16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+};
+
+const uint8_t DUTY_TABLE[4] = { 0x02, 0x06, 0x1E, 0xF9 };
+
+const uint8_t TRIANGLE_TABLE[32] = {
+    15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15
+};
+
+/* NTSC periods, in CPU cycles */
+const uint16_t NOISE_PERIODS[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+};
+
+const uint16_t DMC_PERIODS[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+};
+
+struct Envelope {
+    bool        start;
+    bool        loop;
+    bool        constant;
+    uint8_t     period;
+    uint8_t     divider;
+    uint8_t     decay;
+};
+
+/*
+ * Channel timers count down in CPU cycles to the next sequencer step. Everything is plain data
+ * so the whole APU can be snapshotted with one copy.
+ */
+struct PulseState {
+    bool        enabled;
+    bool        halt;
+    uint8_t     duty;
+    uint8_t     step;
+    uint8_t     length;
+    uint16_t    period;
+    uint32_t    timer;
+    Envelope    envelope;
+    bool        sweep_enabled;
+    bool        sweep_negate;
+    bool        sweep_reload;
+    uint8_t     sweep_period;
+    uint8_t     sweep_shift;
+    uint8_t     sweep_divider;
+};
+
+struct TriangleState {
+    bool        enabled;
+    bool        control;
+    bool        linear_reload;
+    uint8_t     linear_period;
+    uint8_t     linear;
+    uint8_t     step;
+    uint8_t     length;
+    uint16_t    period;
+    uint32_t    timer;
+};
+
+struct NoiseState {
+    bool        enabled;
+    bool        halt;
+    bool        mode;
+    uint8_t     length;
+    uint16_t    shift;
+    uint16_t    period;
+    uint32_t    timer;
+    Envelope    envelope;
+};
+
+struct DMCState {
+    bool        irq_enabled;
+    bool        loop;
+    bool        silence;
+    uint8_t     level;
+    uint8_t     shift;
+    uint8_t     bits;
+    uint16_t    period;
+    uint16_t    sample_addr;
+    uint16_t    sample_length;
+    uint16_t    addr;
+    uint16_t    remaining;
+    uint32_t    timer;
+};
+
+struct APUState {
+    PulseState      pulse[2];
+    TriangleState   triangle;
+    NoiseState      noise;
+    DMCState        dmc;
+    bool            five_step;
+    bool            irq_inhibit;
+    bool            frame_irq;
+    bool            dmc_irq;
+    size_t          frame_step;
+    uint64_t        sequence_start;     // CPU cycle the frame sequencer was last reset
+    uint64_t        time;               // CPU cycle the APU has been run up to
+};
+
+/* The APU's state; the blip buffer is left out, so take snapshots between output blocks */
+struct APUSnapshot {
+    APUState    state;
+    uint64_t    frame_start;
+    float       amplitude;
+};
+
+/*
+ * 2A03 sound: two pulse channels, triangle, noise, DMC and the frame counter. The APU is lazy:
+ * it only runs when one of its registers is accessed or an output block is due, and then jumps
+ * from one channel event to the next rather than ticking every cycle. Each change of the mixed
+ * output is inserted into a BlipBuffer as a band-limited step.
+ */
+class APU
+{
+private:
+    CPU&            cpu;
+    APUState        state;
+    BlipBuffer      blip;
+    uint64_t        frame_start = 0;    // CPU cycle of blip buffer time 0
+    float           amplitude = 0.0f;
+    bool            muted = false;
+    float           pulse_table[31];
+    float           tnd_table[203];
+
+    void            run(uint64_t until);
+    void            run_channels(uint64_t until);
+    void            clock_frame_step();
+    void            clock_quarter_frame();
+    void            clock_half_frame();
+    void            update_output();
+    float           mix();
+
+    uint32_t        pulse_period(const PulseState& p);
+    bool            pulse_muted(const PulseState& p);
+    uint16_t        sweep_target(const PulseState& p, bool ones_complement);
+    void            clock_sweep(PulseState& p, bool ones_complement);
+    void            dmc_step();
+    void            dmc_restart();
+
+public:
+    APU(CPU& cpu, double sample_rate = DEFAULT_SAMPLE_RATE);
+
+    void            reset();
+
+    /* Both run the APU up to the CPU's current cycle first */
+    void            write_register(uint16_t addr, uint8_t val);
+    uint8_t         read_status();
+
+    /* Catches up to the current cycle and closes the output block, returns samples available */
+    size_t          end_frame();
+    size_t          read_samples(int16_t* out, size_t count);
+
+    bool            irq_pending();
+    /* Earliest CPU cycle at which the frame counter or DMC can raise an IRQ, if none is raised */
+    uint64_t        get_next_irq_cycle();
+
+    /* While muted the APU runs as usual but produces no samples, leaving the blip buffer as is */
+    void            set_muted(bool muted);
+    void            save_state(APUSnapshot& snap);
+    void            load_state(const APUSnapshot& snap);
+    uint64_t        hash_state(uint64_t seed);
+
+    APUState&       get_state();
+};
@@ -0,0 +1,87 @@
+#include "blip_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const double BLIP_PI = 3.14159265358979323846;
+const double BLIP_CUTOFF = 0.9;         // Fraction of Nyquist kept by the step kernel
+const float BLIP_HIGH_PASS = 0.999f;    // DC blocker pole
+
+BlipBuffer::BlipBuffer(double clock_rate, double sample_rate, size_t max_samples_per_frame) :
+    factor((uint64_t) (sample_rate / clock_rate * (double) (1ULL << BLIP_FRAC_BITS))),
+    buffer(max_samples_per_frame + BLIP_WIDTH, 0.0f)
+{
+    const double half = BLIP_WIDTH / 2.0;
+
+    for (size_t p = 0; p < BLIP_PHASES; p++) {
+        double frac = (double) p / BLIP_PHASES;
+        double sum = 0.0;
+        double taps[BLIP_WIDTH];
+
+        for (size_t k = 0; k < BLIP_WIDTH; k++) {
+            double t = (double) k - half + 1.0 - frac;
+            double x = BLIP_PI * BLIP_CUTOFF * t;
+            double sinc = (t == 0.0) ? 1.0 : sin(x) / x;
+            double w = (t + half) / BLIP_WIDTH;
+            double window = (w <= 0.0 || w >= 1.0) ? 0.0
+                : 0.42 - 0.5 * cos(2.0 * BLIP_PI * w) + 0.08 * cos(4.0 * BLIP_PI * w);
+            taps[k] = sinc * window;
+            sum += taps[k];
+        }
+
+        for (size_t k = 0; k < BLIP_WIDTH; k++)
+            this->kernel[p][k] = (float) (taps[k] / sum);
+    }
+}
+
+void BlipBuffer::add_delta(uint64_t clock_time, float delta)
+{
+    uint64_t pos = this->offset + clock_time * this->factor;
+    size_t i = pos >> BLIP_FRAC_BITS;
+    size_t phase = (pos >> (BLIP_FRAC_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1);
+
+    /* A frame longer than the buffer was sized for loses its tail rather than overflowing */
+    if (i + BLIP_WIDTH > this->buffer.size())
+        return;
+
+    /* Kernel is written from sample i onwards, i.e. delayed by half its width, so no delta
+       ever reaches back into samples that end_frame() already made readable */
+    float* out = &this->buffer[i];
+    const float* k = this->kernel[phase];
+
+    for (size_t n = 0; n < BLIP_WIDTH; n++)
+        out[n] += delta * k[n];
+}
+
+void BlipBuffer::end_frame(uint64_t clock_duration)
+{
+    this->offset += clock_duration * this->factor;
+}
+
+size_t BlipBuffer::samples_avail()
+{
+    return min((size_t) (this->offset >> BLIP_FRAC_BITS), this->buffer.size() - BLIP_WIDTH);
+}
+
+size_t BlipBuffer::read_samples(int16_t* out, size_t count, float gain)
+{
+    count = min(count, this->samples_avail());
+
+    for (size_t i = 0; i < count; i++) {
+        this->integrator += this->buffer[i];
+        this->hp_out = this->integrator - this->hp_in + BLIP_HIGH_PASS * this->hp_out;
+        this->hp_in = this->integrator;
+
+        float s = this->hp_out * gain;
+        out[i] = (int16_t) max(-32768.0f, min(32767.0f, s));
+    }
+
+    /* Shift the unread samples (and pending kernel tails) down to the start */
+    size_t remaining = this->buffer.size() - count;
+    memmove(&this->buffer[0], &this->buffer[count], remaining * sizeof(float));
+    fill(this->buffer.begin() + remaining, this->buffer.end(), 0.0f);
+    this->offset -= (uint64_t) count << BLIP_FRAC_BITS;
+
+    return count;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+const unsigned BLIP_PHASE_BITS = 5;
+const size_t BLIP_PHASES = 1 << BLIP_PHASE_BITS;
+const size_t BLIP_WIDTH = 16;
+const unsigned BLIP_FRAC_BITS = 32;
+
+/*
+ * Band-limited synthesis buffer. Instead of sampling a signal, the caller reports the clock
+ * time and size of every amplitude change, and each change is added as a windowed-sinc step
+ * at its exact sub-sample position. Reading integrates the deltas back into a waveform.
+ */
+class BlipBuffer
+{
+private:
+    uint64_t        factor;         // Output samples per input clock, 32.32 fixed point
+    uint64_t        offset = 0;     // Position of clock 0 of the current frame, 32.32 fixed point
+    vector<float>   buffer;
+    float           kernel[BLIP_PHASES][BLIP_WIDTH];
+    float           integrator = 0.0f;
+    float           hp_in = 0.0f;
+    float           hp_out = 0.0f;
+
+public:
+    BlipBuffer(double clock_rate, double sample_rate, size_t max_samples_per_frame);
+
+    /* clock_time is relative to the start of the current frame */
+    void            add_delta(uint64_t clock_time, float delta);
+    /* Ends the frame after clock_duration clocks, making its samples readable */
+    void            end_frame(uint64_t clock_duration);
+    size_t          samples_avail();
+    /* Removes up to count samples, high-passed to remove DC and scaled by gain */
+    size_t          read_samples(int16_t* out, size_t count, float gain);
+};
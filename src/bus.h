@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* The CPU address space is routed in 256-byte pages */
+const size_t PAGE_SHIFT = 8;
+const size_t PAGE_SIZE = 1 << PAGE_SHIFT;
+const size_t PAGE_MASK = PAGE_SIZE - 1;
+const size_t NUM_PAGES = 0x100;
+
+/*
+ * Memory-mapped device. Pages that are not backed by plain memory are handed to the
+ * device registered for them; everything else is read and written directly.
+ */
+class IODevice
+{
+public:
+    virtual ~IODevice() {}
+
+    virtual uint8_t io_read(uint16_t addr) = 0;
+    virtual void    io_write(uint16_t addr, uint8_t val) = 0;
+};
@@ -0,0 +1,134 @@
+#include "counters.h"
+
+#include <cstring>
+#include <string>
+
+ExecCounters::ExecCounters()
+{
+    this->reset();
+}
+
+void ExecCounters::reset()
+{
+    memset(this->opcodes, 0, sizeof(this->opcodes));
+    memset(this->modes, 0, sizeof(this->modes));
+    memset(this->regions, 0, sizeof(this->regions));
+    memset(this->page_crossings, 0, sizeof(this->page_crossings));
+}
+
+const CounterEntry& ExecCounters::get_opcode(uint8_t opcode)
+{
+    return this->opcodes[opcode];
+}
+
+const CounterEntry& ExecCounters::get_mode(MappingMode mode)
+{
+    return this->modes[mode];
+}
+
+const CounterEntry& ExecCounters::get_region(MemRegion region)
+{
+    return this->regions[region];
+}
+
+const CounterEntry& ExecCounters::get_page_crossings(uint8_t opcode)
+{
+    return this->page_crossings[opcode];
+}
+
+static CounterEntry sum(const CounterEntry* entries, size_t count)
+{
+    CounterEntry total = {};
+
+    for (size_t i = 0; i < count; i++) {
+        total.count += entries[i].count;
+        total.cycles += entries[i].cycles;
+    }
+
+    return total;
+}
+
+CounterEntry ExecCounters::get_total()
+{
+    return sum(this->opcodes, NUM_OPCODES);
+}
+
+CounterEntry ExecCounters::get_total_page_crossings()
+{
+    return sum(this->page_crossings, NUM_OPCODES);
+}
+
+static string opcode_key(size_t opcode)
+{
+    const char* hex = "0123456789ABCDEF";
+    return string(MNEMONICS[opcode]) + "_" + hex[opcode >> 4] + hex[opcode & 0xF];
+}
+
+static void write_json_entry(ostream& out, bool& first, const string& key, const CounterEntry& e)
+{
+    out << (first ? "\n" : ",\n") << "    \"" << key << "\": { \"count\": " << e.count
+        << ", \"cycles\": " << e.cycles << " }";
+    first = false;
+}
+
+void ExecCounters::write_json(ostream& out)
+{
+    bool first;
+
+    out << dec << "{\n  \"opcodes\": {";
+    first = true;
+    for (size_t i = 0; i < NUM_OPCODES; i++) {
+        if (this->opcodes[i].count)
+            write_json_entry(out, first, opcode_key(i), this->opcodes[i]);
+    }
+
+    out << "\n  },\n  \"modes\": {";
+    first = true;
+    for (size_t i = 0; i < NUM_MAPPING_MODES; i++) {
+        if (this->modes[i].count)
+            write_json_entry(out, first, MODE_NAMES[i], this->modes[i]);
+    }
+
+    out << "\n  },\n  \"regions\": {";
+    first = true;
+    for (size_t i = 0; i < NUM_REGIONS; i++) {
+        if (this->regions[i].count)
+            write_json_entry(out, first, REGION_NAMES[i], this->regions[i]);
+    }
+
+    out << "\n  },\n  \"page_crossings\": {";
+    first = true;
+    for (size_t i = 0; i < NUM_OPCODES; i++) {
+        if (this->page_crossings[i].count)
+            write_json_entry(out, first, opcode_key(i), this->page_crossings[i]);
+    }
+
+    out << "\n  }\n}\n";
+}
+
+void ExecCounters::write_csv(ostream& out)
+{
+    out << dec << "kind,key,count,cycles\n";
+
+    for (size_t i = 0; i < NUM_OPCODES; i++) {
+        if (this->opcodes[i].count)
+            out << "opcode," << opcode_key(i) << "," << this->opcodes[i].count << "," << this->opcodes[i].cycles << "\n";
+    }
+
+    for (size_t i = 0; i < NUM_MAPPING_MODES; i++) {
+        if (this->modes[i].count)
+            out << "mode," << MODE_NAMES[i] << "," << this->modes[i].count << "," << this->modes[i].cycles << "\n";
+    }
+
+    for (size_t i = 0; i < NUM_REGIONS; i++) {
+        if (this->regions[i].count)
+            out << "region," << REGION_NAMES[i] << "," << this->regions[i].count << "," << this->regions[i].cycles << "\n";
+    }
+
+    for (size_t i = 0; i < NUM_OPCODES; i++) {
+        if (this->page_crossings[i].count) {
+            out << "page_crossing," << opcode_key(i) << "," << this->page_crossings[i].count << ","
+                << this->page_crossings[i].cycles << "\n";
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+#include "cpu.h"
+
+using namespace std;
+
+enum MemRegion {
+    REGION_NONE,        // No memory operand: implied, accumulator, immediate and relative
+    REGION_RAM,         // 0x0000-0x1FFF
+    REGION_PPU_REG,     // 0x2000-0x3FFF
+    REGION_APU_IO,      // 0x4000-0x401F
+    REGION_CARTRIDGE,   // 0x4020-0xFFFF
+    NUM_REGIONS
+};
+
+const char* const REGION_NAMES[NUM_REGIONS] = { "none", "ram", "ppu_reg", "apu_io_regs", "cartridge_space" };
+
+struct CounterEntry {
+    uint64_t    count;
+    uint64_t    cycles;
+};
+
+/*
+ * Execution profile of one CPU: instructions and the cycles they took, by opcode, addressing
+ * mode and the region of their operand, plus how often indexed reads paid the page penalty.
+ * Cycles include anything an instruction stalls for, such as OAM DMA.
+ */
+class ExecCounters
+{
+private:
+    CounterEntry    opcodes[NUM_OPCODES];
+    CounterEntry    modes[NUM_MAPPING_MODES];
+    CounterEntry    regions[NUM_REGIONS];
+    CounterEntry    page_crossings[NUM_OPCODES];    // cycles are the penalty cycles alone
+
+public:
+    ExecCounters();
+
+    static inline MemRegion region(const InstructionInfo& info)
+    {
+        switch (info.mode) {
+            case IMPLICIT: case ACCUMULATOR: case IMMEDIATE: case RELATIVE: case NO_MAP:
+                return REGION_NONE;
+            default:
+                break;
+        }
+
+        if (info.addr < 0x2000)
+            return REGION_RAM;
+        if (info.addr < 0x4000)
+            return REGION_PPU_REG;
+        if (info.addr < 0x4020)
+            return REGION_APU_IO;
+        return REGION_CARTRIDGE;
+    }
+
+    /* CPU side, after each instruction */
+    inline void count(const InstructionInfo& info, uint64_t cycles)
+    {
+        CounterEntry& op = this->opcodes[info.opcode];
+        op.count++;
+        op.cycles += cycles;
+
+        CounterEntry& mode = this->modes[info.mode];
+        mode.count++;
+        mode.cycles += cycles;
+
+        CounterEntry& region = this->regions[ExecCounters::region(info)];
+        region.count++;
+        region.cycles += cycles;
+
+        if (info.page_crossed && PAGE_PENALTY[info.opcode]) {
+            this->page_crossings[info.opcode].count++;
+            this->page_crossings[info.opcode].cycles += PAGE_PENALTY[info.opcode];
+        }
+    }
+
+    void                reset();
+
+    const CounterEntry& get_opcode(uint8_t opcode);
+    const CounterEntry& get_mode(MappingMode mode);
+    const CounterEntry& get_region(MemRegion region);
+    const CounterEntry& get_page_crossings(uint8_t opcode);
+    /* Totals over every opcode */
+    CounterEntry        get_total();
+    CounterEntry        get_total_page_crossings();
+
+    /* Only the opcodes, modes and regions that were hit are written */
+    void                write_json(ostream& out);
+    /* One row per counter: kind,key,count,cycles */
+    void                write_csv(ostream& out);
+};
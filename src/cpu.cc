@@ -1,4 +1,11 @@
 #include "cpu.h"
+#include "counters.h"
+#include "profiler.h"
+#include "state_hash.h"
+#include "timeline.h"
+
+#include <algorithm>
+#include <cstring>
 
 #ifdef DEBUG
     #include <iostream>
@@ -10,6 +17,9 @@ CPU::CPU()
     regs.a = regs.x = regs.y = 0;
     regs.s = 0xFD;
     this->regs.pc = 0x0000;
+    
+    memset(this->mem, 0, sizeof(this->mem));
+    this->map_memory(0x00, NUM_PAGES - 1, this->mem, true);
 }
 
 CPU::~CPU()
@@ -19,6 +29,7 @@ CPU::~CPU()
 void CPU::exec(uint8_t opcode)
 {
     uint16_t address = 0x0000;
+    uint16_t base = 0x0000;
     MappingMode mode = MAPPING_MODES[opcode];
     
     switch (mode) {
@@ -26,19 +37,26 @@ void CPU::exec(uint8_t opcode)
             address = this->get_mem16(this->regs.pc + 1);
             break;
         case ABSOLUTE_X:
-            address = this->get_mem16(this->regs.pc + 1) + this->regs.x;
+            base = this->get_mem16(this->regs.pc + 1);
+            address = base + this->regs.x;
             break;
         case ABSOLUTE_Y:
-            address = this->get_mem16(this->regs.pc + 1) + this->regs.y;
+            base = this->get_mem16(this->regs.pc + 1);
+            address = base + this->regs.y;
             break;
-        case INDIRECT:
-            //address = this->get_mem16_bug(this->get_mem16(this->regs.pc + 1));
+        case INDIRECT: {
+            /* The pointer's high byte is fetched without carrying into the next page */
+            uint16_t ptr = this->get_mem16(this->regs.pc + 1);
+            uint16_t hi = (ptr & 0xFF00) | ((ptr + 1) & 0x00FF);
+            address = this->read8(ptr) | this->read8(hi) << 8;
             break;
+        }
         case INDIRECT_X:
             address = (this->mem[this->regs.pc + 1] + this->regs.x) & 0x00FF; // Ignore carry and wrap on zero page 
             break;
         case INDIRECT_Y:
-            address = this->get_mem16(this->mem[this->regs.pc + 1]) + this->regs.y;
+            base = this->get_mem16(this->mem[this->regs.pc + 1]);
+            address = base + this->regs.y;
             break;
         case IMPLICIT:
             address = 0;
@@ -67,14 +85,210 @@ void CPU::exec(uint8_t opcode)
         }
         case NO_MAP: /* FALL THROUGH */
         default:
-            cerr << "WARNING: Hit non-standard opcode or data!\n";
+            this->nonstandard_opcode(opcode);
             break;
     };
-    this->regs.pc += INSTR_LEN[opcode];
+    
+    bool page_crossed = (mode == ABSOLUTE_X || mode == ABSOLUTE_Y || mode == INDIRECT_Y) &&
+        ((base ^ address) & 0xFF00) != 0;
+    
+    /* Non-standard opcodes are treated as one-byte, two-cycle NOPs so the clock always moves */
+    this->regs.pc += INSTR_LEN[opcode] ? INSTR_LEN[opcode] : 1;
+    this->cycles += (CYCLES[opcode] ? CYCLES[opcode] : 2) + (page_crossed ? PAGE_PENALTY[opcode] : 0);
     this->curr_instr_info.addr = address;
     this->curr_instr_info.mode = mode;
     this->curr_instr_info.opcode = opcode;
-    (this->*opcodes[opcode])(this->curr_instr_info);
+    this->curr_instr_info.page_crossed = page_crossed;
+    
+    if (this->opcodes[opcode])
+        (this->*opcodes[opcode])(this->curr_instr_info);
+}
+
+/* Kept out of line so exec() carries no logging code */
+__attribute__((noinline, cold))
+void CPU::nonstandard_opcode(__attribute__((unused)) uint8_t opcode)
+{
+#ifdef DEBUG
+    if (this->nonstandard_opcodes == 0)
+        cerr << "WARNING: Hit non-standard opcode or data!\n";
+#endif
+
+    this->nonstandard_opcodes++;
+}
+
+void CPU::step()
+{
+    this->exec(this->read8(this->regs.pc));
+}
+
+void CPU::trace_step()
+{
+    uint16_t pc = this->regs.pc;
+
+    this->tracer->record({
+        this->cycles, pc, this->mem[pc], { this->mem[(uint16_t) (pc + 1)], this->mem[(uint16_t) (pc + 2)] },
+        this->regs.a, this->regs.x, this->regs.y, this->regs.p, this->regs.s
+    });
+}
+
+/*
+ * Hooks can be turned off from inside an instruction, by an exec hook or a watchpoint handler,
+ * and the setters only end the loop after it, so every loop checks a hook again before use.
+ */
+template<unsigned Hooks>
+void CPU::run_steps()
+{
+    while (this->cycles < this->budget) {
+        if ((Hooks & HOOK_EXEC) && this->exec_pages && this->exec_pages[this->regs.pc >> PAGE_SHIFT])
+            this->exec_hook->before_exec(this->regs.pc);
+        
+        if ((Hooks & HOOK_TRACE) && this->tracer)
+            this->trace_step();
+        
+        uint64_t start = this->cycles;
+        this->step();
+        
+        ExecCounters* counters = this->counters;
+        if ((Hooks & HOOK_COUNT) && counters)
+            counters->count(this->curr_instr_info, this->cycles - start);
+        
+        Profiler* profiler = this->profiler;
+        if ((Hooks & HOOK_PROFILE) && profiler)
+            profiler->after_step(this->curr_instr_info.opcode, this->regs.pc, this->regs.s, this->cycles);
+    }
+}
+
+/* Indexed by the RunHook bits */
+const CPU::StepLoop CPU::step_loops[NUM_HOOK_LOOPS] = {
+    &CPU::run_steps<0>,  &CPU::run_steps<1>,  &CPU::run_steps<2>,  &CPU::run_steps<3>,
+    &CPU::run_steps<4>,  &CPU::run_steps<5>,  &CPU::run_steps<6>,  &CPU::run_steps<7>,
+    &CPU::run_steps<8>,  &CPU::run_steps<9>,  &CPU::run_steps<10>, &CPU::run_steps<11>,
+    &CPU::run_steps<12>, &CPU::run_steps<13>, &CPU::run_steps<14>, &CPU::run_steps<15>
+};
+
+void CPU::run(uint64_t until_cycle)
+{
+    this->run_until = until_cycle;
+    this->budget = min(until_cycle, this->poll_at);
+    
+    for (;;) {
+        unsigned hooks = (this->exec_hook ? (unsigned) HOOK_EXEC : 0) |
+                         (this->tracer ? (unsigned) HOOK_TRACE : 0) |
+                         (this->counters ? (unsigned) HOOK_COUNT : 0) |
+                         (this->profiler ? (unsigned) HOOK_PROFILE : 0);
+
+        (this->*step_loops[hooks])();
+        
+        if (this->cycles >= this->poll_at) {
+            this->poll_at = NO_POLL;
+            this->poll_interrupts();
+        }
+        
+        /* Short of both, the loop was ended to pick up a change of hooks */
+        if (this->cycles >= this->run_until)
+            break;
+        
+        this->budget = min(this->run_until, this->poll_at);
+    }
+}
+
+void CPU::reselect_loop()
+{
+    this->budget = min(this->budget, this->cycles);
+}
+
+void CPU::end_run_at(uint64_t cycle)
+{
+    this->run_until = min(this->run_until, cycle);
+    this->budget = min(this->budget, cycle);
+}
+
+void CPU::request_poll(uint64_t cycle)
+{
+    this->poll_at = min(this->poll_at, cycle);
+    this->budget = min(this->budget, this->poll_at);
+}
+
+void CPU::poll_interrupts()
+{
+    /* Lines are sampled before the last cycle of an instruction; a taken branch that stays on
+       its page samples before its last two, so it delays an interrupt by one instruction */
+    uint64_t lag = (this->branch_end == this->cycles) ? 2 : 1;
+    uint64_t sampled = (this->cycles > lag) ? this->cycles - lag : 0;
+    bool masked = (this->i_latch_end == this->cycles) ? this->i_latched : (this->regs.p & FLAG_INTERRUPT);
+    
+    if (this->nmi_pending && this->nmi_at < sampled) {
+        this->nmi_pending = false;
+        this->interrupt(NMI_VECTOR);
+        return;
+    }
+    
+    if (this->irq_lines && !masked && this->irq_at < sampled) {
+        this->interrupt(IRQ_VECTOR);
+        return;
+    }
+    
+    /* Raised too late for this instruction, or held off by a delayed I flag: try after the next */
+    if (this->nmi_pending || (this->irq_lines && !(this->regs.p & FLAG_INTERRUPT)))
+        this->request_poll(this->cycles + 1);
+}
+
+void CPU::interrupt(uint16_t vector)
+{
+    this->push16(this->regs.pc);
+    this->push8((this->regs.p | FLAG_UNUSED) & ~FLAG_BREAK);
+    this->regs.set_flag(FLAG_INTERRUPT);
+    this->regs.pc = this->read8(vector) | this->read8(vector + 1) << 8;
+    this->cycles += INTERRUPT_CYCLES;
+    
+    if (this->profiler)
+        this->profiler->enter_interrupt(vector, this->regs.pc, this->regs.s);
+    if (this->timeline)
+        this->timeline->instant(vector == NMI_VECTOR ? "nmi" : "irq", "cpu", this->cycles, this->regs.pc);
+}
+
+void CPU::reset()
+{
+    this->regs.s -= 3;
+    this->regs.set_flag(FLAG_INTERRUPT);
+    this->regs.pc = this->read8(RESET_VECTOR) | this->read8(RESET_VECTOR + 1) << 8;
+    this->cycles += INTERRUPT_CYCLES;
+    this->nmi_pending = false;
+    this->irq_lines = 0;
+    this->poll_at = NO_POLL;
+}
+
+void CPU::nmi(uint64_t at)
+{
+    this->nmi_pending = true;
+    this->nmi_at = at;
+    this->request_poll(0);
+}
+
+void CPU::set_irq(uint8_t source, bool asserted, uint64_t at)
+{
+    uint8_t lines = asserted ? (this->irq_lines | source) : (this->irq_lines & ~source);
+    
+    if (!this->irq_lines && lines) {
+        this->irq_at = at;
+        
+        /* While masked, whatever clears the I flag asks for the poll instead */
+        if (!(this->regs.p & FLAG_INTERRUPT))
+            this->request_poll(0);
+    }
+    
+    this->irq_lines = lines;
+}
+
+uint8_t CPU::get_irq_lines()
+{
+    return this->irq_lines;
+}
+
+void CPU::latch_i_flag()
+{
+    this->i_latched = this->regs.p & FLAG_INTERRUPT;
+    this->i_latch_end = this->cycles;
 }
 
 void CPU::handle_flags(uint8_t flags, uint8_t val)
@@ -130,15 +344,106 @@ uint16_t CPU::pull16()
     return hi << 8 | lo;
 }
 
-void CPU::brk(InstructionInfo& info)
+void CPU::brk(__attribute__((unused)) InstructionInfo& info)
 {
     this->push16(this->regs.pc);
     this->push8(this->regs.p);
-    this->sei(info);
     this->regs.set_flag(FLAG_INTERRUPT);
     this->regs.pc = this->get_mem16(0xFFFE);
 }
 
+void CPU::rti(__attribute__((unused)) InstructionInfo& info)
+{
+    /* Unlike CLI and PLP, RTI's flags apply before the next poll */
+    this->regs.p = this->pull8() | FLAG_UNUSED;
+    this->regs.pc = this->pull16();
+    
+    if (this->irq_lines && !(this->regs.p & FLAG_INTERRUPT))
+        this->request_poll(0);
+}
+
+void CPU::bit(InstructionInfo& info)
+{
+    uint8_t m = this->read8(info.addr);
+    
+    this->handle_flags(FLAG_ZERO, this->regs.a & m);
+    this->handle_flags(FLAG_NEGATIVE, m);
+    
+    (m & FLAG_OVERFLOW)
+        ? this->regs.set_flag(FLAG_OVERFLOW)
+        : this->regs.clear_flag(FLAG_OVERFLOW);
+}
+
+void CPU::jmp(InstructionInfo& info)
+{
+    this->regs.pc = info.addr;
+}
+
+void CPU::jsr(InstructionInfo& info)
+{
+    this->push16(this->regs.pc - 1);
+    this->regs.pc = info.addr;
+}
+
+void CPU::rts(__attribute__((unused)) InstructionInfo& info)
+{
+    this->regs.pc = this->pull16() + 1;
+}
+
+void CPU::branch(InstructionInfo& info, bool taken)
+{
+    if (!taken)
+        return;
+    
+    bool crossed = ((this->regs.pc ^ info.addr) & 0xFF00) != 0;
+    
+    this->cycles += crossed ? 2 : 1;
+    this->regs.pc = info.addr;
+    
+    if (!crossed)
+        this->branch_end = this->cycles;
+}
+
+void CPU::bcc(InstructionInfo& info)
+{
+    this->branch(info, !(this->regs.p & FLAG_CARRY));
+}
+
+void CPU::bcs(InstructionInfo& info)
+{
+    this->branch(info, this->regs.p & FLAG_CARRY);
+}
+
+void CPU::beq(InstructionInfo& info)
+{
+    this->branch(info, this->regs.p & FLAG_ZERO);
+}
+
+void CPU::bmi(InstructionInfo& info)
+{
+    this->branch(info, this->regs.p & FLAG_NEGATIVE);
+}
+
+void CPU::bne(InstructionInfo& info)
+{
+    this->branch(info, !(this->regs.p & FLAG_ZERO));
+}
+
+void CPU::bpl(InstructionInfo& info)
+{
+    this->branch(info, !(this->regs.p & FLAG_NEGATIVE));
+}
+
+void CPU::bvc(InstructionInfo& info)
+{
+    this->branch(info, !(this->regs.p & FLAG_OVERFLOW));
+}
+
+void CPU::bvs(InstructionInfo& info)
+{
+    this->branch(info, this->regs.p & FLAG_OVERFLOW);
+}
+
 void CPU::nop(__attribute__((unused)) InstructionInfo& info)
 {
     /* NOPping... */
@@ -146,17 +451,17 @@ void CPU::nop(__attribute__((unused)) InstructionInfo& info)
 
 void CPU::sta(InstructionInfo& info)
 {
-    this->mem[info.addr] = this->regs.a;
+    this->write8(info.addr, this->regs.a);
 }
 
 void CPU::stx(InstructionInfo& info)
 {
-    this->mem[info.addr] = this->regs.x;
+    this->write8(info.addr, this->regs.x);
 }
 
 void CPU::sty(InstructionInfo& info)
 {
-    this->mem[info.addr] = this->regs.y;
+    this->write8(info.addr, this->regs.y);
 }
 
 void CPU::tax(__attribute__((unused)) InstructionInfo& info)
@@ -213,7 +518,11 @@ void CPU::cld(__attribute__((unused)) InstructionInfo& info)
 
 void CPU::cli(__attribute__((unused)) InstructionInfo& info)
 {
+    this->latch_i_flag();
     this->regs.clear_flag(FLAG_INTERRUPT);
+    
+    if (this->irq_lines)
+        this->request_poll(0);
 }
 
 void CPU::clv(__attribute__((unused)) InstructionInfo& info)
@@ -223,6 +532,7 @@ void CPU::clv(__attribute__((unused)) InstructionInfo& info)
 
 void CPU::sei(__attribute__((unused)) InstructionInfo& info)
 {
+    this->latch_i_flag();
     this->regs.set_flag(FLAG_INTERRUPT);
 }
 
@@ -234,7 +544,7 @@ void CPU::sec(__attribute__((unused)) InstructionInfo& info)
 void CPU::cmp(InstructionInfo& info)
 {
     uint8_t a = this->regs.a;
-    uint8_t m = this->mem[info.addr];
+    uint8_t m = this->read8(info.addr);
     
     if (a >= m)
         this->sec(info);
@@ -248,7 +558,7 @@ void CPU::cmp(InstructionInfo& info)
 void CPU::cpx(InstructionInfo& info)
 {
     uint8_t x = this->regs.x;
-    uint8_t m = this->mem[info.addr];
+    uint8_t m = this->read8(info.addr);
     
     if (x >= m)
         this->sec(info);
@@ -262,7 +572,7 @@ void CPU::cpx(InstructionInfo& info)
 void CPU::cpy(InstructionInfo& info)
 {
     uint8_t y = this->regs.y;
-    uint8_t m = this->mem[info.addr];
+    uint8_t m = this->read8(info.addr);
     
     if (y >= m)
         this->sec(info);
@@ -275,25 +585,25 @@ void CPU::cpy(InstructionInfo& info)
 
 void CPU::lda(InstructionInfo& info)
 {
-    this->regs.a = this->mem[info.addr];
+    this->regs.a = this->read8(info.addr);
     this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.a);
 }
 
 void CPU::ldx(InstructionInfo& info)
 {
-    this->regs.x = this->mem[info.addr];
+    this->regs.x = this->read8(info.addr);
     this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.x);
 }
 
 void CPU::ldy(InstructionInfo& info)
 {
-    this->regs.y = this->mem[info.addr];
+    this->regs.y = this->read8(info.addr);
     this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.y);
 }
 
 void CPU::asl(InstructionInfo& info)
 {
-    int a = (info.mode == ACCUMULATOR) ? this->regs.a : this->mem[info.addr];
+    int a = (info.mode == ACCUMULATOR) ? this->regs.a : this->read8(info.addr);
     a <<= 1;
     
     if (a & (1 << 7))
@@ -303,14 +613,14 @@ void CPU::asl(InstructionInfo& info)
         this->regs.a = a;
         this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.a);
     } else {
-        this->mem[info.addr] = a;
-        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->mem[info.addr]);
+        this->write8(info.addr, a);
+        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, (uint8_t) a);
     }
 }
 
 void CPU::lsr(InstructionInfo& info)
 {
-    int a = (info.mode == ACCUMULATOR) ? this->regs.a : this->mem[info.addr];
+    int a = (info.mode == ACCUMULATOR) ? this->regs.a : this->read8(info.addr);
     
     a >>= 1;
     
@@ -321,32 +631,32 @@ void CPU::lsr(InstructionInfo& info)
         this->regs.a = a;
         this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.a);
     } else {
-        this->mem[info.addr] = a;
-        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->mem[info.addr]);
+        this->write8(info.addr, a);
+        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, (uint8_t) a);
     }
 }
 
 void CPU::ora(InstructionInfo& info)
 {
-    this->regs.a |= this->mem[info.addr];
+    this->regs.a |= this->read8(info.addr);
     this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.a);
 }
 
 void CPU::_and(InstructionInfo& info)
 {
-    this->regs.a &= this->mem[info.addr];
+    this->regs.a &= this->read8(info.addr);
     this->handle_flags(FLAG_ZERO  | FLAG_NEGATIVE, this->regs.a);
 }
 
 void CPU::eor(InstructionInfo& info)
 {
-    this->regs.a ^= this->mem[info.addr];
+    this->regs.a ^= this->read8(info.addr);
     this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.a);
 }
 
 void CPU::rol(InstructionInfo& info)
 {
-    uint8_t a = (info.mode == ACCUMULATOR) ? this->regs.a : this->mem[info.addr];
+    uint8_t a = (info.mode == ACCUMULATOR) ? this->regs.a : this->read8(info.addr);
     
     if (a & (1 << 7))
         this->set_flag(FLAG_CARRY);
@@ -364,14 +674,14 @@ void CPU::rol(InstructionInfo& info)
         this->regs.a = a;
         this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.a);
     } else {
-        this->mem[info.addr] = a;
-        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->mem[info.addr]);
+        this->write8(info.addr, a);
+        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, (uint8_t) a);
     }
 }
 
 void CPU::ror(InstructionInfo& info)
 {
-    uint8_t a = (info.mode == ACCUMULATOR) ? this->regs.a : this->mem[info.addr];
+    uint8_t a = (info.mode == ACCUMULATOR) ? this->regs.a : this->read8(info.addr);
     
     if (a & (1 << 7))
         this->set_flag(FLAG_CARRY);
@@ -389,15 +699,15 @@ void CPU::ror(InstructionInfo& info)
         this->regs.a = a;
         this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->regs.a);
     } else {
-        this->mem[info.addr] = a;
-        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->mem[info.addr]);
+        this->write8(info.addr, a);
+        this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, (uint8_t) a);
     }
 }
 
 void CPU::adc(InstructionInfo& info)
 {
     uint8_t a = this->regs.a;
-    uint8_t b = this->mem[info.addr];
+    uint8_t b = this->read8(info.addr);
     uint8_t c = this->get_p() & FLAG_CARRY;
     
     this->regs.a = a + b + c;
@@ -414,8 +724,9 @@ void CPU::adc(InstructionInfo& info)
 
 void CPU::dec(InstructionInfo& info)
 {
-    this->mem[info.addr] -= 1;
-    this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->mem[info.addr]);
+    uint8_t m = this->read8(info.addr) - 1;
+    this->write8(info.addr, m);
+    this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, m);
 }
 
 void CPU::dex(__attribute__((unused)) InstructionInfo& info)
@@ -432,8 +743,9 @@ void CPU::dey(__attribute__((unused)) InstructionInfo& info)
 
 void CPU::inc(InstructionInfo& info)
 {
-    this->mem[info.addr] += 1;
-    this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, this->mem[info.addr]);
+    uint8_t m = this->read8(info.addr) + 1;
+    this->write8(info.addr, m);
+    this->handle_flags(FLAG_ZERO | FLAG_NEGATIVE, m);
 }
 
 void CPU::inx(__attribute__((unused)) InstructionInfo& info)
@@ -451,7 +763,7 @@ void CPU::iny(__attribute__((unused)) InstructionInfo& info)
 void CPU::sbc(InstructionInfo& info)
 {
     uint8_t a = this->regs.a;
-    uint8_t b = this->mem[info.addr];
+    uint8_t b = this->read8(info.addr);
     uint8_t c = 1 - (this->get_p() & FLAG_CARRY);
     
     this->regs.a = a - b - c;
@@ -484,7 +796,11 @@ void CPU::pla(__attribute__((unused)) InstructionInfo& info)
 
 void CPU::plp(__attribute__((unused)) InstructionInfo& info)
 {
+    this->latch_i_flag();
     this->regs.p = this->pull8();
+    
+    if (this->irq_lines && !(this->regs.p & FLAG_INTERRUPT))
+        this->request_poll(0);
 }
 
 uint8_t CPU::get_a()
@@ -547,6 +863,278 @@ void CPU::set_p(uint8_t p)
     this->regs.p = p;
 }
 
+uint8_t CPU::io_read(uint16_t addr)
+{
+    IODevice* device = this->io_devices[addr >> PAGE_SHIFT];
+    
+    if (device)
+        return device->io_read(addr);
+    
+    return addr >> PAGE_SHIFT; // Open bus: the high address byte is what was last on the bus
+}
+
+void CPU::io_write(uint16_t addr, uint8_t val)
+{
+    IODevice* device = this->io_devices[addr >> PAGE_SHIFT];
+    
+    if (device)
+        device->io_write(addr, val);
+}
+
+uint8_t* CPU::writable_page(size_t page)
+{
+    return this->watched[page] ? this->parked_write[page] : this->write_pages[page];
+}
+
+size_t CPU::writable_run(size_t page)
+{
+    uint8_t* base = this->writable_page(page);
+    size_t n = 0;
+
+    if (!base)
+        return 0;
+
+    while (page + n < NUM_PAGES && this->writable_page(page + n) == base + n * PAGE_SIZE)
+        n++;
+
+    return n;
+}
+
+void CPU::save_state(CPUSnapshot& snap)
+{
+    snap.regs = this->regs;
+    snap.cycles = this->cycles;
+    snap.poll_at = this->poll_at;
+    snap.nmi_pending = this->nmi_pending;
+    snap.nmi_at = this->nmi_at;
+    snap.irq_lines = this->irq_lines;
+    snap.irq_at = this->irq_at;
+    snap.branch_end = this->branch_end;
+    snap.i_latch_end = this->i_latch_end;
+    snap.i_latched = this->i_latched;
+
+    /* One copy per run of contiguous writable pages: RAM and cartridge RAM, never ROM */
+    for (size_t page = 0; page < NUM_PAGES; page++) {
+        size_t n = this->writable_run(page);
+
+        if (n) {
+            memcpy(&snap.mem[page << PAGE_SHIFT], this->writable_page(page), n * PAGE_SIZE);
+            page += n - 1;
+        }
+    }
+}
+
+void CPU::load_state(const CPUSnapshot& snap, bool memory)
+{
+    this->regs = snap.regs;
+    this->cycles = snap.cycles;
+    this->poll_at = snap.poll_at;
+    this->nmi_pending = snap.nmi_pending;
+    this->nmi_at = snap.nmi_at;
+    this->irq_lines = snap.irq_lines;
+    this->irq_at = snap.irq_at;
+    this->branch_end = snap.branch_end;
+    this->i_latch_end = snap.i_latch_end;
+    this->i_latched = snap.i_latched;
+
+    if (!memory)
+        return;
+
+    for (size_t page = 0; page < NUM_PAGES; page++) {
+        size_t n = this->writable_run(page);
+
+        if (n) {
+            memcpy(this->writable_page(page), &snap.mem[page << PAGE_SHIFT], n * PAGE_SIZE);
+            page += n - 1;
+        }
+    }
+}
+
+uint64_t CPU::hash_state(uint64_t seed)
+{
+    const Regs& r = this->regs;
+    uint64_t regs = r.a | r.x << 8 | r.y << 16 | (uint64_t) r.pc << 24 | (uint64_t) r.s << 40 | (uint64_t) r.p << 48;
+    uint64_t interrupts = this->nmi_pending | this->irq_lines << 1 | this->i_latched << 9;
+    uint64_t timing[] = {
+        regs, interrupts, this->cycles, this->poll_at, this->nmi_at, this->irq_at, this->branch_end, this->i_latch_end
+    };
+    uint64_t h = hash_bytes(timing, sizeof(timing), seed);
+
+    for (size_t page = 0; page < NUM_PAGES; page++) {
+        size_t n = this->writable_run(page);
+
+        if (n) {
+            h = hash_bytes(this->writable_page(page), n * PAGE_SIZE, h);
+            page += n - 1;
+        }
+    }
+
+    return h;
+}
+
+void CPU::map_memory(uint8_t first_page, uint8_t last_page, uint8_t* base, bool writable)
+{
+    for (size_t page = first_page; page <= last_page; page++) {
+        uint8_t* ptr = base + (page - first_page) * PAGE_SIZE;
+
+        if (this->watched[page]) {
+            this->parked_read[page] = ptr;
+            this->parked_write[page] = writable ? ptr : nullptr;
+            this->parked_device[page] = nullptr;
+            continue;
+        }
+
+        this->read_pages[page] = ptr;
+        this->write_pages[page] = writable ? ptr : nullptr;
+        this->io_devices[page] = nullptr;
+    }
+}
+
+void CPU::map_io(uint8_t first_page, uint8_t last_page, IODevice* device)
+{
+    for (size_t page = first_page; page <= last_page; page++) {
+        if (this->watched[page]) {
+            this->parked_read[page] = nullptr;
+            this->parked_write[page] = nullptr;
+            this->parked_device[page] = device;
+            continue;
+        }
+
+        this->read_pages[page] = nullptr;
+        this->write_pages[page] = nullptr;
+        this->io_devices[page] = device;
+    }
+}
+
+void CPU::watch_page(uint8_t page, IODevice* watcher)
+{
+    if (!this->watched[page]) {
+        this->parked_read[page] = this->read_pages[page];
+        this->parked_write[page] = this->write_pages[page];
+        this->parked_device[page] = this->io_devices[page];
+        this->watched[page] = true;
+    }
+
+    this->read_pages[page] = nullptr;
+    this->write_pages[page] = nullptr;
+    this->io_devices[page] = watcher;
+}
+
+void CPU::unwatch_page(uint8_t page)
+{
+    if (!this->watched[page])
+        return;
+
+    this->read_pages[page] = this->parked_read[page];
+    this->write_pages[page] = this->parked_write[page];
+    this->io_devices[page] = this->parked_device[page];
+    this->watched[page] = false;
+}
+
+uint8_t CPU::unwatched_read(uint16_t addr)
+{
+    uint8_t page = addr >> PAGE_SHIFT;
+
+    if (!this->watched[page])
+        return this->read8(addr);
+
+    if (this->parked_read[page])
+        return this->parked_read[page][addr & PAGE_MASK];
+
+    if (this->parked_device[page])
+        return this->parked_device[page]->io_read(addr);
+
+    return page;
+}
+
+void CPU::unwatched_write(uint16_t addr, uint8_t val)
+{
+    uint8_t page = addr >> PAGE_SHIFT;
+
+    if (!this->watched[page])
+        this->write8(addr, val);
+    else if (this->parked_write[page])
+        this->parked_write[page][addr & PAGE_MASK] = val;
+    else if (this->parked_device[page])
+        this->parked_device[page]->io_write(addr, val);
+}
+
+void CPU::set_tracer(Tracer* tracer)
+{
+    this->tracer = tracer;
+    this->reselect_loop();
+}
+
+void CPU::set_counters(ExecCounters* counters)
+{
+    this->counters = counters;
+    this->reselect_loop();
+}
+
+void CPU::set_timeline(Timeline* timeline)
+{
+    this->timeline = timeline;
+}
+
+void CPU::set_profiler(Profiler* profiler)
+{
+    this->profiler = profiler;
+    this->reselect_loop();
+    
+    if (profiler)
+        profiler->start(this->cycles);
+}
+
+uint64_t CPU::get_nonstandard_opcodes()
+{
+    return this->nonstandard_opcodes;
+}
+
+void CPU::set_exec_hook(ExecHook* hook, const uint8_t* marked_pages)
+{
+    this->exec_hook = hook;
+    this->exec_pages = hook ? marked_pages : nullptr;
+    this->reselect_loop();
+}
+
+const uint8_t* CPU::get_read_page(uint8_t page)
+{
+    return this->watched[page] ? this->parked_read[page] : this->read_pages[page];
+}
+
+uint8_t* CPU::get_write_page(uint8_t page)
+{
+    return this->writable_page(page);
+}
+
+const uint8_t* CPU::read_page(uint8_t page, uint8_t* scratch)
+{
+    if (this->read_pages[page])
+        return this->read_pages[page];
+    
+    uint16_t base = page << PAGE_SHIFT;
+    
+    for (size_t i = 0; i < PAGE_SIZE; i++)
+        scratch[i] = this->io_read(base | i);
+    
+    return scratch;
+}
+
+uint64_t CPU::get_cycles()
+{
+    return this->cycles;
+}
+
+void CPU::set_cycles(uint64_t cycles)
+{
+    this->cycles = cycles;
+}
+
+void CPU::stall(uint64_t cycles)
+{
+    this->cycles += cycles;
+}
+
 uint8_t* CPU::get_memptr(size_t i)
 {
     return &this->mem[i];
@@ -2,6 +2,9 @@
 
 #include <cstdint>
 
+#include "bus.h"
+#include "trace.h"
+
 using namespace std;
 
 const uint16_t STACK_ADDR = 0x100;
@@ -11,12 +14,26 @@ enum Flag : uint8_t {
     FLAG_ZERO        = 1 << 1,
     FLAG_INTERRUPT   = 1 << 2,
     FLAG_DECIMAL     = 1 << 3,
+    FLAG_BREAK       = 1 << 4,
+    FLAG_UNUSED      = 1 << 5,
     FLAG_OVERFLOW    = 1 << 6,
     FLAG_NEGATIVE    = 1 << 7
 };
 
 static const uint8_t FLAGS_IRQ_DISABLED = 0x34;
 
+const uint16_t NMI_VECTOR = 0xFFFA;
+const uint16_t RESET_VECTOR = 0xFFFC;
+const uint16_t IRQ_VECTOR = 0xFFFE;
+const uint64_t INTERRUPT_CYCLES = 7;
+const uint64_t NO_POLL = UINT64_MAX;
+
+/* IRQ is level triggered and shared: each source holds its own bit of the line */
+enum IRQSource : uint8_t {
+    IRQ_APU         = 1 << 0,
+    IRQ_CARTRIDGE   = 1 << 1
+};
+
 enum NumMirrors : size_t {
     NUM_RAM_MIRRORS = 3,
     NUM_PPU_REGS_MIRRORS = 1023
@@ -59,6 +76,13 @@ enum MappingMode {
     NO_MAP
 };
 
+const size_t NUM_MAPPING_MODES = NO_MAP + 1;
+
+const char* const MODE_NAMES[NUM_MAPPING_MODES] = {
+    "ZERO_X", "ZERO_Y", "ABSOLUTE_X", "ABSOLUTE_Y", "INDIRECT_X", "INDIRECT_Y", "IMPLICIT",
+    "ACCUMULATOR", "IMMEDIATE", "ZERO", "ABSOLUTE", "RELATIVE", "INDIRECT", "NO_MAP"
+};
+
 struct Regs {
     uint8_t     a;      // Accumulator
     uint8_t     x, y;   // Indexes
@@ -74,6 +98,44 @@ struct InstructionInfo {
     uint16_t    addr;
     MappingMode mode = {};
     uint8_t     opcode;
+    bool        page_crossed = false;
+};
+
+/* Everything that changes as the CPU runs, including the contents of every writable page */
+struct CPUSnapshot {
+    Regs        regs;
+    uint64_t    cycles;
+    uint64_t    poll_at;
+    bool        nmi_pending;
+    uint64_t    nmi_at;
+    uint8_t     irq_lines;
+    uint64_t    irq_at;
+    uint64_t    branch_end;
+    uint64_t    i_latch_end;
+    bool        i_latched;
+    uint8_t     mem[NUM_PAGES * PAGE_SIZE];
+};
+
+/* Optional work run() does before each instruction; each combination gets its own step loop */
+enum RunHook : unsigned {
+    HOOK_EXEC       = 1 << 0,
+    HOOK_TRACE      = 1 << 1,
+    HOOK_COUNT      = 1 << 2,
+    HOOK_PROFILE    = 1 << 3,
+    NUM_HOOK_LOOPS  = 1 << 4
+};
+
+class ExecCounters;
+class Profiler;
+class Timeline;
+
+/* Told about every instruction about to run on a page marked with set_exec_hook() */
+class ExecHook
+{
+public:
+    virtual ~ExecHook() {}
+
+    virtual void before_exec(uint16_t pc) = 0;
 };
 
 const size_t NUM_OPCODES = 256;
@@ -81,21 +143,21 @@ const size_t NUM_OPCODES = 256;
 const MappingMode MAPPING_MODES[NUM_OPCODES] = {
   /*     0x00        0x01       0x02    0x03    0x04    0x05    0x06    0x07      0x08        0x09         0x0A    0x0B        0x0C        0x0D        0x0E    0x0F  */
      IMPLICIT, INDIRECT_X,    NO_MAP, NO_MAP, NO_MAP,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE, ACCUMULATOR, NO_MAP,     NO_MAP,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0x0F
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x1F
-     IMPLICIT, INDIRECT_X,    NO_MAP, NO_MAP,   ZERO,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE, ACCUMULATOR, NO_MAP,   ABSOLUTE,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0x2F
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x3F
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x1F
+     ABSOLUTE, INDIRECT_X,    NO_MAP, NO_MAP,   ZERO,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE, ACCUMULATOR, NO_MAP,   ABSOLUTE,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0x2F
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x3F
      IMPLICIT, INDIRECT_X,    NO_MAP, NO_MAP, NO_MAP,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE, ACCUMULATOR, NO_MAP,   ABSOLUTE,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0x4F
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x5F
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x5F
      IMPLICIT, INDIRECT_X,    NO_MAP, NO_MAP, NO_MAP,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE, ACCUMULATOR, NO_MAP,   INDIRECT,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0x6F
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x7F
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0x7F
        NO_MAP, INDIRECT_X,    NO_MAP, NO_MAP,   ZERO,   ZERO,   ZERO, NO_MAP, IMPLICIT,     NO_MAP,    IMPLICIT, NO_MAP,   ABSOLUTE,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0x8F
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, ZERO_X, ZERO_X, ZERO_Y, NO_MAP, IMPLICIT, ABSOLUTE_Y,    IMPLICIT, NO_MAP,     NO_MAP, ABSOLUTE_X,     NO_MAP, NO_MAP, // 0x9F
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, ZERO_X, ZERO_X, ZERO_Y, NO_MAP, IMPLICIT, ABSOLUTE_Y,    IMPLICIT, NO_MAP,     NO_MAP, ABSOLUTE_X,     NO_MAP, NO_MAP, // 0x9F
     IMMEDIATE, INDIRECT_X, IMMEDIATE, NO_MAP,   ZERO,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE,    IMPLICIT, NO_MAP,   ABSOLUTE,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0xAF
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, ZERO_X, ZERO_X, ZERO_Y, NO_MAP, IMPLICIT, ABSOLUTE_Y,    IMPLICIT, NO_MAP, ABSOLUTE_X, ABSOLUTE_X, ABSOLUTE_Y, NO_MAP, // 0xBF
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, ZERO_X, ZERO_X, ZERO_Y, NO_MAP, IMPLICIT, ABSOLUTE_Y,    IMPLICIT, NO_MAP, ABSOLUTE_X, ABSOLUTE_X, ABSOLUTE_Y, NO_MAP, // 0xBF
     IMMEDIATE, INDIRECT_X,    NO_MAP, NO_MAP,   ZERO,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE,    IMPLICIT, NO_MAP,   ABSOLUTE,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0xCF
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0xDF
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP, // 0xDF
     IMMEDIATE, INDIRECT_X,    NO_MAP, NO_MAP,   ZERO,   ZERO,   ZERO, NO_MAP, IMPLICIT,  IMMEDIATE,    IMPLICIT, NO_MAP,   ABSOLUTE,   ABSOLUTE,   ABSOLUTE, NO_MAP, // 0xEF
-     IMPLICIT, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP  // 0xFF
+     RELATIVE, INDIRECT_Y,    NO_MAP, NO_MAP, NO_MAP, ZERO_X, ZERO_X, NO_MAP, IMPLICIT, ABSOLUTE_Y,      NO_MAP, NO_MAP,     NO_MAP, ABSOLUTE_X, ABSOLUTE_X, NO_MAP  // 0xFF
 };
 
 const uint8_t INSTR_LEN[NUM_OPCODES] = {
@@ -118,11 +180,74 @@ const uint8_t INSTR_LEN[NUM_OPCODES] = {
     2, 2, 0, 0, 2, 2, 2, 0, 1, 3, 1, 0, 3, 3, 3, 0  // 0xFF
 };
 
+/* Base cycle count per opcode, 0 for non-standard opcodes */
+const uint8_t CYCLES[NUM_OPCODES] = {
+/* 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F  */
+    7, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 0, 4, 6, 0, // 0x0F
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 0x1F
+    6, 6, 0, 0, 3, 3, 5, 0, 4, 2, 2, 0, 4, 4, 6, 0, // 0x2F
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 0x3F
+    6, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 3, 4, 6, 0, // 0x4F
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 0x5F
+    6, 6, 0, 0, 0, 3, 5, 0, 4, 2, 2, 0, 5, 4, 6, 0, // 0x6F
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 0x7F
+    0, 6, 0, 0, 3, 3, 3, 0, 2, 0, 2, 0, 4, 4, 4, 0, // 0x8F
+    2, 6, 0, 0, 4, 4, 4, 0, 2, 5, 2, 0, 0, 5, 0, 0, // 0x9F
+    2, 6, 2, 0, 3, 3, 3, 0, 2, 2, 2, 0, 4, 4, 4, 0, // 0xAF
+    2, 5, 0, 0, 4, 4, 4, 0, 2, 4, 2, 0, 4, 4, 4, 0, // 0xBF
+    2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0, // 0xCF
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 0xDF
+    2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0, // 0xEF
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0  // 0xFF
+};
+
+const char* const MNEMONICS[NUM_OPCODES] = {
+/*    00     01     02     03     04     05     06     07     08     09     0A     0B     0C     0D     0E     0F  */
+    "BRK", "ORA", "???", "???", "???", "ORA", "ASL", "???", "PHP", "ORA", "ASL", "???", "???", "ORA", "ASL", "???", // 0x0F
+    "BPL", "ORA", "???", "???", "???", "ORA", "ASL", "???", "CLC", "ORA", "???", "???", "???", "ORA", "ASL", "???", // 0x1F
+    "JSR", "AND", "???", "???", "BIT", "AND", "ROL", "???", "PLP", "AND", "ROL", "???", "BIT", "AND", "ROL", "???", // 0x2F
+    "BMI", "AND", "???", "???", "???", "AND", "ROL", "???", "SEC", "AND", "???", "???", "???", "AND", "ROL", "???", // 0x3F
+    "RTI", "EOR", "???", "???", "???", "EOR", "LSR", "???", "PHA", "EOR", "LSR", "???", "JMP", "EOR", "LSR", "???", // 0x4F
+    "BVC", "EOR", "???", "???", "???", "EOR", "LSR", "???", "CLI", "EOR", "???", "???", "???", "EOR", "LSR", "???", // 0x5F
+    "RTS", "ADC", "???", "???", "???", "ADC", "ROR", "???", "PLA", "ADC", "ROR", "???", "JMP", "ADC", "ROR", "???", // 0x6F
+    "BVS", "ADC", "???", "???", "???", "ADC", "ROR", "???", "SEI", "ADC", "???", "???", "???", "ADC", "ROR", "???", // 0x7F
+    "???", "STA", "???", "???", "STY", "STA", "STX", "???", "DEY", "???", "TXA", "???", "STY", "STA", "STX", "???", // 0x8F
+    "BCC", "STA", "???", "???", "STY", "STA", "STX", "???", "TYA", "STA", "TXS", "???", "???", "STA", "???", "???", // 0x9F
+    "LDY", "LDA", "LDX", "???", "LDY", "LDA", "LDX", "???", "TAY", "LDA", "TAX", "???", "LDY", "LDA", "LDX", "???", // 0xAF
+    "BCS", "LDA", "???", "???", "LDY", "LDA", "LDX", "???", "CLV", "LDA", "TSX", "???", "LDY", "LDA", "LDX", "???", // 0xBF
+    "CPY", "CMP", "???", "???", "CPY", "CMP", "DEC", "???", "INY", "CMP", "DEX", "???", "CPY", "CMP", "DEC", "???", // 0xCF
+    "BNE", "CMP", "???", "???", "???", "CMP", "DEC", "???", "CLD", "CMP", "???", "???", "???", "CMP", "DEC", "???", // 0xDF
+    "CPX", "SBC", "???", "???", "CPX", "SBC", "INC", "???", "INX", "SBC", "NOP", "???", "CPX", "SBC", "INC", "???", // 0xEF
+    "BEQ", "SBC", "???", "???", "???", "SBC", "INC", "???", "SED", "SBC", "???", "???", "???", "SBC", "INC", "???"  // 0xFF
+};
+
+/* Extra cycle taken by indexed reads whose effective address crosses a page */
+const uint8_t PAGE_PENALTY[NUM_OPCODES] = {
+/* 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F  */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x0F
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, // 0x1F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x2F
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, // 0x3F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x4F
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, // 0x5F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x6F
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, // 0x7F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x8F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x9F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xAF
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, // 0xBF
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xCF
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, // 0xDF
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xEF
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0  // 0xFF
+};
+
 class CPU
 {
 private:
     Regs            regs;
-    uint8_t         mem[TOTAL_RAM_SIZE - 1];
+    uint64_t        cycles = 0;
+    uint8_t         mem[TOTAL_RAM_SIZE];
     uint8_t*        stack = &this->mem[STACK_ADDR];
     uint8_t*        ram = &mem[0];
     uint8_t*        mirror0 = ram + RAM_SIZE;
@@ -135,6 +260,61 @@ private:
     uint8_t*        cartridge_space = apu_io_test_mode + APU_IO_TEST_MODE_SIZE;
     InstructionInfo curr_instr_info;
     
+    /* Bus routing: pages with a direct pointer bypass the device table entirely */
+    uint8_t*        read_pages[NUM_PAGES];
+    uint8_t*        write_pages[NUM_PAGES];
+    IODevice*       io_devices[NUM_PAGES];
+    
+    /* Watched pages are routed to their watcher; their real routing is parked here meanwhile */
+    bool            watched[NUM_PAGES] = {};
+    uint8_t*        parked_read[NUM_PAGES] = {};
+    uint8_t*        parked_write[NUM_PAGES] = {};
+    IODevice*       parked_device[NUM_PAGES] = {};
+    
+    /* Breakpoints: with no hook, run() takes the plain loop and pays nothing */
+    ExecHook*       exec_hook = nullptr;
+    const uint8_t*  exec_pages = nullptr;
+    Tracer*         tracer = nullptr;
+    ExecCounters*   counters = nullptr;
+    Profiler*       profiler = nullptr;
+    Timeline*       timeline = nullptr;
+    uint64_t        nonstandard_opcodes = 0;
+    
+    /*
+     * Interrupts. The run loop only compares cycles against budget, which is the smaller of the
+     * caller's target and poll_at; raising a line pulls poll_at in, so an idle CPU pays nothing
+     * for polling. The *_end stamps mark the cycle the last branch or I-flag change finished on,
+     * for the two polling quirks.
+     */
+    uint64_t        run_until = 0;
+    uint64_t        budget = 0;
+    uint64_t        poll_at = NO_POLL;
+    bool            nmi_pending = false;
+    uint64_t        nmi_at = 0;
+    uint8_t         irq_lines = 0;
+    uint64_t        irq_at = 0;
+    uint64_t        branch_end = NO_POLL;   // A taken branch that stayed on its page
+    uint64_t        i_latch_end = NO_POLL;  // CLI, SEI or PLP: they poll with the old I flag
+    bool            i_latched = false;
+    
+    void        request_poll(uint64_t cycle);
+    void        poll_interrupts();
+    void        interrupt(uint16_t vector);
+    void        latch_i_flag();
+    void        branch(InstructionInfo& info, bool taken);
+    /* Number of writable pages from page on that are contiguous in memory */
+    size_t      writable_run(size_t page);
+    uint8_t*    writable_page(size_t page);
+    /* Ends the step loop after the current instruction, so run() picks the one for the hooks now set */
+    void        reselect_loop();
+    template<unsigned Hooks>
+    void        run_steps();
+    typedef void (CPU::*StepLoop)();
+    /* run_steps instantiated for each combination of RunHook bits */
+    static const StepLoop step_loops[NUM_HOOK_LOOPS];
+    void        trace_step();
+    void        nonstandard_opcode(uint8_t opcode);
+    
     ///////////////////////////////////// INSTRUCTIONS ///////////////////////////////////////////
     
     /********* REGISTERS *****************/
@@ -152,6 +332,21 @@ private:
     /********** SYSTEM *******************/
     void        nop(InstructionInfo& info);
     void        brk(InstructionInfo& info);
+    void        rti(InstructionInfo& info);
+    void        bit(InstructionInfo& info);
+    
+    /********** JUMPS ********************/
+    void        jmp(InstructionInfo& info);
+    void        jsr(InstructionInfo& info);
+    void        rts(InstructionInfo& info);
+    void        bcc(InstructionInfo& info);
+    void        bcs(InstructionInfo& info);
+    void        beq(InstructionInfo& info);
+    void        bmi(InstructionInfo& info);
+    void        bne(InstructionInfo& info);
+    void        bpl(InstructionInfo& info);
+    void        bvc(InstructionInfo& info);
+    void        bvs(InstructionInfo& info);
     
     /********** STORAGE ******************/
     void        sta(InstructionInfo& info);
@@ -201,25 +396,96 @@ public:
     void (CPU::*opcodes[NUM_OPCODES])(InstructionInfo& info) = {
     /*         00          01         02 03         04          05         06         07         08          09         0A 0B         0C          0D         0E 0F  */
         &CPU::brk,  &CPU::ora,         0, 0,         0,  &CPU::ora, &CPU::asl,         0, &CPU::php,  &CPU::ora, &CPU::asl, 0,         0,  &CPU::ora, &CPU::asl, 0, // 0x00
-                0,  &CPU::ora,         0, 0,         0,  &CPU::ora, &CPU::asl,         0, &CPU::clc,  &CPU::ora,         0, 0,         0,  &CPU::ora, &CPU::asl, 0, // 0x1F
-                0, &CPU::_and,         0, 0,         0, &CPU::_and, &CPU::rol,         0, &CPU::plp, &CPU::_and, &CPU::rol, 0,         0, &CPU::_and, &CPU::rol, 0, // 0x2F
-                0, &CPU::_and,         0, 0,         0, &CPU::_and, &CPU::rol,         0, &CPU::sec, &CPU::_and,         0, 0,         0, &CPU::_and, &CPU::rol, 0, // 0x3F
-                0,  &CPU::eor,         0, 0,         0,  &CPU::eor, &CPU::lsr,         0, &CPU::pha,  &CPU::eor, &CPU::lsr, 0,         0,  &CPU::eor, &CPU::lsr, 0, // 0x4F
-                0,  &CPU::eor,         0, 0,         0,  &CPU::eor, &CPU::lsr,         0, &CPU::cli,  &CPU::eor,         0, 0,         0,  &CPU::eor, &CPU::lsr, 0, // 0x5F
-                0,  &CPU::adc,         0, 0,         0,  &CPU::adc, &CPU::ror,         0, &CPU::pla,  &CPU::adc, &CPU::ror, 0,         0,  &CPU::adc, &CPU::ror, 0, // 0x6F
-                0,  &CPU::adc,         0, 0,         0,  &CPU::adc, &CPU::ror,         0, &CPU::sei,  &CPU::adc,         0, 0,         0,  &CPU::adc, &CPU::ror, 0, // 0x7F
+        &CPU::bpl,  &CPU::ora,         0, 0,         0,  &CPU::ora, &CPU::asl,         0, &CPU::clc,  &CPU::ora,         0, 0,         0,  &CPU::ora, &CPU::asl, 0, // 0x1F
+        &CPU::jsr, &CPU::_and,         0, 0, &CPU::bit, &CPU::_and, &CPU::rol,         0, &CPU::plp, &CPU::_and, &CPU::rol, 0, &CPU::bit, &CPU::_and, &CPU::rol, 0, // 0x2F
+        &CPU::bmi, &CPU::_and,         0, 0,         0, &CPU::_and, &CPU::rol,         0, &CPU::sec, &CPU::_and,         0, 0,         0, &CPU::_and, &CPU::rol, 0, // 0x3F
+        &CPU::rti,  &CPU::eor,         0, 0,         0,  &CPU::eor, &CPU::lsr,         0, &CPU::pha,  &CPU::eor, &CPU::lsr, 0, &CPU::jmp,  &CPU::eor, &CPU::lsr, 0, // 0x4F
+        &CPU::bvc,  &CPU::eor,         0, 0,         0,  &CPU::eor, &CPU::lsr,         0, &CPU::cli,  &CPU::eor,         0, 0,         0,  &CPU::eor, &CPU::lsr, 0, // 0x5F
+        &CPU::rts,  &CPU::adc,         0, 0,         0,  &CPU::adc, &CPU::ror,         0, &CPU::pla,  &CPU::adc, &CPU::ror, 0, &CPU::jmp,  &CPU::adc, &CPU::ror, 0, // 0x6F
+        &CPU::bvs,  &CPU::adc,         0, 0,         0,  &CPU::adc, &CPU::ror,         0, &CPU::sei,  &CPU::adc,         0, 0,         0,  &CPU::adc, &CPU::ror, 0, // 0x7F
                 0,  &CPU::sta,         0, 0, &CPU::sty,  &CPU::sta, &CPU::stx,         0, &CPU::dey,          0, &CPU::txa, 0, &CPU::sty,  &CPU::sta, &CPU::stx, 0, // 0x8F
-                0,  &CPU::sta,         0, 0, &CPU::sty,  &CPU::sta, &CPU::stx,         0, &CPU::tya,  &CPU::sta, &CPU::txs, 0,         0,  &CPU::sta,         0, 0, // 0x9F
+        &CPU::bcc,  &CPU::sta,         0, 0, &CPU::sty,  &CPU::sta, &CPU::stx,         0, &CPU::tya,  &CPU::sta, &CPU::txs, 0,         0,  &CPU::sta,         0, 0, // 0x9F
         &CPU::ldy,  &CPU::lda, &CPU::ldx, 0, &CPU::ldy,  &CPU::lda, &CPU::ldx,         0, &CPU::tay,  &CPU::lda, &CPU::tax, 0, &CPU::ldy,  &CPU::lda, &CPU::ldx, 0, // 0xAF
-                0,  &CPU::lda,         0, 0, &CPU::ldy,  &CPU::lda, &CPU::ldx,         0, &CPU::clv,  &CPU::lda, &CPU::tsx, 0, &CPU::ldy,  &CPU::lda, &CPU::ldx, 0, // 0xBF
+        &CPU::bcs,  &CPU::lda,         0, 0, &CPU::ldy,  &CPU::lda, &CPU::ldx,         0, &CPU::clv,  &CPU::lda, &CPU::tsx, 0, &CPU::ldy,  &CPU::lda, &CPU::ldx, 0, // 0xBF
         &CPU::cpy,  &CPU::cmp,         0, 0, &CPU::cpy,  &CPU::cmp, &CPU::dec,         0, &CPU::iny,  &CPU::cmp, &CPU::dex, 0, &CPU::cpy,  &CPU::cmp, &CPU::dec, 0, // 0xCF
-                0,  &CPU::cmp,         0, 0,         0,  &CPU::cmp, &CPU::dec,         0, &CPU::cld,  &CPU::cmp,         0, 0,         0,  &CPU::cmp, &CPU::dec, 0, // 0xDF
+        &CPU::bne,  &CPU::cmp,         0, 0,         0,  &CPU::cmp, &CPU::dec,         0, &CPU::cld,  &CPU::cmp,         0, 0,         0,  &CPU::cmp, &CPU::dec, 0, // 0xDF
         &CPU::cpx,  &CPU::sbc,         0, 0, &CPU::cpx,  &CPU::sbc, &CPU::inc,         0, &CPU::inx,  &CPU::sbc, &CPU::nop, 0, &CPU::cpx,  &CPU::sbc, &CPU::inc, 0, // 0xEF
-                0,  &CPU::sbc,         0, 0,         0,  &CPU::sbc, &CPU::inc,         0, &CPU::sed,  &CPU::sbc,         0, 0,         0,  &CPU::sbc, &CPU::inc, 0  // 0xFF
+        &CPU::beq,  &CPU::sbc,         0, 0,         0,  &CPU::sbc, &CPU::inc,         0, &CPU::sed,  &CPU::sbc,         0, 0,         0,  &CPU::sbc, &CPU::inc, 0  // 0xFF
     };
 
     void        exec(uint8_t opcode);
+    void        step();
+    /* Runs whole instructions, servicing interrupts between them, until until_cycle is reached */
+    void        run(uint64_t until_cycle);
+    /* Makes the current run() return once cycle is reached, for device events it must not pass */
+    void        end_run_at(uint64_t cycle);
+    void        reset();
+    /* Interrupt lines, stamped with the cycle the signal was raised on */
+    void        nmi(uint64_t at);
+    void        set_irq(uint8_t source, bool asserted, uint64_t at);
+    uint8_t     get_irq_lines();
     void        handle_flags(uint8_t flags, uint8_t val);
+    /* Only call between run()s. ROM and I/O pages are left out */
+    void        save_state(CPUSnapshot& snap);
+    /* Without memory only registers and interrupt timing load, for callers restoring pages themselves */
+    void        load_state(const CPUSnapshot& snap, bool memory = true);
+    /* Hash of everything save_state() keeps, chained through seed */
+    uint64_t    hash_state(uint64_t seed);
+    
+    /* BUS */
+    inline uint8_t read8(uint16_t addr)
+    {
+        uint8_t* page = this->read_pages[addr >> PAGE_SHIFT];
+        
+        if (page)
+            return page[addr & PAGE_MASK];
+        
+        return this->io_read(addr);
+    }
+    
+    inline void write8(uint16_t addr, uint8_t val)
+    {
+        uint8_t* page = this->write_pages[addr >> PAGE_SHIFT];
+        
+        if (page)
+            page[addr & PAGE_MASK] = val;
+        else
+            this->io_write(addr, val);
+    }
+    
+    uint8_t     io_read(uint16_t addr);
+    void        io_write(uint16_t addr, uint8_t val);
+    void        map_memory(uint8_t first_page, uint8_t last_page, uint8_t* base, bool writable);
+    void        map_io(uint8_t first_page, uint8_t last_page, IODevice* device);
+    /* Without side effects, for debuggers and bindings: nullptr for I/O pages, and ROM for writes */
+    const uint8_t* get_read_page(uint8_t page);
+    uint8_t*    get_write_page(uint8_t page);
+    /* Directly mapped pages are returned in place; I/O pages are read byte by byte into scratch */
+    const uint8_t* read_page(uint8_t page, uint8_t* scratch);
+    /*
+     * Sends every bus access to a page through watcher until unwatch_page(), which can pass
+     * them on with unwatched_read/write. Mapping a watched page changes what those reach.
+     */
+    void        watch_page(uint8_t page, IODevice* watcher);
+    void        unwatch_page(uint8_t page);
+    uint8_t     unwatched_read(uint16_t addr);
+    void        unwatched_write(uint16_t addr, uint8_t val);
+    /* marked_pages[page] != 0 makes run() call hook before each instruction on that page */
+    void        set_exec_hook(ExecHook* hook, const uint8_t* marked_pages);
+    /* Records every instruction into tracer until set back to nullptr */
+    void        set_tracer(Tracer* tracer);
+    /* Counts every instruction into counters until set back to nullptr */
+    void        set_counters(ExecCounters* counters);
+    /* Samples the guest's call stack into profiler until set back to nullptr */
+    void        set_profiler(Profiler* profiler);
+    /* Marks every NMI and IRQ taken on timeline */
+    void        set_timeline(Timeline* timeline);
+    /* Opcodes run as NOPs because they are not official instructions */
+    uint64_t    get_nonstandard_opcodes();
+    
+    uint64_t    get_cycles();
+    void        set_cycles(uint64_t cycles);
+    void        stall(uint64_t cycles);
     
     /* STACK */
     void        push8(uint8_t val);
@@ -0,0 +1,119 @@
+#include "debugger.h"
+
+Debugger::Debugger(CPU& cpu) :
+    cpu(cpu)
+{
+}
+
+Debugger::~Debugger()
+{
+    this->clear();
+}
+
+void Debugger::report(DebugEventKind kind, uint16_t addr, uint8_t val)
+{
+    this->hits++;
+
+    if (this->handler)
+        this->handler({ kind, addr, val, this->cpu.get_pc(), this->cpu.get_cycles() });
+}
+
+void Debugger::add_watchpoint(uint16_t addr, uint8_t kind)
+{
+    uint8_t page = addr >> PAGE_SHIFT;
+
+    if (!(kind & WATCH_ACCESS))
+        return;
+
+    if (!this->watches[addr] && this->page_watches[page]++ == 0)
+        this->cpu.watch_page(page, this);
+
+    this->watches[addr] |= kind & WATCH_ACCESS;
+}
+
+void Debugger::remove_watchpoint(uint16_t addr)
+{
+    uint8_t page = addr >> PAGE_SHIFT;
+
+    if (!this->watches[addr])
+        return;
+
+    this->watches[addr] = 0;
+
+    /* Last one on the page: accesses go straight to memory again */
+    if (--this->page_watches[page] == 0)
+        this->cpu.unwatch_page(page);
+}
+
+void Debugger::add_breakpoint(uint16_t addr)
+{
+    uint8_t page = addr >> PAGE_SHIFT;
+
+    if (this->breakpoints[addr])
+        return;
+
+    this->breakpoints[addr] = true;
+    this->page_breakpoints[page]++;
+    this->exec_marks[page] = 1;
+
+    if (this->num_breakpoints++ == 0)
+        this->cpu.set_exec_hook(this, this->exec_marks);
+}
+
+void Debugger::remove_breakpoint(uint16_t addr)
+{
+    uint8_t page = addr >> PAGE_SHIFT;
+
+    if (!this->breakpoints[addr])
+        return;
+
+    this->breakpoints[addr] = false;
+
+    if (--this->page_breakpoints[page] == 0)
+        this->exec_marks[page] = 0;
+
+    if (--this->num_breakpoints == 0)
+        this->cpu.set_exec_hook(nullptr, nullptr);
+}
+
+void Debugger::clear()
+{
+    for (size_t addr = 0; addr < ADDRESS_SPACE_SIZE; addr++) {
+        this->remove_watchpoint(addr);
+        this->remove_breakpoint(addr);
+    }
+}
+
+void Debugger::set_handler(const DebugHandler& handler)
+{
+    this->handler = handler;
+}
+
+uint64_t Debugger::get_hits()
+{
+    return this->hits;
+}
+
+uint8_t Debugger::io_read(uint16_t addr)
+{
+    uint8_t val = this->cpu.unwatched_read(addr);
+
+    if (this->watches[addr] & WATCH_READ)
+        this->report(DEBUG_WATCH_READ, addr, val);
+
+    return val;
+}
+
+void Debugger::io_write(uint16_t addr, uint8_t val)
+{
+    if (this->watches[addr] & WATCH_WRITE)
+        this->report(DEBUG_WATCH_WRITE, addr, val);
+
+    this->cpu.unwatched_write(addr, val);
+}
+
+void Debugger::before_exec(uint16_t pc)
+{
+    if (this->breakpoints[pc])
+        this->report(DEBUG_BREAKPOINT, pc, 0);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "bus.h"
+#include "cpu.h"
+
+using namespace std;
+
+const size_t ADDRESS_SPACE_SIZE = 0x10000;
+
+enum WatchKind : uint8_t {
+    WATCH_READ      = 1 << 0,
+    WATCH_WRITE     = 1 << 1,
+    WATCH_ACCESS    = WATCH_READ | WATCH_WRITE
+};
+
+enum DebugEventKind {
+    DEBUG_BREAKPOINT,
+    DEBUG_WATCH_READ,
+    DEBUG_WATCH_WRITE
+};
+
+struct DebugEvent {
+    DebugEventKind  kind;
+    uint16_t        addr;
+    uint8_t         val;    // Value read or written; 0 for breakpoints
+    uint16_t        pc;     // Breakpoints: the instruction. Watchpoints: past the accessing one's operands
+    uint64_t        cycle;  // Watchpoints: with the accessing instruction's base cycles charged
+};
+
+/* Called on the emulation thread; it may block to pause the CPU at that point */
+typedef function<void(const DebugEvent& event)> DebugHandler;
+
+/*
+ * Watchpoints and breakpoints that cost nothing where none are set. A page holding a
+ * watchpoint is routed through the debugger like an I/O page, so accesses to every other page
+ * stay direct. Breakpoints mark their page, and the CPU only switches to its checking loop
+ * while at least one page is marked. Instruction operand fetches and stack accesses are not
+ * bus accesses here, so they do not trigger watchpoints.
+ */
+class Debugger : public IODevice, public ExecHook
+{
+private:
+    CPU&            cpu;
+    uint8_t         watches[ADDRESS_SPACE_SIZE] = {};
+    uint16_t        page_watches[NUM_PAGES] = {};
+    bool            breakpoints[ADDRESS_SPACE_SIZE] = {};
+    uint16_t        page_breakpoints[NUM_PAGES] = {};
+    uint8_t         exec_marks[NUM_PAGES] = {};         // Pages with a breakpoint, for the CPU
+    size_t          num_breakpoints = 0;
+    DebugHandler    handler;
+    uint64_t        hits = 0;
+
+    void            report(DebugEventKind kind, uint16_t addr, uint8_t val);
+
+public:
+    Debugger(CPU& cpu);
+    ~Debugger();
+
+    Debugger(const Debugger&) = delete;
+    Debugger& operator=(const Debugger&) = delete;
+
+    void            add_watchpoint(uint16_t addr, uint8_t kind = WATCH_ACCESS);
+    void            remove_watchpoint(uint16_t addr);
+    void            add_breakpoint(uint16_t addr);
+    void            remove_breakpoint(uint16_t addr);
+    void            clear();
+
+    void            set_handler(const DebugHandler& handler);
+    uint64_t        get_hits();
+
+    uint8_t         io_read(uint16_t addr) override;
+    void            io_write(uint16_t addr, uint8_t val) override;
+    void            before_exec(uint16_t pc) override;
+};
@@ -0,0 +1,169 @@
+#include "frontend.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "timeline.h"
+
+FrontendServer::FrontendServer()
+{
+    this->memory_fd = memfd_create("nes-frontend", 0);
+    this->frame_fd = eventfd(0, 0);
+
+    if (this->memory_fd < 0 || this->frame_fd < 0 || ftruncate(this->memory_fd, sizeof(FrontendShared)) < 0) {
+        cerr << "ERROR: Could not create frontend segment: " << strerror(errno) << ".\n";
+        return;
+    }
+
+    void* mem = mmap(nullptr, sizeof(FrontendShared), PROT_READ | PROT_WRITE, MAP_SHARED, this->memory_fd, 0);
+
+    if (mem == MAP_FAILED) {
+        cerr << "ERROR: Could not map frontend segment: " << strerror(errno) << ".\n";
+        return;
+    }
+
+    this->shared = new (mem) FrontendShared();
+    memcpy(this->shared->magic, FRONTEND_MAGIC, sizeof(FRONTEND_MAGIC));
+    this->shared->version = FRONTEND_VERSION;
+    this->shared->size = sizeof(FrontendShared);
+}
+
+FrontendServer::~FrontendServer()
+{
+    if (this->shared)
+        munmap(this->shared, sizeof(FrontendShared));
+    if (this->memory_fd >= 0)
+        close(this->memory_fd);
+    if (this->frame_fd >= 0)
+        close(this->frame_fd);
+}
+
+bool FrontendServer::is_open()
+{
+    return this->shared != nullptr;
+}
+
+int FrontendServer::get_memory_fd()
+{
+    return this->memory_fd;
+}
+
+int FrontendServer::get_frame_fd()
+{
+    return this->frame_fd;
+}
+
+uint8_t* FrontendServer::next_target()
+{
+    return this->shared->video.get_back().pixels;
+}
+
+void FrontendServer::present_target(uint64_t frame)
+{
+    SharedFrame& back = this->shared->video.get_back();
+    back.frame = frame;
+    back.published_ns = Timeline::now();
+    this->shared->video.publish();
+
+    uint64_t one = 1;
+    if (write(this->frame_fd, &one, sizeof(one)) < 0)
+        cerr << "ERROR: Could not signal frontend: " << strerror(errno) << ".\n";
+}
+
+size_t FrontendServer::write_audio(const int16_t* samples, size_t count)
+{
+    return this->shared->audio.push(samples, count);
+}
+
+size_t FrontendServer::get_audio_depth()
+{
+    return this->shared->audio.size();
+}
+
+void FrontendServer::poll_input(Controllers& controllers)
+{
+    FrontendInput input;
+
+    while (this->shared->input.pop(input))
+        controllers.push_now(input.port, input.buttons);
+}
+
+FrontendClient::FrontendClient(int memory_fd, int frame_fd) :
+    frame_fd(frame_fd)
+{
+    struct stat st;
+    void* mem = MAP_FAILED;
+
+    if (fstat(memory_fd, &st) == 0 && (size_t) st.st_size >= sizeof(FrontendShared))
+        mem = mmap(nullptr, sizeof(FrontendShared), PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+    close(memory_fd);
+
+    if (mem == MAP_FAILED) {
+        cerr << "ERROR: Could not map frontend segment.\n";
+        return;
+    }
+
+    this->shared = (FrontendShared*) mem;
+
+    if (memcmp(this->shared->magic, FRONTEND_MAGIC, sizeof(FRONTEND_MAGIC)) != 0 ||
+        this->shared->version != FRONTEND_VERSION || this->shared->size != sizeof(FrontendShared))
+    {
+        cerr << "ERROR: Not a version " << FRONTEND_VERSION << " frontend segment.\n";
+        munmap(mem, sizeof(FrontendShared));
+        this->shared = nullptr;
+    }
+}
+
+FrontendClient::~FrontendClient()
+{
+    if (this->shared)
+        munmap(this->shared, sizeof(FrontendShared));
+    close(this->frame_fd);
+}
+
+bool FrontendClient::is_open()
+{
+    return this->shared != nullptr;
+}
+
+const SharedFrame* FrontendClient::wait_frame(int timeout_ms)
+{
+    uint64_t deadline = Timeline::now() + (uint64_t) timeout_ms * 1000000;
+
+    for (;;) {
+        if (this->shared->video.acquire())
+            return &this->shared->video.get_front();
+
+        uint64_t now = Timeline::now();
+        if (now >= deadline && timeout_ms >= 0)
+            return nullptr;
+
+        /* The count only says something was presented since the last read; acquire() says what */
+        struct pollfd pfd = { this->frame_fd, POLLIN, 0 };
+        int wait = timeout_ms < 0 ? -1 : (int) ((deadline - now + 999999) / 1000000);
+
+        if (poll(&pfd, 1, wait) > 0) {
+            uint64_t count;
+            if (read(this->frame_fd, &count, sizeof(count)) < 0)
+                return nullptr;
+        }
+    }
+}
+
+size_t FrontendClient::read_audio(int16_t* samples, size_t count)
+{
+    return this->shared->audio.pop(samples, count);
+}
+
+bool FrontendClient::set_buttons(uint8_t port, uint8_t buttons)
+{
+    return this->shared->input.push({ port, buttons });
+}
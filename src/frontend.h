@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+#include "input.h"
+#include "output.h"
+#include "renderer.h"
+#include "spsc_ring.h"
+
+using namespace std;
+
+const char FRONTEND_MAGIC[8] = { 'N', 'E', 'S', 'F', 'R', 'O', 'N', 'T' };
+const uint32_t FRONTEND_VERSION = 1;
+const size_t FRONTEND_AUDIO_SIZE = 1 << 14;
+const size_t FRONTEND_INPUT_SIZE = 64;
+
+/* A frame as the core left it, stamped with the host time it was finished */
+struct SharedFrame {
+    uint64_t    frame;
+    uint64_t    published_ns;   // Steady clock, which is CLOCK_MONOTONIC and so shared by processes
+    uint8_t     pixels[FRAME_PIXELS];
+};
+
+struct FrontendInput {
+    uint8_t     port;
+    uint8_t     buttons;
+};
+
+/*
+ * The memfd-backed segment shared by the core and one frontend process. Each part has a single
+ * producer and a single consumer, so the lock-free rings used between threads work unchanged
+ * between processes: video is a triple buffer the core renders into, audio and input are rings.
+ */
+struct FrontendShared {
+    char                                        magic[8];
+    uint32_t                                    version;
+    uint32_t                                    size;
+    TripleBuffer<SharedFrame>                   video;
+    SpscRing<int16_t, FRONTEND_AUDIO_SIZE>      audio;
+    SpscRing<FrontendInput, FRONTEND_INPUT_SIZE> input;
+};
+
+/*
+ * Core side. The PPU renders straight into the segment's back buffer, so presenting a frame is
+ * an index swap and an eventfd write. Hand get_memory_fd() and get_frame_fd() to the frontend
+ * process, by inheritance or over a Unix socket.
+ */
+class FrontendServer : public FrameTarget
+{
+private:
+    int                 memory_fd = -1;
+    int                 frame_fd = -1;
+    FrontendShared*     shared = nullptr;
+
+public:
+    FrontendServer();
+    ~FrontendServer();
+
+    FrontendServer(const FrontendServer&) = delete;
+    FrontendServer& operator=(const FrontendServer&) = delete;
+
+    bool                is_open();
+    int                 get_memory_fd();
+    /* Becomes readable whenever a frame has been presented */
+    int                 get_frame_fd();
+
+    uint8_t*            next_target() override;
+    void                present_target(uint64_t frame) override;
+
+    /* Samples that do not fit are dropped; returns how many were queued */
+    size_t              write_audio(const int16_t* samples, size_t count);
+    size_t              get_audio_depth();
+    /* Applies every button change the frontend has sent since the last call */
+    void                poll_input(Controllers& controllers);
+};
+
+/* Frontend side, in the consuming process. Takes ownership of both descriptors */
+class FrontendClient
+{
+private:
+    int                 frame_fd;
+    FrontendShared*     shared = nullptr;
+
+public:
+    FrontendClient(int memory_fd, int frame_fd);
+    ~FrontendClient();
+
+    FrontendClient(const FrontendClient&) = delete;
+    FrontendClient& operator=(const FrontendClient&) = delete;
+
+    bool                is_open();
+    /* Newest frame not yet seen, waiting up to timeout_ms for one; nullptr on timeout */
+    const SharedFrame*  wait_frame(int timeout_ms);
+    size_t              read_audio(int16_t* samples, size_t count);
+    bool                set_buttons(uint8_t port, uint8_t buttons);
+};
@@ -0,0 +1,139 @@
+#include "fuzz.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint8_t STACK_PAGE = STACK_ADDR >> PAGE_SHIFT;
+
+FuzzHarness::FuzzHarness(uint8_t* coverage) :
+    bare_cpu(new CPU()),
+    cpu(bare_cpu.get()),
+    start(new NESSnapshot()),
+    coverage(coverage)
+{
+    this->arm();
+}
+
+FuzzHarness::FuzzHarness(ROM& rom, unsigned start_frames, uint8_t* coverage) :
+    nes(new NES()),
+    cpu(&nes->get_cpu()),
+    start(new NESSnapshot()),
+    coverage(coverage)
+{
+    this->nes->load(rom);
+
+    for (unsigned f = 0; f < start_frames; f++)
+        this->nes->emulate_frame(false, false);
+
+    this->arm();
+}
+
+FuzzHarness::~FuzzHarness()
+{
+}
+
+void FuzzHarness::arm()
+{
+    if (this->nes)
+        this->nes->save_state(*this->start);
+    else
+        this->cpu->save_state(this->start->cpu);
+
+    for (size_t page = 0; page < NUM_PAGES; page++) {
+        this->pages[page] = this->cpu->get_write_page(page);
+
+        if (this->pages[page] && page != STACK_PAGE)
+            this->cpu->watch_page(page, this);
+    }
+
+    if (this->coverage) {
+        memset(this->exec_marks, 1, sizeof(this->exec_marks));
+        this->cpu->set_exec_hook(this, this->exec_marks);
+    }
+}
+
+void FuzzHarness::restore()
+{
+    /* Pushes and pulls go straight to the stack page, never through the bus, so it is always copied */
+    memcpy(this->pages[STACK_PAGE], &this->start->cpu.mem[STACK_ADDR], PAGE_SIZE);
+
+    for (uint8_t page : this->dirty) {
+        memcpy(this->pages[page], &this->start->cpu.mem[page << PAGE_SHIFT], PAGE_SIZE);
+        this->cpu->watch_page(page, this);
+    }
+
+    this->stats.pages_restored += this->dirty.size();
+    this->dirty.clear();
+
+    this->cpu->load_state(this->start->cpu, false);
+
+    if (this->nes) {
+        this->nes->get_ppu().load_state(this->start->ppu);
+        this->nes->get_apu().load_state(this->start->apu);
+        this->nes->get_controllers().load_state(this->start->controllers);
+    }
+}
+
+void FuzzHarness::run(const uint8_t* data, size_t size)
+{
+    this->restore();
+    this->prev_pc = 0;
+    this->stats.execs++;
+
+    if (!this->nes) {
+        size = min(size, FUZZ_MAX_CODE);
+        for (size_t i = 0; i < size; i++)
+            this->cpu->write8(FUZZ_CODE_ADDR + i, data[i]);
+
+        this->cpu->set_pc(FUZZ_CODE_ADDR);
+        this->cpu->run(this->cpu->get_cycles() + FUZZ_CPU_CYCLES);
+        return;
+    }
+
+    size = min(size, FUZZ_MAX_FRAMES);
+    for (size_t i = 0; i < size; i++) {
+        this->nes->get_controllers().set_buttons(0, data[i]);
+        this->nes->emulate_frame(false, false);
+    }
+}
+
+size_t FuzzHarness::get_dirty_count()
+{
+    return this->dirty.size();
+}
+
+const FuzzStats& FuzzHarness::get_stats()
+{
+    return this->stats;
+}
+
+CPU& FuzzHarness::get_cpu()
+{
+    return *this->cpu;
+}
+
+NES* FuzzHarness::get_nes()
+{
+    return this->nes.get();
+}
+
+uint8_t FuzzHarness::io_read(uint16_t addr)
+{
+    return this->cpu->unwatched_read(addr);
+}
+
+/* The first write to a page since the last restore: remember it and get out of the way */
+void FuzzHarness::io_write(uint16_t addr, uint8_t val)
+{
+    uint8_t page = addr >> PAGE_SHIFT;
+
+    this->cpu->unwatch_page(page);
+    this->dirty.push_back(page);
+    this->cpu->write8(addr, val);
+}
+
+void FuzzHarness::before_exec(uint16_t pc)
+{
+    this->coverage[(pc ^ this->prev_pc) & (COVERAGE_MAP_SIZE - 1)]++;
+    this->prev_pc = pc >> 1;
+}
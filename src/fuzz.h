@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "nes.h"
+
+using namespace std;
+
+/* AFL-style edge coverage: one counter per hashed (previous PC, PC) pair */
+const size_t COVERAGE_MAP_SIZE = 1 << 16;
+
+/* CPU target: the input is code, copied to FUZZ_CODE_ADDR and run for FUZZ_CPU_CYCLES */
+const uint16_t FUZZ_CODE_ADDR = 0x0200;
+const size_t FUZZ_MAX_CODE = 0x0600;
+const uint64_t FUZZ_CPU_CYCLES = 10000;
+/* NES target: the input is controller 1's buttons, one byte per frame */
+const size_t FUZZ_MAX_FRAMES = 300;
+
+struct FuzzStats {
+    uint64_t    execs;
+    uint64_t    pages_restored;
+};
+
+/*
+ * Persistent-mode fuzzing: one machine runs input after input, and is put back in its start
+ * state between them by copying back only the pages the last input wrote. Every writable page
+ * starts out watched; the first write to one marks it dirty and unwatches it, so later accesses
+ * run at full speed, and restoring re-arms it. The stack page is copied back every time. Guest
+ * edges are counted into a caller-owned map, which a libFuzzer build places among its extra
+ * counters. Not for use with a Debugger, which watches pages too.
+ */
+class FuzzHarness : public IODevice, public ExecHook
+{
+private:
+    unique_ptr<CPU>             bare_cpu;
+    unique_ptr<NES>             nes;
+    CPU*                        cpu;
+    unique_ptr<NESSnapshot>     start;
+    uint8_t*                    pages[NUM_PAGES] = {};  // Writable pages, for restoring in place
+    vector<uint8_t>             dirty;
+    uint8_t                     exec_marks[NUM_PAGES];
+    uint8_t*                    coverage;
+    uint16_t                    prev_pc = 0;
+    FuzzStats                   stats = {};
+
+    void        arm();
+    void        restore();
+
+public:
+    /* Fuzzes a bare CPU with flat memory. A null coverage map runs without the coverage hook */
+    FuzzHarness(uint8_t* coverage);
+    /* Fuzzes the console's controller input, from start_frames frames after power-on */
+    FuzzHarness(ROM& rom, unsigned start_frames, uint8_t* coverage);
+    ~FuzzHarness();
+
+    FuzzHarness(const FuzzHarness&) = delete;
+    FuzzHarness& operator=(const FuzzHarness&) = delete;
+
+    /* Restores the start state and runs one input; the machine is left as the input left it */
+    void        run(const uint8_t* data, size_t size);
+    /* Pages the last input wrote, which the next run() copies back */
+    size_t      get_dirty_count();
+    const FuzzStats& get_stats();
+
+    CPU&        get_cpu();
+    /* nullptr for the CPU target */
+    NES*        get_nes();
+
+    uint8_t     io_read(uint16_t addr) override;
+    void        io_write(uint16_t addr, uint8_t val) override;
+    void        before_exec(uint16_t pc) override;
+};
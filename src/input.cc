@@ -0,0 +1,158 @@
+#include "input.h"
+
+#include <cstring>
+
+#include "state_hash.h"
+
+const uint64_t NO_INPUT_STAMP = UINT64_MAX;
+
+Controllers::Controllers() :
+    now(0),
+    dropped(0)
+{
+    for (size_t i = 0; i < NUM_JOYPADS; i++)
+        this->unread_since[i] = this->latched_since[i] = NO_INPUT_STAMP;
+}
+
+bool Controllers::push(uint8_t port, uint8_t buttons, uint64_t cycle)
+{
+    if (!this->queue.push({ cycle, port, buttons })) {
+        this->dropped.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+bool Controllers::push_now(uint8_t port, uint8_t buttons)
+{
+    return this->push(port, buttons, this->now.load(memory_order_acquire));
+}
+
+void Controllers::publish_cycle(uint64_t cycle)
+{
+    this->now.store(cycle, memory_order_release);
+}
+
+void Controllers::apply_until(uint64_t cycle)
+{
+    InputEvent e;
+
+    if (this->frozen)
+        return;
+
+    /* Events are queued in cycle order, so the first one still in the future ends the drain */
+    while (this->queue.peek(e) && e.cycle <= cycle) {
+        this->queue.pop(e);
+
+        if (e.port >= NUM_JOYPADS)
+            continue;
+
+        this->buttons[e.port] = e.buttons;
+        this->unread_since[e.port] = e.cycle;
+        this->stats.events_applied++;
+    }
+}
+
+void Controllers::latch(uint8_t port)
+{
+    this->shift[port] = this->buttons[port];
+
+    if (this->unread_since[port] != NO_INPUT_STAMP) {
+        this->latched_since[port] = this->unread_since[port];
+        this->unread_since[port] = NO_INPUT_STAMP;
+    }
+}
+
+void Controllers::write_strobe(uint8_t val, uint64_t cycle)
+{
+    this->apply_until(cycle);
+
+    bool strobe = val & JOYPAD_STROBE;
+
+    /* The shift registers load on the falling edge */
+    if (this->strobe && !strobe) {
+        for (uint8_t port = 0; port < NUM_JOYPADS; port++)
+            this->latch(port);
+    }
+
+    this->strobe = strobe;
+}
+
+uint8_t Controllers::read(uint8_t port, uint64_t cycle)
+{
+    this->apply_until(cycle);
+
+    /* While strobe is high the register keeps reloading, so reads return the live A button */
+    if (this->strobe)
+        this->latch(port);
+
+    uint8_t bit = this->shift[port] & 1;
+
+    if (!this->strobe)
+        this->shift[port] = (this->shift[port] >> 1) | 0x80; // Official pads return 1 after 8 reads
+
+    if (this->latched_since[port] != NO_INPUT_STAMP) {
+        uint64_t latency = cycle - this->latched_since[port];
+        this->latched_since[port] = NO_INPUT_STAMP;
+        this->stats.latency_samples++;
+        this->stats.total_latency += latency;
+        this->stats.last_latency = latency;
+        if (latency > this->stats.max_latency)
+            this->stats.max_latency = latency;
+    }
+
+    return JOYPAD_OPEN_BUS | bit;
+}
+
+void Controllers::set_buttons(uint8_t port, uint8_t buttons)
+{
+    this->buttons[port] = buttons;
+}
+
+void Controllers::set_frozen(bool frozen)
+{
+    this->frozen = frozen;
+}
+
+void Controllers::save_state(ControllerSnapshot& snap)
+{
+    memcpy(snap.buttons, this->buttons, sizeof(snap.buttons));
+    memcpy(snap.shift, this->shift, sizeof(snap.shift));
+    snap.strobe = this->strobe;
+    memcpy(snap.unread_since, this->unread_since, sizeof(snap.unread_since));
+    memcpy(snap.latched_since, this->latched_since, sizeof(snap.latched_since));
+    snap.stats = this->stats;
+}
+
+void Controllers::load_state(const ControllerSnapshot& snap)
+{
+    memcpy(this->buttons, snap.buttons, sizeof(this->buttons));
+    memcpy(this->shift, snap.shift, sizeof(this->shift));
+    this->strobe = snap.strobe;
+    memcpy(this->unread_since, snap.unread_since, sizeof(this->unread_since));
+    memcpy(this->latched_since, snap.latched_since, sizeof(this->latched_since));
+    this->stats = snap.stats;
+}
+
+uint64_t Controllers::hash_state(uint64_t seed)
+{
+    uint64_t ports = this->strobe;
+
+    for (size_t i = 0; i < NUM_JOYPADS; i++)
+        ports |= (uint64_t) this->shift[i] << (8 * (i + 1));
+
+    return hash_word(ports, seed);
+}
+
+uint8_t Controllers::get_buttons(uint8_t port)
+{
+    return this->buttons[port];
+}
+
+InputStats Controllers::get_stats()
+{
+    InputStats stats = this->stats;
+    stats.events_dropped = this->dropped.load(memory_order_relaxed);
+    return stats;
+}
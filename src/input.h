@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "spsc_ring.h"
+
+using namespace std;
+
+const uint16_t JOYPAD1 = 0x4016;
+const uint16_t JOYPAD2 = 0x4017;
+const size_t NUM_JOYPADS = 2;
+const size_t INPUT_QUEUE_SIZE = 256;
+const uint8_t JOYPAD_STROBE = 0x01;
+const uint8_t JOYPAD_OPEN_BUS = 0x40;
+
+enum Button : uint8_t {
+    BUTTON_A        = 1 << 0,
+    BUTTON_B        = 1 << 1,
+    BUTTON_SELECT   = 1 << 2,
+    BUTTON_START    = 1 << 3,
+    BUTTON_UP       = 1 << 4,
+    BUTTON_DOWN     = 1 << 5,
+    BUTTON_LEFT     = 1 << 6,
+    BUTTON_RIGHT    = 1 << 7
+};
+
+/* New button state for a port, taking effect from CPU cycle on. Queue events in cycle order */
+struct InputEvent {
+    uint64_t    cycle;
+    uint8_t     port;
+    uint8_t     buttons;
+};
+
+struct InputStats {
+    uint64_t    events_applied;
+    uint64_t    events_dropped;     // Queue full
+    uint64_t    latency_samples;
+    uint64_t    total_latency;      // CPU cycles from an event's stamp to the first read that saw it
+    uint64_t    max_latency;
+    uint64_t    last_latency;
+};
+
+/* Port state without the queue, which belongs to the host */
+struct ControllerSnapshot {
+    uint8_t     buttons[NUM_JOYPADS];
+    uint8_t     shift[NUM_JOYPADS];
+    bool        strobe;
+    uint64_t    unread_since[NUM_JOYPADS];
+    uint64_t    latched_since[NUM_JOYPADS];
+    InputStats  stats;
+};
+
+/*
+ * The two standard controllers behind 0x4016/0x4017. A host thread queues button changes at
+ * any time without locking; the core drains the queue up to the current cycle whenever the
+ * game strobes or reads a port, so every read sees the newest state rather than the one
+ * sampled at the last frame boundary.
+ */
+class Controllers
+{
+private:
+    SpscRing<InputEvent, INPUT_QUEUE_SIZE>  queue;
+    atomic<uint64_t>    now;                // Last cycle published by the core, for push_now()
+    atomic<uint64_t>    dropped;
+    uint8_t             buttons[NUM_JOYPADS] = {};
+    uint8_t             shift[NUM_JOYPADS] = {};
+    bool                strobe = false;
+    bool                frozen = false;
+    uint64_t            unread_since[NUM_JOYPADS];     // Stamp of the newest event no latch has seen
+    uint64_t            latched_since[NUM_JOYPADS];    // ...and of the latched one no read has seen
+    InputStats          stats = {};
+
+    void                apply_until(uint64_t cycle);
+    void                latch(uint8_t port);
+
+public:
+    Controllers();
+
+    /* Host side, single producer: never blocks, returns false if the queue is full */
+    bool                push(uint8_t port, uint8_t buttons, uint64_t cycle);
+    bool                push_now(uint8_t port, uint8_t buttons);
+
+    /* Core side; get_stats() too */
+    void                publish_cycle(uint64_t cycle);
+    void                write_strobe(uint8_t val, uint64_t cycle);
+    uint8_t             read(uint8_t port, uint64_t cycle);
+    /* Replaces a port's buttons straight away, for callers that drive input frame by frame */
+    void                set_buttons(uint8_t port, uint8_t buttons);
+    /* While frozen the queue is left alone and reads see the buttons as they were */
+    void                set_frozen(bool frozen);
+    void                save_state(ControllerSnapshot& snap);
+    void                load_state(const ControllerSnapshot& snap);
+    /* Only what the game can observe: the shift registers and strobe, not the host's buttons */
+    uint64_t            hash_state(uint64_t seed);
+
+    uint8_t             get_buttons(uint8_t port);
+    InputStats          get_stats();
+};
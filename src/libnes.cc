@@ -0,0 +1,226 @@
+#include "libnes.h"
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "nes.h"
+
+const char NES_STATE_MAGIC[8] = { 'N', 'E', 'S', 'S', 'T', 'A', 'T', 'E' };
+
+/* Prefixed to the snapshot in a caller's state buffer; 16 bytes keeps the snapshot aligned */
+struct StateHeader {
+    char        magic[8];
+    uint32_t    abi_version;
+    uint32_t    snapshot_size;
+};
+
+static_assert(sizeof(StateHeader) == 16, "state header must keep the snapshot 8-byte aligned");
+static_assert(is_trivially_copyable<NESSnapshot>::value, "states are saved straight into caller memory");
+static_assert(NES_FRAME_WIDTH == FRAME_WIDTH && NES_FRAME_HEIGHT == FRAME_HEIGHT, "frame size mismatch");
+static_assert(NES_NUM_PORTS == NUM_JOYPADS, "port count mismatch");
+
+struct nes {
+    NES         console;
+};
+
+static bool aligned(const void* p)
+{
+    return ((uintptr_t) p & 7) == 0;
+}
+
+uint32_t nes_abi_version(void)
+{
+    return NES_ABI_VERSION;
+}
+
+const char* nes_status_string(int status)
+{
+    switch (status) {
+        case NES_OK:                return "ok";
+        case NES_ERROR_ARGUMENT:    return "invalid argument";
+        case NES_ERROR_ROM:         return "could not load ROM";
+        case NES_ERROR_STATE:       return "invalid state buffer";
+        default:                    return "unknown status";
+    }
+}
+
+nes_t* nes_create(const char* rom_path)
+{
+    if (!rom_path)
+        return nullptr;
+
+    ROM rom = ROM(rom_path);
+    if (!rom.is_valid())
+        return nullptr;
+
+    nes_t* nes = new (nothrow) nes_t();
+    if (nes && !nes->console.load(rom)) {
+        delete nes;
+        return nullptr;
+    }
+
+    return nes;
+}
+
+nes_t* nes_create_from(const nes_t* other)
+{
+    if (!other)
+        return nullptr;
+
+    nes_t* nes = new (nothrow) nes_t();
+    if (nes) {
+        nes->console.copy_cartridge(other->console);
+        nes->console.get_cpu().reset();
+    }
+
+    return nes;
+}
+
+void nes_destroy(nes_t* nes)
+{
+    delete nes;
+}
+
+int nes_run_frames(nes_t* nes, uint32_t count, const uint8_t* buttons, uint32_t flags)
+{
+    if (!nes)
+        return NES_ERROR_ARGUMENT;
+
+    Controllers& pads = nes->console.get_controllers();
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (buttons) {
+            for (uint8_t port = 0; port < NES_NUM_PORTS; port++)
+                pads.set_buttons(port, buttons[i * NES_NUM_PORTS + port]);
+        }
+
+        nes->console.emulate_frame(!(flags & NES_RUN_NO_VIDEO), !(flags & NES_RUN_NO_AUDIO));
+    }
+
+    return NES_OK;
+}
+
+int nes_read_memory(nes_t* nes, uint16_t addr, uint8_t* out, size_t size)
+{
+    if (!nes || (!out && size) || addr + size > 0x10000)
+        return NES_ERROR_ARGUMENT;
+
+    CPU& cpu = nes->console.get_cpu();
+
+    /* A page at a time: one memcpy per mapped page, zeros for I/O */
+    for (size_t done = 0, n; done < size; done += n) {
+        size_t at = addr + done;
+        n = min(PAGE_SIZE - (at & PAGE_MASK), size - done);
+        const uint8_t* page = cpu.get_read_page(at >> PAGE_SHIFT);
+
+        if (page)
+            memcpy(out + done, page + (at & PAGE_MASK), n);
+        else
+            memset(out + done, 0, n);
+    }
+
+    return NES_OK;
+}
+
+int nes_write_memory(nes_t* nes, uint16_t addr, const uint8_t* data, size_t size)
+{
+    if (!nes || (!data && size) || addr + size > 0x10000)
+        return NES_ERROR_ARGUMENT;
+
+    CPU& cpu = nes->console.get_cpu();
+
+    for (size_t done = 0, n; done < size; done += n) {
+        size_t at = addr + done;
+        n = min(PAGE_SIZE - (at & PAGE_MASK), size - done);
+        uint8_t* page = cpu.get_write_page(at >> PAGE_SHIFT);
+
+        if (page)
+            memcpy(page + (at & PAGE_MASK), data + done, n);
+    }
+
+    return NES_OK;
+}
+
+int nes_get_regs(nes_t* nes, nes_regs_t* regs)
+{
+    if (!nes || !regs)
+        return NES_ERROR_ARGUMENT;
+
+    CPU& cpu = nes->console.get_cpu();
+    regs->a = cpu.get_a();
+    regs->x = cpu.get_x();
+    regs->y = cpu.get_y();
+    regs->s = cpu.get_s();
+    regs->p = cpu.get_p();
+    regs->pc = cpu.get_pc();
+    regs->cycles = cpu.get_cycles();
+    return NES_OK;
+}
+
+int nes_set_regs(nes_t* nes, const nes_regs_t* regs)
+{
+    if (!nes || !regs)
+        return NES_ERROR_ARGUMENT;
+
+    CPU& cpu = nes->console.get_cpu();
+    cpu.set_a(regs->a);
+    cpu.set_x(regs->x);
+    cpu.set_y(regs->y);
+    cpu.set_s(regs->s);
+    cpu.set_p(regs->p);
+    cpu.set_pc(regs->pc);
+    return NES_OK;
+}
+
+size_t nes_state_size(void)
+{
+    return sizeof(StateHeader) + sizeof(NESSnapshot);
+}
+
+int nes_save_state(nes_t* nes, void* buffer, size_t size)
+{
+    if (!nes || !buffer)
+        return NES_ERROR_ARGUMENT;
+    if (size < nes_state_size() || !aligned(buffer))
+        return NES_ERROR_STATE;
+
+    StateHeader* header = (StateHeader*) buffer;
+    memcpy(header->magic, NES_STATE_MAGIC, sizeof(NES_STATE_MAGIC));
+    header->abi_version = NES_ABI_VERSION;
+    header->snapshot_size = sizeof(NESSnapshot);
+
+    nes->console.save_state(*(NESSnapshot*) (header + 1));
+    return NES_OK;
+}
+
+int nes_load_state(nes_t* nes, const void* buffer, size_t size)
+{
+    if (!nes || !buffer)
+        return NES_ERROR_ARGUMENT;
+    if (size < nes_state_size() || !aligned(buffer))
+        return NES_ERROR_STATE;
+
+    const StateHeader* header = (const StateHeader*) buffer;
+    if (memcmp(header->magic, NES_STATE_MAGIC, sizeof(NES_STATE_MAGIC)) != 0 ||
+        header->abi_version != NES_ABI_VERSION || header->snapshot_size != sizeof(NESSnapshot))
+    {
+        return NES_ERROR_STATE;
+    }
+
+    nes->console.load_state(*(const NESSnapshot*) (header + 1));
+    return NES_OK;
+}
+
+const uint8_t* nes_frame_buffer(nes_t* nes)
+{
+    return nes ? nes->console.get_ppu().get_frame_buffer() : nullptr;
+}
+
+size_t nes_read_audio(nes_t* nes, int16_t* out, size_t max)
+{
+    if (!nes || !out)
+        return 0;
+
+    return nes->console.get_output().read_audio(out, max);
+}
@@ -0,0 +1,84 @@
+/*
+ * C interface to bin/libnes.so, for FFI consumers. Every call works on whole ranges, frames or
+ * states, so the number of calls across the boundary follows the work, not the bytes; memory
+ * always belongs to the caller. Valid C and C++.
+ */
+#ifndef LIBNES_H
+#define LIBNES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NES_API __attribute__((visibility("default")))
+
+/* Bumped whenever a signature or struct below changes incompatibly */
+#define NES_ABI_VERSION 1
+
+#define NES_FRAME_WIDTH     256
+#define NES_FRAME_HEIGHT    240
+#define NES_NUM_PORTS       2
+
+enum nes_status {
+    NES_OK              = 0,
+    NES_ERROR_ARGUMENT  = -1,   /* A null handle or buffer, or a range past the address space */
+    NES_ERROR_ROM       = -2,   /* Missing, invalid or unsupported cartridge */
+    NES_ERROR_STATE     = -3,   /* State buffer too small, misaligned, or from another build */
+};
+
+enum nes_run_flags {
+    NES_RUN_NO_VIDEO    = 1 << 0,   /* Skip rendering, e.g. for frames nobody will see */
+    NES_RUN_NO_AUDIO    = 1 << 1
+};
+
+typedef struct nes nes_t;
+
+typedef struct nes_regs {
+    uint8_t     a, x, y, s, p;
+    uint16_t    pc;
+    uint64_t    cycles;
+} nes_regs_t;
+
+NES_API uint32_t    nes_abi_version(void);
+NES_API const char* nes_status_string(int status);
+
+/* NULL if the ROM cannot be loaded */
+NES_API nes_t*      nes_create(const char* rom_path);
+/* A new console with other's cartridge, at power-on */
+NES_API nes_t*      nes_create_from(const nes_t* other);
+NES_API void        nes_destroy(nes_t* nes);
+
+/*
+ * Runs count frames. With buttons, frame i first sets port p to buttons[i * NES_NUM_PORTS + p];
+ * without, the buttons last set are held. flags are nes_run_flags.
+ */
+NES_API int         nes_run_frames(nes_t* nes, uint32_t count, const uint8_t* buttons, uint32_t flags);
+
+/*
+ * The CPU address space without side effects: I/O registers read as 0 and writes to I/O or
+ * ROM are dropped. addr + size must not pass 0x10000.
+ */
+NES_API int         nes_read_memory(nes_t* nes, uint16_t addr, uint8_t* out, size_t size);
+NES_API int         nes_write_memory(nes_t* nes, uint16_t addr, const uint8_t* data, size_t size);
+NES_API int         nes_get_regs(nes_t* nes, nes_regs_t* regs);
+/* cycles is ignored */
+NES_API int         nes_set_regs(nes_t* nes, const nes_regs_t* regs);
+
+/* Bytes a state needs; buffers must be 8-byte aligned. States only load into the same build */
+NES_API size_t      nes_state_size(void);
+NES_API int         nes_save_state(nes_t* nes, void* buffer, size_t size);
+NES_API int         nes_load_state(nes_t* nes, const void* buffer, size_t size);
+
+/* Palette indices of the last rendered frame, row by row; valid until the next nes_run_frames() */
+NES_API const uint8_t* nes_frame_buffer(nes_t* nes);
+/* Takes up to max queued samples (mono, 48 kHz); returns how many */
+NES_API size_t      nes_read_audio(nes_t* nes, int16_t* out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,350 @@
+#include "nes.h"
+#include "frontend.h"
+#include "run_ahead.h"
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+NES::NES() :
+    ppu(cpu),
+    apu(cpu, APU_SAMPLE_RATE),
+    resampler(APU_SAMPLE_RATE, AUDIO_OUTPUT_RATE)
+{
+    this->cpu.map_io(PPU_FIRST_PAGE, PPU_LAST_PAGE, &this->ppu);
+    this->cpu.map_io(APU_IO_PAGE, APU_IO_PAGE, this);
+    this->ppu.set_frame_sink([this](const uint8_t* pixels, uint64_t frame) {
+        if (!this->frame_target)
+            this->output.publish_frame(pixels, frame);
+    });
+}
+
+NES::~NES()
+{
+}
+
+bool NES::load(ROM& rom)
+{
+    if (!rom.is_valid())
+        return false;
+
+    if (rom.get_mapper() != 0) {
+        cerr << "ERROR: Unsupported mapper " << unsigned(rom.get_mapper()) << ".\n";
+        return false;
+    }
+
+    const vector<uint8_t>& prg = rom.get_prg_rom();
+
+    if (prg.empty() || PRG_ROM_WINDOW_SIZE % prg.size() != 0) {
+        cerr << "ERROR: Unsupported PRG ROM size.\n";
+        return false;
+    }
+
+    this->prg_rom = prg;
+    this->chr_rom = rom.get_chr_rom();
+    this->mirroring = rom.has_vertical_mirroring() ? MIRROR_VERTICAL : MIRROR_HORIZONTAL;
+    this->map_cartridge();
+    this->cpu.reset();
+
+    return true;
+}
+
+void NES::copy_cartridge(const NES& other)
+{
+    this->prg_rom = other.prg_rom;
+    this->chr_rom = other.chr_rom;
+    this->mirroring = other.mirroring;
+
+    if (!this->prg_rom.empty())
+        this->map_cartridge();
+}
+
+void NES::map_cartridge()
+{
+    /* 16 KB images are mirrored into both halves of the PRG window */
+    uint8_t* window = this->cpu.get_memptr(PRG_ROM_START);
+
+    for (size_t offset = 0; offset < PRG_ROM_WINDOW_SIZE; offset += this->prg_rom.size())
+        memcpy(window + offset, this->prg_rom.data(), this->prg_rom.size());
+
+    this->cpu.map_memory(PRG_ROM_START >> PAGE_SHIFT, NUM_PAGES - 1, window, false);
+    this->ppu.set_cartridge(this->chr_rom.empty() ? nullptr : this->chr_rom.data(), this->mirroring);
+}
+
+void NES::run_frame()
+{
+    if (!this->telemetry) {
+        this->advance_frame();
+        return;
+    }
+
+    uint64_t start = Timeline::now();
+    this->advance_frame();
+    this->telemetry->publish(*this, Timeline::now() - start);
+}
+
+void NES::advance_frame()
+{
+    if (this->frontend)
+        this->frontend->poll_input(this->controllers);
+
+    if (this->run_ahead_frames == 0) {
+        this->emulate_frame(true, true);
+        return;
+    }
+
+    /* The real frame: its audio is played, but the picture comes from the last frame ahead */
+    this->emulate_frame(false, true);
+    this->save_state(*this->ahead_snapshot);
+
+    if (this->ahead_thread) {
+        this->ahead_thread->submit(this->ahead_snapshot);
+        return;
+    }
+
+    this->controllers.set_frozen(true);
+
+    for (unsigned i = 1; i <= this->run_ahead_frames; i++)
+        this->emulate_frame(i == this->run_ahead_frames, false);
+
+    this->controllers.set_frozen(false);
+    this->load_state(*this->ahead_snapshot);
+}
+
+void NES::emulate_frame(bool video, bool audio)
+{
+    TimelineSpan frame(this->timeline, video ? "frame" : "frame.hidden", "nes", this->cpu.get_cycles());
+
+    this->ppu.set_render_enabled(video);
+    this->apu.set_muted(!audio);
+
+    this->ppu.begin_frame();
+    this->run_until(this->ppu.get_vblank_cycle());
+
+    TimelineSpan vblank(this->timeline, "ppu.end_frame", "ppu", this->cpu.get_cycles());
+    this->ppu.end_frame();
+    vblank.end(this->cpu.get_cycles());
+
+    this->run_until(this->ppu.get_frame_end_cycle());
+
+    TimelineSpan finish(this->timeline, "ppu.finish_frame", "ppu", this->cpu.get_cycles());
+    this->ppu.finish_frame();
+    finish.end(this->cpu.get_cycles());
+
+    TimelineSpan apu(this->timeline, "apu.end_frame", "apu", this->cpu.get_cycles());
+    this->apu.end_frame();
+
+    if (audio) {
+        size_t count = this->apu.read_samples(this->audio, MAX_SAMPLES_PER_FRAME);
+        size_t depth = this->frontend ? this->frontend->get_audio_depth() : this->output.get_audio_depth();
+        this->resampler.update_rate(depth, AUDIO_TARGET_DEPTH);
+        count = this->resampler.process(this->audio, count, this->resampled, MAX_SAMPLES_PER_FRAME);
+
+        if (this->frontend)
+            this->frontend->write_audio(this->resampled, count);
+        else
+            this->output.write_audio(this->resampled, count);
+    }
+
+    apu.end(this->cpu.get_cycles());
+    frame.end(this->cpu.get_cycles(), this->ppu.get_frame());
+}
+
+void NES::run_until(uint64_t cycle)
+{
+    while (this->cpu.get_cycles() < cycle) {
+        uint64_t irq = this->apu.get_next_irq_cycle();
+
+        this->controllers.publish_cycle(this->cpu.get_cycles());
+
+        this->stats.run_slices++;
+
+        TimelineSpan slice(this->timeline, "cpu.run", "cpu", this->cpu.get_cycles());
+        this->cpu.run(min(cycle, irq));
+        slice.end(this->cpu.get_cycles());
+
+        if (this->cpu.get_cycles() >= irq)
+            this->update_apu_irq(irq);
+    }
+}
+
+void NES::update_apu_irq(uint64_t at)
+{
+    this->cpu.set_irq(IRQ_APU, this->apu.irq_pending(), at);
+}
+
+uint8_t NES::io_read(uint16_t addr)
+{
+    if (addr == APU_STATUS) {
+        this->stats.apu_syncs++;
+        TimelineSpan sync(this->timeline, "apu.sync", "apu", this->cpu.get_cycles());
+        uint8_t status = this->apu.read_status();
+        this->update_apu_irq(this->cpu.get_cycles());
+        sync.end(this->cpu.get_cycles(), addr);
+        return status;
+    }
+
+    if (addr == JOYPAD1 || addr == JOYPAD2)
+        return this->controllers.read(addr - JOYPAD1, this->cpu.get_cycles());
+
+    return addr >> PAGE_SHIFT;
+}
+
+void NES::oam_dma(uint8_t page)
+{
+    /* One bulk copy from RAM/ROM, and the whole stall charged at once */
+    uint64_t odd = this->cpu.get_cycles() & 1;
+    this->stats.oam_dmas++;
+    TimelineSpan dma(this->timeline, "oam_dma", "cpu", this->cpu.get_cycles());
+
+    this->ppu.oam_dma(this->cpu.read_page(page, this->dma_scratch));
+    this->cpu.stall(OAM_DMA_CYCLES + odd);
+    dma.end(this->cpu.get_cycles(), page);
+}
+
+void NES::io_write(uint16_t addr, uint8_t val)
+{
+    if (addr == OAM_DMA_REG)
+        this->oam_dma(val);
+    else if (addr == JOYPAD1)
+        this->controllers.write_strobe(val, this->cpu.get_cycles());
+    else if (addr <= APU_IO_LAST_REG) {
+        this->stats.apu_syncs++;
+        TimelineSpan sync(this->timeline, "apu.sync", "apu", this->cpu.get_cycles());
+        this->apu.write_register(addr, val);
+        this->update_apu_irq(this->cpu.get_cycles());
+        /* The write may have brought the next IRQ forward */
+        this->cpu.end_run_at(this->apu.get_next_irq_cycle());
+        sync.end(this->cpu.get_cycles(), addr);
+    }
+}
+
+void NES::save_state(NESSnapshot& snap)
+{
+    uint64_t start = Timeline::now();
+
+    this->cpu.save_state(snap.cpu);
+    this->ppu.save_state(snap.ppu);
+    this->apu.save_state(snap.apu);
+    this->controllers.save_state(snap.controllers);
+
+    this->stats.states_saved++;
+    this->stats.save_ns += Timeline::now() - start;
+}
+
+void NES::load_state(const NESSnapshot& snap)
+{
+    uint64_t start = Timeline::now();
+
+    this->cpu.load_state(snap.cpu);
+    this->ppu.load_state(snap.ppu);
+    this->apu.load_state(snap.apu);
+    this->controllers.load_state(snap.controllers);
+
+    this->stats.states_loaded++;
+    this->stats.load_ns += Timeline::now() - start;
+}
+
+uint64_t NES::hash_state()
+{
+    uint64_t h = this->cpu.hash_state(0);
+    h = this->ppu.hash_state(h);
+    h = this->apu.hash_state(h);
+    return this->controllers.hash_state(h);
+}
+
+bool NES::set_run_ahead(unsigned frames, RunAheadMode mode)
+{
+    if (frames > MAX_RUN_AHEAD_FRAMES) {
+        cerr << "ERROR: Cannot run " << frames << " frames ahead, the limit is " << MAX_RUN_AHEAD_FRAMES << ".\n";
+        return false;
+    }
+
+    this->ahead_thread.reset();
+    this->run_ahead_frames = frames;
+
+    if (frames == 0) {
+        this->ahead_snapshot.reset();
+        return true;
+    }
+
+    if (!this->ahead_snapshot)
+        this->ahead_snapshot.reset(new NESSnapshot());
+
+    if (mode == RUN_AHEAD_THREADED) {
+        this->ahead_thread.reset(new RunAheadThread(*this, frames));
+        this->ahead_thread->set_frame_target(this->frame_target);
+    }
+
+    return true;
+}
+
+void NES::set_timeline(Timeline* timeline)
+{
+    this->timeline = timeline;
+    this->cpu.set_timeline(timeline);
+    this->output.set_timeline(timeline);
+}
+
+void NES::set_telemetry(Telemetry* telemetry)
+{
+    this->telemetry = telemetry;
+}
+
+void NES::set_frontend(FrontendServer* frontend)
+{
+    this->frontend = frontend;
+    this->set_frame_target(frontend);
+}
+
+void NES::set_frame_target(FrameTarget* target)
+{
+    this->frame_target = target;
+    this->ppu.set_frame_target(target);
+
+    /* With threaded run-ahead every frame shown is rendered by the second instance */
+    if (this->ahead_thread)
+        this->ahead_thread->set_frame_target(target);
+}
+
+const NESStats& NES::get_stats()
+{
+    return this->stats;
+}
+
+unsigned NES::get_run_ahead_frames()
+{
+    return this->run_ahead_frames;
+}
+
+void NES::sync_run_ahead()
+{
+    if (this->ahead_thread)
+        this->ahead_thread->sync();
+}
+
+CPU& NES::get_cpu()
+{
+    return this->cpu;
+}
+
+PPU& NES::get_ppu()
+{
+    return this->ppu;
+}
+
+APU& NES::get_apu()
+{
+    return this->apu;
+}
+
+Controllers& NES::get_controllers()
+{
+    return this->controllers;
+}
+
+FrameOutput& NES::get_output()
+{
+    return this->output;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "apu.h"
+#include "bus.h"
+#include "cpu.h"
+#include "input.h"
+#include "output.h"
+#include "ppu.h"
+#include "resampler.h"
+#include "rom.h"
+#include "timeline.h"
+
+using namespace std;
+
+const uint16_t PRG_ROM_START = 0x8000;
+const size_t PRG_ROM_WINDOW_SIZE = 0x8000;
+const uint8_t PPU_FIRST_PAGE = 0x20;
+const uint8_t PPU_LAST_PAGE = 0x3F;
+const uint8_t APU_IO_PAGE = 0x40;
+const uint16_t APU_IO_LAST_REG = 0x4017;
+const uint16_t OAM_DMA_REG = 0x4014;
+const uint64_t OAM_DMA_CYCLES = 513;    // Plus one when the write lands on an odd cycle
+
+/* The APU synthesizes at a high rate and is resampled to the host rate with drift control */
+const double APU_SAMPLE_RATE = 96000.0;
+const double AUDIO_OUTPUT_RATE = 48000.0;
+const size_t AUDIO_TARGET_DEPTH = DEFAULT_AUDIO_RING_SIZE / 4;
+
+/* Host time a frame should take to keep real time; the core itself only emulates NTSC timing */
+const uint64_t NTSC_FRAME_NS = 16639267;
+const uint64_t PAL_FRAME_NS = 19997194;
+
+/* Largest number of frames run_frame() may emulate ahead of the one the game's state is kept at */
+const unsigned MAX_RUN_AHEAD_FRAMES = 8;
+
+enum RunAheadMode {
+    RUN_AHEAD_INLINE,   // Save, run ahead and restore on the calling thread every frame
+    RUN_AHEAD_THREADED  // Hand a snapshot to a second instance on its own thread
+};
+
+struct NESSnapshot {
+    CPUSnapshot         cpu;
+    PPUSnapshot         ppu;
+    APUSnapshot         apu;
+    ControllerSnapshot  controllers;
+};
+
+/* Running totals of the work the console did to stay in sync, and what snapshots cost */
+struct NESStats {
+    uint64_t    run_slices;     // cpu.run() calls: one per stop for vblank, frame end or an APU IRQ
+    uint64_t    apu_syncs;      // APU catch-ups for register accesses
+    uint64_t    oam_dmas;
+    uint64_t    states_saved;
+    uint64_t    states_loaded;
+    uint64_t    save_ns;
+    uint64_t    load_ns;
+};
+
+class RunAheadThread;
+class Telemetry;
+class FrontendServer;
+
+/*
+ * The console: CPU, PPU and APU wired together on the bus, plus the cartridge loaded from a ROM.
+ * Finished frames are published to the FrameOutput, from whichever thread renders them, and the
+ * APU's samples follow at the end of every frame. The NES itself decodes the 0x4000 page.
+ */
+class NES : public IODevice
+{
+private:
+    CPU             cpu;
+    PPU             ppu;
+    APU             apu;
+    Controllers     controllers;
+    FrameOutput     output;
+    Resampler       resampler;
+    vector<uint8_t> prg_rom;
+    vector<uint8_t> chr_rom;
+    Mirroring       mirroring = MIRROR_HORIZONTAL;
+    uint8_t         dma_scratch[PAGE_SIZE];
+    int16_t         audio[MAX_SAMPLES_PER_FRAME];
+    int16_t         resampled[MAX_SAMPLES_PER_FRAME];
+    unsigned        run_ahead_frames = 0;
+    unique_ptr<NESSnapshot>     ahead_snapshot;
+    unique_ptr<RunAheadThread>  ahead_thread;
+    Timeline*       timeline = nullptr;
+    Telemetry*      telemetry = nullptr;
+    FrontendServer* frontend = nullptr;
+    FrameTarget*    frame_target = nullptr;
+    NESStats        stats = {};
+
+    void            map_cartridge();
+    void            advance_frame();
+    void            update_apu_irq(uint64_t at);
+
+public:
+    NES();
+    ~NES();
+
+    NES(const NES&) = delete;
+    NES& operator=(const NES&) = delete;
+
+    /* Only NROM (mapper 0) cartridges are supported */
+    bool        load(ROM& rom);
+    /* Loads the cartridge other has loaded, sharing nothing with it */
+    void        copy_cartridge(const NES& other);
+    /*
+     * Emulates one frame and plays its audio. With run-ahead on, the frame shown is instead the
+     * one frames later, emulated with the current input and then thrown away.
+     */
+    void        run_frame();
+    /* One frame with no run-ahead; video and audio can be skipped for frames nobody will see */
+    void        emulate_frame(bool video, bool audio);
+    /* Runs the CPU to cycle, stopping at predicted APU IRQs to raise the line on time */
+    void        run_until(uint64_t cycle);
+    void        oam_dma(uint8_t page);
+
+    /* Only call between frames. Everything the host owns, like output and input queue, is left out */
+    void        save_state(NESSnapshot& snap);
+    void        load_state(const NESSnapshot& snap);
+    /*
+     * Hash of the whole machine: CPU registers and writable memory, PPU, APU and what the game
+     * can see of the controllers. Equal states hash equal whatever inputs led to them, so this
+     * deduplicates searches over input. Only call between frames.
+     */
+    uint64_t    hash_state();
+
+    /* 0 turns run-ahead off. Frames above MAX_RUN_AHEAD_FRAMES are rejected */
+    bool        set_run_ahead(unsigned frames, RunAheadMode mode = RUN_AHEAD_INLINE);
+    unsigned    get_run_ahead_frames();
+    /* Waits for the second instance to present its last frame, if there is one */
+    void        sync_run_ahead();
+
+    /*
+     * Records CPU run slices, APU catch-ups, PPU frame steps, OAM DMA, interrupts, frames and
+     * the output's publish/present events on timeline, until set back to nullptr
+     */
+    void        set_timeline(Timeline* timeline);
+    /* Publishes to telemetry after every run_frame(), until set back to nullptr */
+    void        set_telemetry(Telemetry* telemetry);
+    const NESStats& get_stats();
+    /*
+     * Sends video and audio to a frontend process instead of the FrameOutput, rendering frames
+     * straight into its memory, and takes input from it every frame. Only call between frames.
+     */
+    void        set_frontend(FrontendServer* frontend);
+    /* Renders frames straight into target instead of publishing them to the FrameOutput */
+    void        set_frame_target(FrameTarget* target);
+
+    uint8_t     io_read(uint16_t addr) override;
+    void        io_write(uint16_t addr, uint8_t val) override;
+
+    CPU&        get_cpu();
+    PPU&        get_ppu();
+    APU&        get_apu();
+    Controllers& get_controllers();
+    FrameOutput& get_output();
+};
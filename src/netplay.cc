@@ -0,0 +1,171 @@
+#include "netplay.h"
+
+#include <algorithm>
+#include <chrono>
+
+const size_t PACKET_HEADER_SIZE = 10;
+
+static void put32(uint8_t* p, uint32_t val)
+{
+    for (size_t i = 0; i < 4; i++)
+        p[i] = val >> (8 * i);
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t elapsed_ns(chrono::steady_clock::time_point start)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+RollbackSession::RollbackSession(NES& nes, Transport& transport, uint8_t local_port) :
+    nes(nes),
+    transport(transport),
+    local_port(local_port & 1)
+{
+    for (unique_ptr<NESSnapshot>& snap : this->snapshots)
+        snap.reset(new NESSnapshot());
+}
+
+/* Packet: magic, ack (first of our frames the sender lacks), first frame, count, inputs */
+void RollbackSession::send()
+{
+    uint8_t packet[PACKET_HEADER_SIZE + MAX_PACKET_INPUTS];
+    uint32_t first = this->peer_ack;
+    uint32_t count = min<uint32_t>(this->frame - first, MAX_PACKET_INPUTS);
+
+    packet[0] = NETPLAY_PACKET_MAGIC;
+    put32(packet + 1, this->remote_next);
+    put32(packet + 5, first);
+    packet[9] = count;
+
+    for (uint32_t i = 0; i < count; i++)
+        packet[PACKET_HEADER_SIZE + i] = this->local_inputs[(first + i) % INPUT_HISTORY];
+
+    this->transport.send(packet, PACKET_HEADER_SIZE + count);
+    this->stats.packets_sent++;
+}
+
+void RollbackSession::receive()
+{
+    uint8_t packet[MAX_DATAGRAM_SIZE];
+    size_t size;
+
+    while ((size = this->transport.receive(packet, sizeof(packet))) > 0) {
+        if (size < PACKET_HEADER_SIZE || packet[0] != NETPLAY_PACKET_MAGIC ||
+            size < PACKET_HEADER_SIZE + packet[9])
+            continue;
+
+        this->stats.packets_received++;
+        this->peer_ack = max(this->peer_ack, min(get32(packet + 1), this->frame));
+
+        uint32_t first = get32(packet + 5);
+
+        for (uint32_t i = 0; i < packet[9]; i++) {
+            uint32_t f = first + i;
+
+            /* Only take input in order; anything past a gap comes again in a later packet */
+            if (f != this->remote_next)
+                continue;
+
+            uint8_t buttons = packet[PACKET_HEADER_SIZE + i];
+            this->remote_inputs[f % INPUT_HISTORY] = buttons;
+            this->remote_next++;
+
+            if (f < this->frame && this->remote_used[f % INPUT_HISTORY] != buttons)
+                this->rollback_to = min(this->rollback_to, f);
+        }
+    }
+}
+
+uint8_t RollbackSession::remote_input(uint32_t f)
+{
+    if (f < this->remote_next)
+        return this->remote_inputs[f % INPUT_HISTORY];
+
+    /* Predict that the remote player is still holding what they last sent */
+    return this->remote_next ? this->remote_inputs[(this->remote_next - 1) % INPUT_HISTORY] : 0;
+}
+
+void RollbackSession::simulate(uint32_t f, bool present)
+{
+    Controllers& pads = this->nes.get_controllers();
+    uint8_t remote = this->remote_input(f);
+
+    this->nes.save_state(*this->snapshots[f % NUM_SNAPSHOTS]);
+    this->remote_used[f % INPUT_HISTORY] = remote;
+
+    pads.set_buttons(this->local_port, this->local_inputs[f % INPUT_HISTORY]);
+    pads.set_buttons(this->local_port ^ 1, remote);
+    this->nes.emulate_frame(present, present);
+}
+
+bool RollbackSession::advance_frame(uint8_t buttons)
+{
+    this->receive();
+
+    if (this->frame > this->remote_next + MAX_ROLLBACK_FRAMES) {
+        this->stats.stalls++;
+        this->send();
+        return false;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    this->local_inputs[this->frame % INPUT_HISTORY] = buttons;
+    this->stats.last_rollback_depth = 0;
+    this->stats.last_resim_ns = 0;
+
+    if (this->rollback_to != NO_ROLLBACK) {
+        uint32_t depth = this->frame - this->rollback_to;
+
+        this->nes.load_state(*this->snapshots[this->rollback_to % NUM_SNAPSHOTS]);
+
+        for (uint32_t f = this->rollback_to; f < this->frame; f++)
+            this->simulate(f, false);
+
+        this->rollback_to = NO_ROLLBACK;
+
+        SessionStats& s = this->stats;
+        s.rollbacks++;
+        s.frames_resimulated += depth;
+        s.last_rollback_depth = depth;
+        s.max_rollback_depth = max(s.max_rollback_depth, depth);
+        s.last_resim_ns = elapsed_ns(start);
+        s.max_resim_ns = max(s.max_resim_ns, s.last_resim_ns);
+        s.total_resim_ns += s.last_resim_ns;
+    }
+
+    this->simulate(this->frame, true);
+    this->frame++;
+    this->send();
+
+    this->stats.frames++;
+    if (elapsed_ns(start) > NTSC_FRAME_NS)
+        this->stats.over_budget++;
+
+    return true;
+}
+
+void RollbackSession::poll()
+{
+    this->receive();
+    this->send();
+}
+
+uint32_t RollbackSession::get_frame()
+{
+    return this->frame;
+}
+
+uint32_t RollbackSession::get_confirmed_frame()
+{
+    return min(this->frame, this->remote_next);
+}
+
+SessionStats RollbackSession::get_stats()
+{
+    return this->stats;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "nes.h"
+#include "transport.h"
+
+using namespace std;
+
+/* How far the local side may run on predicted input before it has to wait for the remote one */
+const unsigned MAX_ROLLBACK_FRAMES = 8;
+const size_t INPUT_HISTORY = 64;
+const size_t MAX_PACKET_INPUTS = 32;
+const uint8_t NETPLAY_PACKET_MAGIC = 0x4E;
+
+struct SessionStats {
+    uint64_t    frames;                 // Frames advanced
+    uint64_t    stalls;                 // advance_frame() calls refused, too far ahead of the remote
+    uint64_t    rollbacks;
+    uint64_t    frames_resimulated;
+    unsigned    last_rollback_depth;    // Frames re-run by the last advance_frame(), 0 if none
+    unsigned    max_rollback_depth;
+    uint64_t    last_resim_ns;
+    uint64_t    max_resim_ns;
+    uint64_t    total_resim_ns;
+    uint64_t    over_budget;            // Advances that took longer than one NTSC frame in total
+    uint64_t    packets_sent;
+    uint64_t    packets_received;
+};
+
+/*
+ * Two-player rollback session over one NES. Every frame runs straight away with the local
+ * input and a prediction of the remote one (its last confirmed input). When the remote input
+ * for a frame arrives and differs from the prediction, the state saved at that frame is loaded
+ * and every frame since is re-run, without video or audio, before the current one. Each packet
+ * carries all local input the peer has not acknowledged, so lost packets need no resends.
+ */
+class RollbackSession
+{
+private:
+    static const uint32_t NO_ROLLBACK = UINT32_MAX;
+    static const size_t NUM_SNAPSHOTS = MAX_ROLLBACK_FRAMES + 1;
+
+    NES&            nes;
+    Transport&      transport;
+    uint8_t         local_port;
+    uint32_t        frame = 0;          // Next frame to emulate
+    uint32_t        remote_next = 0;    // First remote frame not received yet
+    uint32_t        peer_ack = 0;       // First local frame the peer has not received yet
+    uint32_t        rollback_to = NO_ROLLBACK;
+    uint8_t         local_inputs[INPUT_HISTORY] = {};
+    uint8_t         remote_inputs[INPUT_HISTORY] = {};  // Confirmed, for frames before remote_next
+    uint8_t         remote_used[INPUT_HISTORY] = {};    // What each emulated frame was run with
+    unique_ptr<NESSnapshot> snapshots[NUM_SNAPSHOTS];   // State at the start of each frame
+    SessionStats    stats = {};
+
+    void            receive();
+    void            send();
+    uint8_t         remote_input(uint32_t f);
+    void            simulate(uint32_t f, bool present);
+
+public:
+    /* local_port is the controller port (0 or 1) this side plays on */
+    RollbackSession(NES& nes, Transport& transport, uint8_t local_port);
+
+    /* Emulates the next frame, returns false without emulating if the remote is too far behind */
+    bool            advance_frame(uint8_t buttons);
+    /* Exchanges input without emulating, for a side that has to wait or has stopped */
+    void            poll();
+
+    uint32_t        get_frame();
+    /* Frames before this one ran with the remote's real input and will not be rolled back */
+    uint32_t        get_confirmed_frame();
+    SessionStats    get_stats();
+};
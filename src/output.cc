@@ -0,0 +1,160 @@
+#include "output.h"
+
+#include <algorithm>
+#include <cstring>
+
+static size_t round_up_pow2(size_t n)
+{
+    size_t p = 1;
+
+    while (p < n)
+        p <<= 1;
+
+    return p;
+}
+
+AudioRing::AudioRing(size_t capacity) :
+    buffer(round_up_pow2(capacity)),
+    mask(round_up_pow2(capacity) - 1),
+    head(0),
+    tail(0)
+{
+}
+
+size_t AudioRing::write(const int16_t* samples, size_t count)
+{
+    size_t t = this->tail.load(memory_order_relaxed);
+    size_t free_space = this->buffer.size() - (t - this->head.load(memory_order_acquire));
+    count = min(count, free_space);
+
+    /* At most two copies: up to the end of the buffer, then from the start */
+    size_t offset = t & this->mask;
+    size_t first = min(count, this->buffer.size() - offset);
+    memcpy(&this->buffer[offset], samples, first * sizeof(int16_t));
+    memcpy(&this->buffer[0], samples + first, (count - first) * sizeof(int16_t));
+
+    this->tail.store(t + count, memory_order_release);
+    return count;
+}
+
+size_t AudioRing::read(int16_t* samples, size_t count)
+{
+    size_t h = this->head.load(memory_order_relaxed);
+    count = min(count, this->tail.load(memory_order_acquire) - h);
+
+    size_t offset = h & this->mask;
+    size_t first = min(count, this->buffer.size() - offset);
+    memcpy(samples, &this->buffer[offset], first * sizeof(int16_t));
+    memcpy(samples + first, &this->buffer[0], (count - first) * sizeof(int16_t));
+
+    this->head.store(h + count, memory_order_release);
+    return count;
+}
+
+size_t AudioRing::size()
+{
+    return this->tail.load(memory_order_acquire) - this->head.load(memory_order_acquire);
+}
+
+size_t AudioRing::capacity()
+{
+    return this->buffer.size();
+}
+
+FrameOutput::FrameOutput(size_t audio_capacity) :
+    audio(audio_capacity),
+    frames_published(0),
+    frames_dropped(0),
+    frames_presented(0),
+    frames_duplicated(0),
+    samples_written(0),
+    samples_dropped(0),
+    samples_read(0),
+    audio_underruns(0),
+    audio_max_depth(0)
+{
+}
+
+void FrameOutput::publish_frame(const uint8_t* pixels, uint64_t frame)
+{
+    VideoFrame& back = this->video.get_back();
+    back.frame = frame;
+    memcpy(back.pixels, pixels, FRAME_PIXELS);
+
+    if (!this->video.publish())
+        this->frames_dropped.fetch_add(1, memory_order_relaxed);
+
+    this->frames_published.fetch_add(1, memory_order_relaxed);
+
+    if (this->timeline)
+        this->timeline->instant("publish", "output", NO_CYCLE, frame);
+}
+
+void FrameOutput::write_audio(const int16_t* samples, size_t count)
+{
+    size_t written = this->audio.write(samples, count);
+    this->samples_written.fetch_add(written, memory_order_relaxed);
+
+    if (written < count)
+        this->samples_dropped.fetch_add(count - written, memory_order_relaxed);
+
+    size_t depth = this->audio.size();
+
+    if (depth > this->audio_max_depth.load(memory_order_relaxed))
+        this->audio_max_depth.store(depth, memory_order_relaxed);
+}
+
+const VideoFrame* FrameOutput::acquire_frame()
+{
+    if (this->video.acquire()) {
+        this->has_presented = true;
+        this->frames_presented.fetch_add(1, memory_order_relaxed);
+
+        if (this->timeline)
+            this->timeline->instant("present", "output", NO_CYCLE, this->video.get_front().frame);
+    } else if (this->has_presented) {
+        this->frames_duplicated.fetch_add(1, memory_order_relaxed);
+
+        if (this->timeline)
+            this->timeline->instant("present.duplicate", "output", NO_CYCLE, this->video.get_front().frame);
+    }
+
+    return this->has_presented ? &this->video.get_front() : nullptr;
+}
+
+size_t FrameOutput::read_audio(int16_t* samples, size_t count)
+{
+    size_t got = this->audio.read(samples, count);
+    this->samples_read.fetch_add(got, memory_order_relaxed);
+
+    if (got < count)
+        this->audio_underruns.fetch_add(1, memory_order_relaxed);
+
+    return got;
+}
+
+void FrameOutput::set_timeline(Timeline* timeline)
+{
+    this->timeline = timeline;
+}
+
+size_t FrameOutput::get_audio_depth()
+{
+    return this->audio.size();
+}
+
+OutputStats FrameOutput::get_stats()
+{
+    OutputStats stats;
+    stats.frames_published = this->frames_published.load(memory_order_relaxed);
+    stats.frames_dropped = this->frames_dropped.load(memory_order_relaxed);
+    stats.frames_presented = this->frames_presented.load(memory_order_relaxed);
+    stats.frames_duplicated = this->frames_duplicated.load(memory_order_relaxed);
+    stats.samples_written = this->samples_written.load(memory_order_relaxed);
+    stats.samples_dropped = this->samples_dropped.load(memory_order_relaxed);
+    stats.samples_read = this->samples_read.load(memory_order_relaxed);
+    stats.audio_underruns = this->audio_underruns.load(memory_order_relaxed);
+    stats.audio_depth = this->audio.size();
+    stats.audio_max_depth = this->audio_max_depth.load(memory_order_relaxed);
+    return stats;
+}
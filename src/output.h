@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "timeline.h"
+#include "video.h"
+
+using namespace std;
+
+/*
+ * Triple buffer for one producer and one consumer. The producer always has a back buffer to
+ * fill and the consumer always has a front buffer to read; the middle buffer is swapped with
+ * a single atomic exchange, so neither side ever waits for the other.
+ */
+template<typename T>
+class TripleBuffer
+{
+private:
+    static const uint8_t INDEX_MASK = 0x03;
+    static const uint8_t FRESH = 0x04;
+
+    T               buffers[3];
+    char            pad0[CACHE_LINE_SIZE];
+    atomic<uint8_t> middle;
+    char            pad1[CACHE_LINE_SIZE];
+    uint8_t         back = 0;   // Producer only
+    char            pad2[CACHE_LINE_SIZE];
+    uint8_t         front = 1;  // Consumer only
+
+public:
+    TripleBuffer() :
+        middle(2)
+    {
+    }
+
+    T& get_back()
+    {
+        return this->buffers[this->back];
+    }
+
+    /* Returns false if the previously published buffer was never picked up */
+    bool publish()
+    {
+        uint8_t prev = this->middle.exchange(this->back | FRESH, memory_order_acq_rel);
+        this->back = prev & INDEX_MASK;
+        return !(prev & FRESH);
+    }
+
+    /* Swaps in the newest published buffer; returns false (front unchanged) if there is none */
+    bool acquire()
+    {
+        if (!(this->middle.load(memory_order_relaxed) & FRESH))
+            return false;
+
+        uint8_t prev = this->middle.exchange(this->front, memory_order_acq_rel);
+        this->front = prev & INDEX_MASK;
+        return true;
+    }
+
+    T& get_front()
+    {
+        return this->buffers[this->front];
+    }
+};
+
+/*
+ * Sample FIFO between the emulation thread and the audio device. Writes never block: samples
+ * that do not fit are dropped and counted as an overrun.
+ */
+class AudioRing
+{
+private:
+    vector<int16_t> buffer;
+    size_t          mask;
+    char            pad0[CACHE_LINE_SIZE];
+    atomic<size_t>  head;
+    char            pad1[CACHE_LINE_SIZE];
+    atomic<size_t>  tail;
+    char            pad2[CACHE_LINE_SIZE];
+
+public:
+    /* capacity is rounded up to a power of two */
+    AudioRing(size_t capacity);
+
+    size_t      write(const int16_t* samples, size_t count);
+    size_t      read(int16_t* samples, size_t count);
+    size_t      size();
+    size_t      capacity();
+};
+
+struct VideoFrame {
+    uint64_t    frame;
+    uint8_t     pixels[FRAME_PIXELS];
+};
+
+struct OutputStats {
+    uint64_t    frames_published;
+    uint64_t    frames_dropped;     // Overwritten before the presenter picked them up
+    uint64_t    frames_presented;
+    uint64_t    frames_duplicated;  // Presenter asked again before a new frame was ready
+    uint64_t    samples_written;
+    uint64_t    samples_dropped;    // Ring full
+    uint64_t    samples_read;
+    uint64_t    audio_underruns;    // Reads that came back short
+    size_t      audio_depth;
+    size_t      audio_max_depth;
+};
+
+const size_t DEFAULT_AUDIO_RING_SIZE = 1 << 14;
+
+/* What the core hands to the host: the newest finished frame and a stream of audio samples */
+class FrameOutput
+{
+private:
+    TripleBuffer<VideoFrame>    video;
+    AudioRing                   audio;
+    bool                        has_presented = false;
+    atomic<uint64_t>            frames_published;
+    atomic<uint64_t>            frames_dropped;
+    atomic<uint64_t>            frames_presented;
+    atomic<uint64_t>            frames_duplicated;
+    atomic<uint64_t>            samples_written;
+    atomic<uint64_t>            samples_dropped;
+    atomic<uint64_t>            samples_read;
+    atomic<uint64_t>            audio_underruns;
+    atomic<size_t>              audio_max_depth;
+    Timeline*                   timeline = nullptr;
+
+public:
+    FrameOutput(size_t audio_capacity = DEFAULT_AUDIO_RING_SIZE);
+
+    /* Emulation side */
+    void                publish_frame(const uint8_t* pixels, uint64_t frame);
+    void                write_audio(const int16_t* samples, size_t count);
+
+    /* Presentation side: newest finished frame, or nullptr before the first one */
+    const VideoFrame*   acquire_frame();
+    size_t              read_audio(int16_t* samples, size_t count);
+
+    /* Marks frames published and presented, on whichever threads do so */
+    void                set_timeline(Timeline* timeline);
+
+    size_t              get_audio_depth();
+    OutputStats         get_stats();
+};
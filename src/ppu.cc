@@ -0,0 +1,307 @@
+#include "ppu.h"
+
+#include <cstddef>
+
+#include "state_hash.h"
+
+const uint16_t PPU_REG_MASK = NUM_PPU_REGS - 1;
+
+static uint64_t dot_to_cycle(uint64_t dot)
+{
+    return (dot + DOTS_PER_CPU_CYCLE - 1) / DOTS_PER_CPU_CYCLE;
+}
+
+PPU::PPU(CPU& cpu) :
+    cpu(cpu)
+{
+    this->inline_log.entries.reserve(4096);
+}
+
+PPU::~PPU()
+{
+}
+
+uint32_t PPU::current_dot()
+{
+    uint64_t now = this->cpu.get_cycles() * DOTS_PER_CPU_CYCLE;
+
+    if (now < this->frame_start_dot)
+        return 0;
+
+    return (uint32_t) (now - this->frame_start_dot);
+}
+
+void PPU::record(LogKind kind, uint8_t reg, uint8_t val)
+{
+    if (this->log)
+        this->log->entries.push_back({ this->current_dot(), kind, reg, val });
+}
+
+uint32_t PPU::predict_sprite0_hit()
+{
+    if (!this->sprite0_dirty)
+        return this->sprite0_dot;
+
+    this->sprite0_dirty = false;
+    this->sprite0_dot = NO_SPRITE0_HIT;
+
+    const PPUState& s = this->state;
+
+    if ((s.mask & (MASK_BG | MASK_SPRITES)) != (MASK_BG | MASK_SPRITES))
+        return this->sprite0_dot;
+
+    bool clip_left = (s.mask & (MASK_BG_LEFT | MASK_SPRITES_LEFT)) != (MASK_BG_LEFT | MASK_SPRITES_LEFT);
+    unsigned top = s.oam[0] + 1u;
+    unsigned left = s.oam[3];
+    unsigned height = this->sprite_height();
+    uint16_t v = s.t;
+
+    /* The scroll as currently set is what the renderer will use for the lines still to come */
+    for (unsigned y = 0; y < top && y < VISIBLE_LINES; y++)
+        v = next_line(v);
+
+    for (unsigned row = 0; row < height && top + row < VISIBLE_LINES; row++, v = next_line(v)) {
+        for (unsigned col = 0; col < 8; col++) {
+            unsigned x = left + col;
+
+            if (x >= FRAME_WIDTH - 1)
+                break;
+
+            if (x < 8 && clip_left)
+                continue;
+
+            if (this->sprite_pixel(0, row, col) && this->background_pixel(v, x)) {
+                this->sprite0_dot = (top + row + 1) * DOTS_PER_LINE + x + 1;
+                return this->sprite0_dot;
+            }
+        }
+    }
+
+    return this->sprite0_dot;
+}
+
+uint8_t PPU::io_read(uint16_t addr)
+{
+    uint8_t reg = addr & PPU_REG_MASK;
+
+    switch (reg) {
+        case PPUSTATUS: {
+            uint32_t dot = this->current_dot();
+            uint8_t status = 0;
+
+            if (dot >= VBLANK_DOT && !this->vblank_read) {
+                status |= STATUS_VBLANK;
+                this->vblank_read = true;
+            }
+
+            if (dot >= this->predict_sprite0_hit())
+                status |= STATUS_SPRITE0_HIT;
+
+            this->read_status();
+            this->record(LOG_READ_STATUS, reg, 0);
+            return status;
+        }
+        case OAMDATA:
+            return this->state.oam[this->state.oam_addr];
+        case PPUDATA: {
+            uint8_t val = this->read_data();
+            this->record(LOG_READ_DATA, reg, 0);
+            return val;
+        }
+        default:
+            return 0;
+    }
+}
+
+void PPU::io_write(uint16_t addr, uint8_t val)
+{
+    uint8_t reg = addr & PPU_REG_MASK;
+    bool nmi_enabled = this->state.ctrl & CTRL_NMI;
+
+    this->write_register(reg, val);
+    this->record(LOG_WRITE, reg, val);
+    this->sprite0_dirty = true;
+
+    /* Enabling NMI while the vblank flag is still up raises one straight away */
+    if (reg == PPUCTRL && !nmi_enabled && (val & CTRL_NMI) &&
+        this->current_dot() >= VBLANK_DOT && !this->vblank_read)
+        this->cpu.nmi(this->cpu.get_cycles());
+}
+
+void PPU::oam_dma(const uint8_t* page)
+{
+    PPUCore::oam_dma(page);
+    this->sprite0_dirty = true;
+
+    if (this->log) {
+        this->record(LOG_OAM_DMA, OAMDATA, 0);
+        this->log->dma_data.insert(this->log->dma_data.end(), page, page + OAM_SIZE);
+    }
+}
+
+void PPU::set_cartridge(const uint8_t* chr, Mirroring mirroring)
+{
+    PPUCore::set_cartridge(chr, mirroring);
+    this->inline_renderer.set_cartridge(chr, mirroring);
+
+    if (this->pipeline)
+        this->pipeline->set_cartridge(chr, mirroring);
+}
+
+void PPU::set_render_mode(RenderMode mode)
+{
+    if (mode == this->render_mode)
+        return;
+
+    this->render_mode = mode;
+
+    if (mode == RENDER_THREADED) {
+        this->pipeline.reset(new RenderPipeline(this->sink));
+        this->pipeline->set_cartridge(this->chr, this->mirroring);
+        this->pipeline->set_target(this->target);
+    } else {
+        this->pipeline.reset();
+    }
+}
+
+void PPU::set_render_enabled(bool enabled)
+{
+    this->render_enabled = enabled;
+}
+
+void PPU::set_frame_sink(const FrameSink& sink)
+{
+    this->sink = sink;
+
+    /* The pipeline owns a copy of the sink, so rebuild it around the new one */
+    if (this->pipeline) {
+        this->pipeline.reset(new RenderPipeline(this->sink));
+        this->pipeline->set_cartridge(this->chr, this->mirroring);
+        this->pipeline->set_target(this->target);
+    }
+}
+
+void PPU::set_frame_target(FrameTarget* target)
+{
+    this->target = target;
+    this->inline_renderer.set_target(target);
+
+    if (this->pipeline)
+        this->pipeline->set_target(target);
+}
+
+void PPU::begin_frame()
+{
+    this->vblank_read = false;
+    this->sprite0_dirty = true;
+    if (!this->render_enabled)
+        this->log = nullptr;
+    else
+        this->log = (this->render_mode == RENDER_THREADED) ? this->pipeline->acquire() : &this->inline_log;
+
+    if (this->log) {
+        this->log->frame = this->frame;
+        this->log->start = this->state;
+        this->log->entries.clear();
+        this->log->dma_data.clear();
+    }
+}
+
+void PPU::end_frame()
+{
+    if (this->state.ctrl & CTRL_NMI)
+        this->cpu.nmi(this->get_vblank_cycle());
+
+    if (!this->log)
+        return;
+
+    if (this->render_mode == RENDER_THREADED) {
+        this->pipeline->submit(this->log);
+    } else {
+        this->inline_renderer.render(*this->log);
+
+        if (this->sink)
+            this->sink(this->inline_renderer.get_frame_buffer(), this->frame);
+    }
+
+    this->log = nullptr;
+}
+
+void PPU::finish_frame()
+{
+    this->frame_start_dot += DOTS_PER_FRAME;
+    this->frame++;
+}
+
+void PPU::save_state(PPUSnapshot& snap)
+{
+    snap.state = this->state;
+    snap.frame_start_dot = this->frame_start_dot;
+    snap.frame = this->frame;
+    snap.vblank_read = this->vblank_read;
+    snap.sprite0_dirty = this->sprite0_dirty;
+    snap.sprite0_dot = this->sprite0_dot;
+}
+
+void PPU::load_state(const PPUSnapshot& snap)
+{
+    this->state = snap.state;
+    this->frame_start_dot = snap.frame_start_dot;
+    this->frame = snap.frame;
+    this->vblank_read = snap.vblank_read;
+    this->sprite0_dirty = snap.sprite0_dirty;
+    this->sprite0_dot = snap.sprite0_dot;
+}
+
+uint64_t PPU::hash_state(uint64_t seed)
+{
+    uint64_t timing[] = {
+        this->frame_start_dot, this->frame, this->sprite0_dot,
+        (uint64_t) this->vblank_read | (uint64_t) this->sprite0_dirty << 1
+    };
+    uint64_t h = hash_bytes(timing, sizeof(timing), seed);
+
+    h = hash_bytes(&this->state, offsetof(PPUState, chr_ram), h);
+    return this->chr ? h : hash_bytes(this->state.chr_ram, sizeof(this->state.chr_ram), h);
+}
+
+uint64_t PPU::get_vblank_cycle()
+{
+    return dot_to_cycle(this->frame_start_dot + VBLANK_DOT);
+}
+
+uint64_t PPU::get_frame_end_cycle()
+{
+    return dot_to_cycle(this->frame_start_dot + DOTS_PER_FRAME);
+}
+
+uint64_t PPU::get_frame()
+{
+    return this->frame;
+}
+
+uint64_t PPU::get_skipped_frames()
+{
+    return this->pipeline ? this->pipeline->get_skipped() : 0;
+}
+
+RenderMode PPU::get_render_mode()
+{
+    return this->render_mode;
+}
+
+const uint8_t* PPU::get_frame_buffer()
+{
+    if (this->pipeline) {
+        this->pipeline->sync();
+        return this->pipeline->get_frame_buffer();
+    }
+
+    return this->inline_renderer.get_frame_buffer();
+}
+
+void PPU::sync()
+{
+    if (this->pipeline)
+        this->pipeline->sync();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "bus.h"
+#include "cpu.h"
+#include "ppu_core.h"
+#include "renderer.h"
+
+using namespace std;
+
+const uint32_t NO_SPRITE0_HIT = UINT32_MAX;
+
+/* The CPU-side PPU's state between frames */
+struct PPUSnapshot {
+    PPUState    state;
+    uint64_t    frame_start_dot;
+    uint64_t    frame;
+    bool        vblank_read;
+    bool        sprite0_dirty;
+    uint32_t    sprite0_dot;
+};
+
+enum RenderMode {
+    RENDER_INLINE,      // Render on the CPU thread at vblank
+    RENDER_THREADED     // Render on a RenderPipeline thread while the CPU runs ahead
+};
+
+/*
+ * CPU-side PPU, mapped at 0x2000-0x3FFF. It applies register accesses to its own copy of the PPU
+ * state and logs them with their dot, and answers PPUSTATUS reads from timing and a sprite 0 hit
+ * prediction, so the CPU never has to wait for pixels to be produced.
+ */
+class PPU : public PPUCore, public IODevice
+{
+private:
+    CPU&                        cpu;
+    uint64_t                    frame_start_dot = 0;
+    uint64_t                    frame = 0;
+    bool                        vblank_read = false;
+    bool                        sprite0_dirty = true;
+    uint32_t                    sprite0_dot = NO_SPRITE0_HIT;
+    RenderMode                  render_mode = RENDER_INLINE;
+    bool                        render_enabled = true;
+    FrameSink                   sink;
+    FrameTarget*                target = nullptr;
+    FrameLog                    inline_log;
+    Renderer                    inline_renderer;
+    unique_ptr<RenderPipeline>  pipeline;
+    FrameLog*                   log = nullptr;
+
+    uint32_t    current_dot();
+    void        record(LogKind kind, uint8_t reg, uint8_t val);
+    uint32_t    predict_sprite0_hit();
+
+public:
+    PPU(CPU& cpu);
+    ~PPU();
+
+    uint8_t     io_read(uint16_t addr) override;
+    void        io_write(uint16_t addr, uint8_t val) override;
+
+    void        oam_dma(const uint8_t* page);
+
+    void        set_cartridge(const uint8_t* chr, Mirroring mirroring);
+    /* Only switch modes between frames */
+    void        set_render_mode(RenderMode mode);
+    /* Frames begun while disabled are emulated but never drawn or handed to the sink */
+    void        set_render_enabled(bool enabled);
+    void        set_frame_sink(const FrameSink& sink);
+    /* Frames are rendered into target's memory, then handed to the sink as usual */
+    void        set_frame_target(FrameTarget* target);
+
+    /* Frame sequencing: start of pre-render line, start of vblank, end of frame */
+    void        begin_frame();
+    void        end_frame();
+    void        finish_frame();
+
+    /* Only call between frames */
+    void        save_state(PPUSnapshot& snap);
+    void        load_state(const PPUSnapshot& snap);
+    /* CHR RAM only counts when the cartridge has it */
+    uint64_t    hash_state(uint64_t seed);
+
+    uint64_t    get_vblank_cycle();
+    uint64_t    get_frame_end_cycle();
+    uint64_t    get_frame();
+    uint64_t    get_skipped_frames();
+    RenderMode  get_render_mode();
+
+    /* Last rendered frame; in threaded mode this waits for the render thread to catch up */
+    const uint8_t* get_frame_buffer();
+    void        sync();
+};
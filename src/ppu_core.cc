@@ -0,0 +1,284 @@
+#include "ppu_core.h"
+
+#include <cstring>
+
+const uint16_t NAMETABLE_BASE       = 0x2000;
+const uint16_t ATTRIBUTE_BASE       = 0x23C0;
+const uint16_t PALETTE_BASE         = 0x3F00;
+const uint16_t PPU_ADDR_MASK        = 0x3FFF;
+
+/* Bit fields of the internal v/t registers */
+const uint16_t COARSE_X_MASK        = 0x001F;
+const uint16_t COARSE_Y_MASK        = 0x03E0;
+const uint16_t NAMETABLE_X          = 0x0400;
+const uint16_t NAMETABLE_Y          = 0x0800;
+const uint16_t FINE_Y_MASK          = 0x7000;
+const uint16_t HORIZONTAL_BITS      = COARSE_X_MASK | NAMETABLE_X;
+const uint16_t VERTICAL_BITS        = COARSE_Y_MASK | NAMETABLE_Y | FINE_Y_MASK;
+
+PPUCore::PPUCore()
+{
+    this->reset();
+}
+
+void PPUCore::reset()
+{
+    memset(&this->state, 0, sizeof(this->state));
+}
+
+void PPUCore::set_cartridge(const uint8_t* chr, Mirroring mirroring)
+{
+    this->chr = chr;
+    this->mirroring = mirroring;
+}
+
+uint16_t PPUCore::nametable_index(uint16_t addr)
+{
+    uint16_t table = (addr >> 10) & 0x03;
+    uint16_t physical = (this->mirroring == MIRROR_VERTICAL) ? (table & 0x01) : (table >> 1);
+    return physical << 10 | (addr & 0x03FF);
+}
+
+uint8_t PPUCore::palette_index(uint16_t addr)
+{
+    uint8_t i = addr & (PALETTE_SIZE - 1);
+
+    /* Backdrop entries of the sprite palettes mirror the background ones */
+    if ((i & 0x13) == 0x10)
+        i &= ~0x10;
+
+    return i;
+}
+
+void PPUCore::write_register(uint8_t reg, uint8_t val)
+{
+    PPUState& s = this->state;
+
+    switch (reg) {
+        case PPUCTRL:
+            s.ctrl = val;
+            s.t = (s.t & ~(NAMETABLE_X | NAMETABLE_Y)) | (uint16_t) (val & CTRL_NAMETABLE) << 10;
+            break;
+        case PPUMASK:
+            s.mask = val;
+            break;
+        case OAMADDR:
+            s.oam_addr = val;
+            break;
+        case OAMDATA:
+            s.oam[s.oam_addr++] = val;
+            break;
+        case PPUSCROLL:
+            if (!s.w) {
+                s.t = (s.t & ~COARSE_X_MASK) | (val >> 3);
+                s.x = val & 0x07;
+            } else {
+                s.t = (s.t & ~(COARSE_Y_MASK | FINE_Y_MASK)) | (uint16_t) (val & 0x07) << 12 | (uint16_t) (val & 0xF8) << 2;
+            }
+            s.w = !s.w;
+            break;
+        case PPUADDR:
+            if (!s.w) {
+                s.t = (s.t & 0x00FF) | (uint16_t) (val & 0x3F) << 8;
+            } else {
+                s.t = (s.t & 0xFF00) | val;
+                s.v = s.t;
+            }
+            s.w = !s.w;
+            break;
+        case PPUDATA:
+            this->write_vram(s.v, val);
+            s.v += (s.ctrl & CTRL_INCREMENT_32) ? 32 : 1;
+            break;
+        default:
+            break;
+    }
+}
+
+void PPUCore::read_status()
+{
+    this->state.w = false;
+}
+
+uint8_t PPUCore::read_data()
+{
+    PPUState& s = this->state;
+    uint16_t addr = s.v & PPU_ADDR_MASK;
+    uint8_t val;
+
+    if (addr >= PALETTE_BASE) {
+        /* Palette reads are not buffered, but refill the buffer from the nametable underneath */
+        val = this->read_vram(addr);
+        s.read_buffer = this->read_vram(addr - 0x1000);
+    } else {
+        val = s.read_buffer;
+        s.read_buffer = this->read_vram(addr);
+    }
+
+    s.v += (s.ctrl & CTRL_INCREMENT_32) ? 32 : 1;
+    return val;
+}
+
+void PPUCore::oam_dma(const uint8_t* page)
+{
+    PPUState& s = this->state;
+    size_t head = OAM_SIZE - s.oam_addr;
+
+    memcpy(&s.oam[s.oam_addr], page, head);
+    memcpy(&s.oam[0], page + head, s.oam_addr);
+}
+
+uint8_t PPUCore::read_vram(uint16_t addr)
+{
+    addr &= PPU_ADDR_MASK;
+
+    if (addr < NAMETABLE_BASE)
+        return this->read_chr(addr);
+
+    if (addr < PALETTE_BASE)
+        return this->state.vram[this->nametable_index(addr)];
+
+    return this->state.palette[this->palette_index(addr)];
+}
+
+void PPUCore::write_vram(uint16_t addr, uint8_t val)
+{
+    addr &= PPU_ADDR_MASK;
+
+    if (addr < NAMETABLE_BASE) {
+        if (!this->chr)
+            this->state.chr_ram[addr] = val;
+    } else if (addr < PALETTE_BASE) {
+        this->state.vram[this->nametable_index(addr)] = val;
+    } else {
+        this->state.palette[this->palette_index(addr)] = val;
+    }
+}
+
+uint8_t PPUCore::read_chr(uint16_t addr)
+{
+    return this->chr ? this->chr[addr] : this->state.chr_ram[addr];
+}
+
+uint8_t PPUCore::read_palette(uint8_t i)
+{
+    uint8_t color = this->state.palette[this->palette_index(i)];
+
+    if (this->state.mask & MASK_GREYSCALE)
+        color &= 0x30;
+
+    return color;
+}
+
+bool PPUCore::rendering_enabled()
+{
+    return (this->state.mask & (MASK_BG | MASK_SPRITES)) != 0;
+}
+
+void PPUCore::copy_horizontal()
+{
+    this->state.v = (this->state.v & ~HORIZONTAL_BITS) | (this->state.t & HORIZONTAL_BITS);
+}
+
+void PPUCore::copy_vertical()
+{
+    this->state.v = (this->state.v & ~VERTICAL_BITS) | (this->state.t & VERTICAL_BITS);
+}
+
+void PPUCore::increment_y()
+{
+    this->state.v = next_line(this->state.v);
+}
+
+uint16_t PPUCore::next_line(uint16_t v)
+{
+    if ((v & FINE_Y_MASK) != FINE_Y_MASK)
+        return v + 0x1000;
+
+    v &= ~FINE_Y_MASK;
+    uint16_t coarse_y = (v & COARSE_Y_MASK) >> 5;
+
+    if (coarse_y == 29) {
+        coarse_y = 0;
+        v ^= NAMETABLE_Y;
+    } else if (coarse_y == 31) {
+        coarse_y = 0;
+    } else {
+        coarse_y++;
+    }
+
+    return (v & ~COARSE_Y_MASK) | coarse_y << 5;
+}
+
+void PPUCore::fetch_tile_row(uint16_t v, uint8_t* out)
+{
+    uint8_t tile = this->read_vram(NAMETABLE_BASE | (v & 0x0FFF));
+    uint8_t attr = this->read_vram(ATTRIBUTE_BASE | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
+    uint8_t shift = ((v >> 4) & 0x04) | (v & 0x02);
+    uint8_t palette = ((attr >> shift) & 0x03) << 2;
+    uint16_t pattern = ((this->state.ctrl & CTRL_BG_TABLE) ? 0x1000 : 0x0000) + tile * 16 + ((v >> 12) & 0x07);
+    uint8_t lo = this->read_chr(pattern);
+    uint8_t hi = this->read_chr(pattern + 8);
+
+    for (unsigned b = 0; b < 8; b++) {
+        unsigned bit = 7 - b;
+        uint8_t px = ((lo >> bit) & 0x01) | ((hi >> bit) & 0x01) << 1;
+        out[b] = px ? (palette | px) : 0;
+    }
+}
+
+uint8_t PPUCore::background_pixel(uint16_t v, unsigned x)
+{
+    unsigned pos = x + this->state.x;
+    uint16_t coarse_x = (v & COARSE_X_MASK) + pos / 8;
+
+    if (coarse_x >= 32)
+        v ^= NAMETABLE_X;
+
+    v = (v & ~COARSE_X_MASK) | (coarse_x & COARSE_X_MASK);
+
+    uint8_t row[8];
+    this->fetch_tile_row(v, row);
+    return row[pos % 8];
+}
+
+unsigned PPUCore::sprite_height()
+{
+    return (this->state.ctrl & CTRL_SPRITE_16) ? 16 : 8;
+}
+
+uint8_t PPUCore::sprite_pixel(size_t i, unsigned row, unsigned col)
+{
+    const uint8_t* sprite = &this->state.oam[i * SPRITE_SIZE];
+    uint8_t tile = sprite[1];
+    uint8_t attr = sprite[2];
+    unsigned height = this->sprite_height();
+    uint16_t table;
+
+    if (attr & 0x80)
+        row = height - 1 - row;
+
+    if (attr & 0x40)
+        col = 7 - col;
+
+    if (height == 16) {
+        table = (tile & 0x01) ? 0x1000 : 0x0000;
+        tile &= 0xFE;
+
+        if (row >= 8) {
+            tile++;
+            row -= 8;
+        }
+    } else {
+        table = (this->state.ctrl & CTRL_SPRITE_TABLE) ? 0x1000 : 0x0000;
+    }
+
+    uint16_t pattern = table + tile * 16 + row;
+    unsigned bit = 7 - col;
+    return ((this->read_chr(pattern) >> bit) & 0x01) | ((this->read_chr(pattern + 8) >> bit) & 0x01) << 1;
+}
+
+PPUState& PPUCore::get_state()
+{
+    return this->state;
+}
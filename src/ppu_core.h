@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* NTSC 2C02 timing, in PPU dots. A frame starts at dot 0 of the pre-render line */
+const uint32_t DOTS_PER_LINE = 341;
+const uint32_t LINES_PER_FRAME = 262;
+const uint32_t DOTS_PER_FRAME = DOTS_PER_LINE * LINES_PER_FRAME;
+const uint32_t DOTS_PER_CPU_CYCLE = 3;
+const uint32_t VISIBLE_LINES = 240;
+const uint32_t VBLANK_LINE = 241;
+const uint32_t VBLANK_DOT = (VBLANK_LINE + 1) * DOTS_PER_LINE + 1;
+const uint32_t HORIZONTAL_COPY_DOT = 257;
+const uint32_t VERTICAL_COPY_DOT = 280;
+
+enum PPURegister : uint8_t {
+    PPUCTRL,
+    PPUMASK,
+    PPUSTATUS,
+    OAMADDR,
+    OAMDATA,
+    PPUSCROLL,
+    PPUADDR,
+    PPUDATA,
+    NUM_PPU_REGS
+};
+
+enum CtrlFlag : uint8_t {
+    CTRL_NAMETABLE      = 0x03,
+    CTRL_INCREMENT_32   = 1 << 2,
+    CTRL_SPRITE_TABLE   = 1 << 3,
+    CTRL_BG_TABLE       = 1 << 4,
+    CTRL_SPRITE_16      = 1 << 5,
+    CTRL_NMI            = 1 << 7
+};
+
+enum MaskFlag : uint8_t {
+    MASK_GREYSCALE      = 1 << 0,
+    MASK_BG_LEFT        = 1 << 1,
+    MASK_SPRITES_LEFT   = 1 << 2,
+    MASK_BG             = 1 << 3,
+    MASK_SPRITES        = 1 << 4
+};
+
+enum StatusFlag : uint8_t {
+    STATUS_OVERFLOW     = 1 << 5,
+    STATUS_SPRITE0_HIT  = 1 << 6,
+    STATUS_VBLANK       = 1 << 7
+};
+
+enum Mirroring {
+    MIRROR_HORIZONTAL,
+    MIRROR_VERTICAL
+};
+
+enum PPUMemSize : size_t {
+    VRAM_SIZE = 0x800,
+    PALETTE_SIZE = 0x20,
+    OAM_SIZE = 0x100,
+    CHR_SIZE = 0x2000
+};
+
+const size_t SPRITE_SIZE = 4;
+const size_t NUM_SPRITES = OAM_SIZE / SPRITE_SIZE;
+const size_t MAX_SPRITES_PER_LINE = 8;
+
+/* Everything the PPU needs to draw, as plain data so it can be snapshotted with one copy */
+struct PPUState {
+    uint8_t     ctrl;
+    uint8_t     mask;
+    uint8_t     oam_addr;
+    uint8_t     x;              // Fine X scroll
+    uint16_t    v;              // Current VRAM address
+    uint16_t    t;              // Temporary VRAM address
+    bool        w;              // Write toggle for PPUSCROLL/PPUADDR
+    uint8_t     read_buffer;    // PPUDATA read buffer
+    uint8_t     vram[VRAM_SIZE];
+    uint8_t     palette[PALETTE_SIZE];
+    uint8_t     oam[OAM_SIZE];
+    uint8_t     chr_ram[CHR_SIZE];
+};
+
+/*
+ * Register and memory semantics shared by the CPU-side PPU and the renderer, so replaying the
+ * register log on the render thread reproduces exactly the state the CPU side saw.
+ */
+class PPUCore
+{
+protected:
+    PPUState        state;
+    const uint8_t*  chr = nullptr;  // CHR ROM, or nullptr when the cartridge has CHR RAM
+    Mirroring       mirroring = MIRROR_HORIZONTAL;
+
+    uint16_t        nametable_index(uint16_t addr);
+    uint8_t         palette_index(uint16_t addr);
+
+public:
+    PPUCore();
+
+    void            reset();
+    void            set_cartridge(const uint8_t* chr, Mirroring mirroring);
+
+    void            write_register(uint8_t reg, uint8_t val);
+    void            read_status();
+    uint8_t         read_data();
+    /* Copies a whole page into OAM, starting at OAMADDR and wrapping */
+    void            oam_dma(const uint8_t* page);
+
+    uint8_t         read_vram(uint16_t addr);
+    void            write_vram(uint16_t addr, uint8_t val);
+    uint8_t         read_chr(uint16_t addr);
+    uint8_t         read_palette(uint8_t i);
+
+    bool            rendering_enabled();
+    void            copy_horizontal();
+    void            copy_vertical();
+    void            increment_y();
+    static uint16_t next_line(uint16_t v);
+
+    /* Writes the 8 background pixels (0-15, 0 = transparent) of the tile row at VRAM address v */
+    void            fetch_tile_row(uint16_t v, uint8_t* out);
+    /* Background pixel at x of the line that starts at VRAM address v, fine X applied */
+    uint8_t         background_pixel(uint16_t v, unsigned x);
+    /* Sprite color (0-3) of OAM entry i at (row, col) within the sprite, flips applied */
+    uint8_t         sprite_pixel(size_t i, unsigned row, unsigned col);
+    unsigned        sprite_height();
+
+    PPUState&       get_state();
+};
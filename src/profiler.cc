@@ -0,0 +1,112 @@
+#include "profiler.h"
+
+Profiler::Profiler(uint64_t interval) :
+    interval(interval ? interval : 1)
+{
+    this->key.reserve(MAX_PROFILE_DEPTH);
+}
+
+void Profiler::push(uint16_t addr, uint8_t sp, FrameKind kind)
+{
+    this->unwind(sp, true);
+
+    /* Past the limit the outer frames are kept; the missing ones unwind harmlessly */
+    if (this->depth == MAX_PROFILE_DEPTH)
+        return;
+
+    this->frames[this->depth++] = { addr, sp, kind };
+}
+
+void Profiler::start(uint64_t cycle)
+{
+    this->next_sample = cycle + this->interval;
+    this->depth = 0;
+}
+
+void Profiler::enter_interrupt(uint16_t vector, uint16_t pc, uint8_t sp)
+{
+    this->push(pc, sp, vector == NMI_VECTOR ? FRAME_NMI : FRAME_IRQ);
+}
+
+void Profiler::sample(uint64_t cycles)
+{
+    uint64_t count = (cycles - this->next_sample) / this->interval + 1;
+
+    this->key.clear();
+    for (size_t i = 0; i < this->depth; i++)
+        this->key.push_back((uint32_t) this->frames[i].kind << 16 | this->frames[i].addr);
+
+    this->stacks[this->key] += count * this->interval;
+    this->samples += count;
+    this->next_sample += count * this->interval;
+}
+
+void Profiler::set_symbol(uint16_t addr, const string& name)
+{
+    this->symbols[addr] = name;
+}
+
+void Profiler::reset()
+{
+    this->stacks.clear();
+    this->samples = 0;
+}
+
+uint64_t Profiler::get_samples()
+{
+    return this->samples;
+}
+
+uint64_t Profiler::get_self_cycles(uint16_t addr)
+{
+    uint64_t total = 0;
+
+    for (const auto& stack : this->stacks) {
+        if (!stack.first.empty() && (stack.first.back() & 0xFFFF) == addr)
+            total += stack.second;
+    }
+
+    return total;
+}
+
+size_t Profiler::get_depth()
+{
+    return this->depth;
+}
+
+string Profiler::frame_name(uint32_t frame)
+{
+    const char* hex = "0123456789ABCDEF";
+    uint16_t addr = frame & 0xFFFF;
+    string name;
+
+    switch ((FrameKind) (frame >> 16)) {
+        case FRAME_NMI:
+            name = "[NMI];";
+            break;
+        case FRAME_IRQ:
+            name = "[IRQ];";
+            break;
+        case FRAME_BRK:
+            name = "[BRK];";
+            break;
+        default:
+            break;
+    }
+
+    auto symbol = this->symbols.find(addr);
+    if (symbol != this->symbols.end())
+        return name + symbol->second;
+
+    return name + "$" + hex[addr >> 12] + hex[(addr >> 8) & 0xF] + hex[(addr >> 4) & 0xF] + hex[addr & 0xF];
+}
+
+void Profiler::write_folded(ostream& out)
+{
+    for (const auto& stack : this->stacks) {
+        out << "[reset]";
+        for (uint32_t frame : stack.first)
+            out << ";" << this->frame_name(frame);
+        out << " " << dec << stack.second << "\n";
+    }
+}
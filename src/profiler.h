@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu.h"
+
+using namespace std;
+
+const uint64_t DEFAULT_SAMPLE_INTERVAL = 1000;
+const size_t MAX_PROFILE_DEPTH = 64;
+
+enum FrameKind : uint8_t {
+    FRAME_CALL,         // Entered by JSR
+    FRAME_NMI,
+    FRAME_IRQ,
+    FRAME_BRK
+};
+
+/* A routine on the guest's call stack, with the stack pointer just after it was entered */
+struct ProfileFrame {
+    uint16_t    addr;
+    uint8_t     sp;
+    FrameKind   kind;
+};
+
+/*
+ * Sampling profiler for the guest program. It follows JSR, RTS, RTI, BRK and interrupts to keep
+ * a shadow call stack, and every interval cycles charges the interval to the stack as it is. The
+ * shadow stack is matched against the stack pointer rather than trusted to balance, so routines
+ * that pull their return address to jump elsewhere, or reset the stack, cannot leave it stale.
+ */
+class Profiler
+{
+private:
+    uint64_t                    interval;
+    uint64_t                    next_sample = 0;
+    ProfileFrame                frames[MAX_PROFILE_DEPTH];
+    size_t                      depth = 0;
+    vector<uint32_t>            key;
+    map<vector<uint32_t>, uint64_t>     stacks;     // Frames, outermost first, to cycles
+    unordered_map<uint16_t, string>     symbols;
+    uint64_t                    samples = 0;
+
+    /* Drops frames whose stack space has been given back */
+    inline void unwind(uint8_t sp, bool inclusive)
+    {
+        while (this->depth && (this->frames[this->depth - 1].sp < sp ||
+                               (inclusive && this->frames[this->depth - 1].sp == sp)))
+            this->depth--;
+    }
+
+    void                        push(uint16_t addr, uint8_t sp, FrameKind kind);
+    void                        sample(uint64_t cycles);
+    string                      frame_name(uint32_t frame);
+
+public:
+    Profiler(uint64_t interval = DEFAULT_SAMPLE_INTERVAL);
+
+    /* CPU side, after each instruction with the registers it left */
+    inline void after_step(uint8_t opcode, uint16_t pc, uint8_t sp, uint64_t cycles)
+    {
+        switch (opcode) {
+            case 0x20:  // JSR
+                this->push(pc, sp, FRAME_CALL);
+                break;
+            case 0x60:  // RTS
+            case 0x40:  // RTI
+                this->unwind(sp, false);
+                break;
+            case 0x00:  // BRK
+                this->push(pc, sp, FRAME_BRK);
+                break;
+        }
+
+        if (cycles >= this->next_sample)
+            this->sample(cycles);
+    }
+
+    /* Starts sampling from cycle on with an empty stack; the CPU calls it when attached */
+    void                        start(uint64_t cycle);
+    /* CPU side, once an NMI or IRQ has been taken */
+    void                        enter_interrupt(uint16_t vector, uint16_t pc, uint8_t sp);
+
+    /* Names a routine in the output instead of its address */
+    void                        set_symbol(uint16_t addr, const string& name);
+    void                        reset();
+
+    uint64_t                    get_samples();
+    /* Cycles charged while addr was the innermost routine */
+    uint64_t                    get_self_cycles(uint16_t addr);
+    size_t                      get_depth();
+
+    /* One line per distinct stack, outermost first: "[reset];$C000;[NMI];$8082 1000" */
+    void                        write_folded(ostream& out);
+};
@@ -0,0 +1,270 @@
+#include "renderer.h"
+
+#include <cstring>
+
+const size_t INITIAL_LOG_CAPACITY = 4096;
+
+void Renderer::apply(const LogEntry& entry)
+{
+    switch (entry.kind) {
+        case LOG_WRITE:
+            this->write_register(entry.reg, entry.val);
+            break;
+        case LOG_READ_STATUS:
+            this->read_status();
+            break;
+        case LOG_READ_DATA:
+            this->read_data();
+            break;
+        case LOG_OAM_DMA:
+            this->oam_dma(this->dma_next);
+            this->dma_next += OAM_SIZE;
+            break;
+    }
+}
+
+void Renderer::render(const FrameLog& log)
+{
+    const vector<LogEntry>& entries = log.entries;
+    size_t next = 0;
+
+    auto apply_until = [&](uint32_t dot) {
+        while (next < entries.size() && entries[next].dot < dot)
+            this->apply(entries[next++]);
+    };
+
+    uint8_t* out = this->target ? this->target->next_target() : this->frame_buffer;
+
+    this->state = log.start;
+    this->dma_next = log.dma_data.data();
+
+    /* Pre-render line: v is reloaded from t before the first visible line */
+    apply_until(HORIZONTAL_COPY_DOT);
+
+    if (this->rendering_enabled())
+        this->copy_horizontal();
+
+    apply_until(VERTICAL_COPY_DOT);
+
+    if (this->rendering_enabled())
+        this->copy_vertical();
+
+    for (unsigned y = 0; y < VISIBLE_LINES; y++) {
+        uint32_t line_start = (y + 1) * DOTS_PER_LINE;
+
+        /* Accesses made during a line take effect from the next one */
+        apply_until(line_start);
+        this->render_line(y, &out[y * FRAME_WIDTH]);
+
+        if (this->rendering_enabled())
+            this->increment_y();
+
+        apply_until(line_start + HORIZONTAL_COPY_DOT);
+
+        if (this->rendering_enabled())
+            this->copy_horizontal();
+    }
+
+    apply_until(DOTS_PER_FRAME);
+    this->last_frame = out;
+
+    if (this->target)
+        this->target->present_target(log.frame);
+}
+
+void Renderer::render_line(unsigned y, uint8_t* out)
+{
+    const PPUState& s = this->state;
+    uint8_t bg[FRAME_WIDTH + 16] = { 0 };
+    uint8_t sprites[FRAME_WIDTH] = { 0 };
+    bool behind[FRAME_WIDTH] = { false };
+
+    if (s.mask & MASK_BG) {
+        uint16_t v = s.v;
+
+        for (size_t tile = 0; tile <= FRAME_WIDTH / 8; tile++) {
+            this->fetch_tile_row(v, &bg[tile * 8]);
+
+            if ((v & 0x001F) == 31)
+                v = (v & ~0x001F) ^ 0x0400;
+            else
+                v++;
+        }
+
+        if (s.x)
+            memmove(bg, bg + s.x, FRAME_WIDTH);
+
+        if (!(s.mask & MASK_BG_LEFT))
+            memset(bg, 0, 8);
+    }
+
+    if (s.mask & MASK_SPRITES) {
+        unsigned height = this->sprite_height();
+        size_t found = 0;
+
+        /* Lower OAM indices win, so later sprites never overwrite a pixel already taken */
+        for (size_t i = 0; i < NUM_SPRITES && found < MAX_SPRITES_PER_LINE; i++) {
+            const uint8_t* sprite = &s.oam[i * SPRITE_SIZE];
+            unsigned row = y - (sprite[0] + 1u);
+
+            if (y < sprite[0] + 1u || row >= height)
+                continue;
+
+            found++;
+
+            for (unsigned col = 0; col < 8; col++) {
+                unsigned x = sprite[3] + col;
+
+                if (x >= FRAME_WIDTH || sprites[x])
+                    continue;
+
+                uint8_t px = this->sprite_pixel(i, row, col);
+
+                if (px) {
+                    sprites[x] = 0x10 | (sprite[2] & 0x03) << 2 | px;
+                    behind[x] = sprite[2] & 0x20;
+                }
+            }
+        }
+
+        if (!(s.mask & MASK_SPRITES_LEFT))
+            memset(sprites, 0, 8);
+    }
+
+    for (size_t x = 0; x < FRAME_WIDTH; x++) {
+        uint8_t i = 0;
+
+        if (sprites[x] && (!bg[x] || !behind[x]))
+            i = sprites[x];
+        else if (bg[x])
+            i = bg[x];
+
+        out[x] = this->read_palette(i) & PALETTE_INDEX_MASK;
+    }
+}
+
+void Renderer::set_target(FrameTarget* target)
+{
+    /* The old target may be unmapped once detached, so keep the last frame locally */
+    if (this->last_frame != this->frame_buffer)
+        memcpy(this->frame_buffer, this->last_frame, FRAME_PIXELS);
+
+    this->last_frame = this->frame_buffer;
+    this->target = target;
+}
+
+const uint8_t* Renderer::get_frame_buffer()
+{
+    return this->last_frame;
+}
+
+RenderPipeline::RenderPipeline(const FrameSink& sink) :
+    sink(sink),
+    stopping(false),
+    sleeping(false),
+    num_submitted(0),
+    num_rendered(0)
+{
+    for (FrameLog& slot : this->slots) {
+        slot.entries.reserve(INITIAL_LOG_CAPACITY);
+        this->free_slots.push(&slot);
+    }
+
+    this->worker = thread(&RenderPipeline::worker_loop, this);
+}
+
+RenderPipeline::~RenderPipeline()
+{
+    this->stopping.store(true);
+
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->wake.notify_one();
+    }
+
+    this->worker.join();
+}
+
+void RenderPipeline::set_cartridge(const uint8_t* chr, Mirroring mirroring)
+{
+    this->sync();
+    this->renderer.set_cartridge(chr, mirroring);
+}
+
+void RenderPipeline::set_target(FrameTarget* target)
+{
+    this->sync();
+    this->renderer.set_target(target);
+}
+
+void RenderPipeline::worker_loop()
+{
+    for (;;) {
+        FrameLog* log;
+
+        if (this->submitted.pop(log)) {
+            this->renderer.render(*log);
+
+            if (this->sink)
+                this->sink(this->renderer.get_frame_buffer(), log->frame);
+
+            this->free_slots.push(log);
+            this->num_rendered.fetch_add(1, memory_order_release);
+            continue;
+        }
+
+        if (this->stopping.load())
+            return;
+
+        unique_lock<mutex> guard(this->lock);
+        this->sleeping.store(true);
+        atomic_thread_fence(memory_order_seq_cst);
+        this->wake.wait(guard, [&] { return this->stopping.load() || !this->submitted.empty(); });
+        this->sleeping.store(false);
+    }
+}
+
+FrameLog* RenderPipeline::acquire()
+{
+    FrameLog* log;
+
+    if (!this->free_slots.pop(log)) {
+        this->num_skipped++;
+        return nullptr;
+    }
+
+    return log;
+}
+
+void RenderPipeline::submit(FrameLog* log)
+{
+    this->submitted.push(log);
+    this->num_submitted.fetch_add(1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (this->sleeping.load()) {
+        lock_guard<mutex> guard(this->lock);
+        this->wake.notify_one();
+    }
+}
+
+void RenderPipeline::sync()
+{
+    while (this->num_rendered.load(memory_order_acquire) < this->num_submitted.load(memory_order_relaxed))
+        this_thread::yield();
+}
+
+const uint8_t* RenderPipeline::get_frame_buffer()
+{
+    return this->renderer.get_frame_buffer();
+}
+
+uint64_t RenderPipeline::get_rendered()
+{
+    return this->num_rendered.load(memory_order_acquire);
+}
+
+uint64_t RenderPipeline::get_skipped()
+{
+    return this->num_skipped;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ppu_core.h"
+#include "spsc_ring.h"
+#include "video.h"
+
+using namespace std;
+
+enum LogKind : uint8_t {
+    LOG_WRITE,          // Register write
+    LOG_READ_STATUS,    // PPUSTATUS read, resets the write toggle
+    LOG_READ_DATA,      // PPUDATA read, advances v
+    LOG_OAM_DMA         // OAM DMA, the page is the next OAM_SIZE bytes of FrameLog::dma_data
+};
+
+/* One CPU-side PPU register access, stamped with its dot within the frame */
+struct LogEntry {
+    uint32_t    dot;
+    LogKind     kind;
+    uint8_t     reg;
+    uint8_t     val;
+};
+
+/*
+ * Everything the renderer needs for one frame: the PPU state at the start of the pre-render
+ * line, plus every register access made before vblank. Accesses during vblank are not logged;
+ * they end up in the next frame's starting state instead.
+ */
+struct FrameLog {
+    uint64_t            frame;
+    PPUState            start;
+    vector<LogEntry>    entries;
+    vector<uint8_t>     dma_data;
+};
+
+typedef function<void(const uint8_t* pixels, uint64_t frame)> FrameSink;
+
+/* Memory owned by a consumer that frames are rendered straight into, so they are never copied */
+class FrameTarget
+{
+public:
+    virtual ~FrameTarget() {}
+
+    /* Buffer of FRAME_PIXELS for the next frame, written until present_target() */
+    virtual uint8_t*    next_target() = 0;
+    /* The buffer from next_target() now holds frame */
+    virtual void        present_target(uint64_t frame) = 0;
+};
+
+/* Replays a FrameLog scanline by scanline into a frame of palette indices */
+class Renderer : public PPUCore
+{
+private:
+    uint8_t         frame_buffer[FRAME_PIXELS];
+    const uint8_t*  last_frame = frame_buffer;
+    FrameTarget*    target = nullptr;
+    const uint8_t*  dma_next = nullptr;
+
+    void        apply(const LogEntry& entry);
+    void        render_line(unsigned y, uint8_t* out);
+
+public:
+    void            render(const FrameLog& log);
+    /* Renders into target's buffers from the next frame on; nullptr goes back to the own buffer */
+    void            set_target(FrameTarget* target);
+    /* The last frame rendered, wherever it was rendered to */
+    const uint8_t*  get_frame_buffer();
+};
+
+const size_t NUM_LOG_SLOTS = 4;
+
+/*
+ * Renders frame N on its own thread while the CPU emulates frame N+1. Logs travel between the
+ * two threads through a pair of lock-free rings; the CPU side only touches the mutex to wake
+ * the render thread when it has gone to sleep. If every slot is still in flight the frame is
+ * skipped rather than making the CPU wait.
+ */
+class RenderPipeline
+{
+private:
+    Renderer                        renderer;
+    FrameLog                        slots[NUM_LOG_SLOTS];
+    SpscRing<FrameLog*, NUM_LOG_SLOTS> submitted;
+    SpscRing<FrameLog*, NUM_LOG_SLOTS> free_slots;
+    FrameSink                       sink;
+    atomic<bool>                    stopping;
+    atomic<bool>                    sleeping;
+    atomic<uint64_t>                num_submitted;
+    atomic<uint64_t>                num_rendered;
+    uint64_t                        num_skipped = 0;
+    mutex                           lock;
+    condition_variable              wake;
+    thread                          worker;
+
+    void                            worker_loop();
+
+public:
+    RenderPipeline(const FrameSink& sink);
+    ~RenderPipeline();
+
+    RenderPipeline(const RenderPipeline&) = delete;
+    RenderPipeline& operator=(const RenderPipeline&) = delete;
+
+    void            set_cartridge(const uint8_t* chr, Mirroring mirroring);
+    void            set_target(FrameTarget* target);
+
+    /* CPU side: returns nullptr (and counts a skipped frame) when no slot is free */
+    FrameLog*       acquire();
+    void            submit(FrameLog* log);
+    /* Blocks until every submitted frame has been rendered */
+    void            sync();
+
+    const uint8_t*  get_frame_buffer();
+    uint64_t        get_rendered();
+    uint64_t        get_skipped();
+};
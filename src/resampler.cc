@@ -0,0 +1,125 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE__
+    #include <xmmintrin.h>
+    #define RESAMPLER_HAVE_SSE
+#endif
+
+const double RESAMPLER_PI = 3.14159265358979323846;
+const double RESAMPLER_CUTOFF = 0.9;    // Fraction of the lower Nyquist frequency kept
+
+#ifdef RESAMPLER_HAVE_SSE
+static float dot(const float* a, const float* b)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    for (size_t i = 0; i < RESAMPLER_TAPS; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+#else
+static float dot(const float* a, const float* b)
+{
+    float sum = 0.0f;
+
+    for (size_t i = 0; i < RESAMPLER_TAPS; i++)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+#endif
+
+Resampler::Resampler(double input_rate, double output_rate) :
+    input_rate(input_rate),
+    output_rate(output_rate),
+    kernel(RESAMPLER_PHASES * RESAMPLER_TAPS),
+    history(RESAMPLER_TAPS - 1, 0.0f)
+{
+    /* When downsampling the cutoff follows the output rate, so nothing above its Nyquist aliases */
+    const double cutoff = RESAMPLER_CUTOFF * min(1.0, output_rate / input_rate);
+    const double half = RESAMPLER_TAPS / 2.0;
+
+    for (size_t p = 0; p < RESAMPLER_PHASES; p++) {
+        double frac = (double) p / RESAMPLER_PHASES;
+        double sum = 0.0;
+        float* taps = &this->kernel[p * RESAMPLER_TAPS];
+
+        for (size_t k = 0; k < RESAMPLER_TAPS; k++) {
+            double t = (double) k - half + 1.0 - frac;
+            double x = RESAMPLER_PI * cutoff * t;
+            double sinc = (t == 0.0) ? 1.0 : sin(x) / x;
+            double w = (t + half) / RESAMPLER_TAPS;
+            double window = (w <= 0.0 || w >= 1.0) ? 0.0
+                : 0.42 - 0.5 * cos(2.0 * RESAMPLER_PI * w) + 0.08 * cos(4.0 * RESAMPLER_PI * w);
+            taps[k] = (float) (sinc * window);
+            sum += taps[k];
+        }
+
+        for (size_t k = 0; k < RESAMPLER_TAPS; k++)
+            taps[k] = (float) (taps[k] / sum);
+    }
+
+    this->set_rate_adjust(0.0);
+}
+
+double Resampler::get_input_rate()
+{
+    return this->input_rate;
+}
+
+double Resampler::get_output_rate()
+{
+    return this->output_rate;
+}
+
+void Resampler::set_rate_adjust(double adjust)
+{
+    adjust = max(-MAX_RATE_ADJUST, min(MAX_RATE_ADJUST, adjust));
+    double ratio = this->input_rate / (this->output_rate * (1.0 + adjust));
+    this->step = (uint64_t) (ratio * (double) (1ULL << RESAMPLER_FRAC_BITS));
+}
+
+void Resampler::update_rate(size_t queued, size_t target)
+{
+    if (target == 0)
+        return;
+
+    this->set_rate_adjust(MAX_RATE_ADJUST * ((double) target - (double) queued) / (double) target);
+}
+
+size_t Resampler::process(const int16_t* in, size_t count, int16_t* out, size_t max_out)
+{
+    for (size_t i = 0; i < count; i++)
+        this->history.push_back(in[i]);
+
+    const size_t available = this->history.size();
+    size_t produced = 0;
+
+    while (produced < max_out) {
+        size_t index = this->position >> RESAMPLER_FRAC_BITS;
+
+        if (index + RESAMPLER_TAPS > available)
+            break;
+
+        size_t phase = (this->position >> (RESAMPLER_FRAC_BITS - RESAMPLER_PHASE_BITS)) & (RESAMPLER_PHASES - 1);
+        float s = dot(&this->history[index], &this->kernel[phase * RESAMPLER_TAPS]);
+        out[produced++] = (int16_t) max(-32768.0f, min(32767.0f, s));
+        this->position += this->step;
+    }
+
+    /* Keep only what later outputs can still reach */
+    size_t consumed = min((size_t) (this->position >> RESAMPLER_FRAC_BITS), available);
+    this->history.erase(this->history.begin(), this->history.begin() + consumed);
+    this->position -= (uint64_t) consumed << RESAMPLER_FRAC_BITS;
+
+    return produced;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+const size_t RESAMPLER_TAPS = 32;
+const unsigned RESAMPLER_PHASE_BITS = 8;
+const size_t RESAMPLER_PHASES = 1 << RESAMPLER_PHASE_BITS;
+const unsigned RESAMPLER_FRAC_BITS = 32;
+const double MAX_RATE_ADJUST = 0.005;   // Largest pitch change dynamic rate control may apply
+
+/*
+ * Polyphase windowed-sinc resampler. Each output sample is one RESAMPLER_TAPS dot product
+ * against the filter phase nearest its fractional input position, done with SSE where the
+ * host has it. The ratio can be nudged while running to track the host's audio clock.
+ */
+class Resampler
+{
+private:
+    double          input_rate;
+    double          output_rate;
+    uint64_t        step;           // Input samples per output sample, 32.32 fixed point
+    uint64_t        position = 0;   // Fractional read position within history
+    vector<float>   kernel;         // RESAMPLER_PHASES x RESAMPLER_TAPS
+    vector<float>   history;
+
+public:
+    Resampler(double input_rate, double output_rate);
+
+    double          get_input_rate();
+    double          get_output_rate();
+
+    /* Stretches the output by (1 + adjust), clamped to MAX_RATE_ADJUST */
+    void            set_rate_adjust(double adjust);
+    /*
+     * Dynamic rate control: steers the consumer's queue towards target samples by running
+     * slightly fast when it is draining and slightly slow when it is filling.
+     */
+    void            update_rate(size_t queued, size_t target);
+
+    /* Consumes all count input samples, returns the number of output samples written */
+    size_t          process(const int16_t* in, size_t count, int16_t* out, size_t max_out);
+};
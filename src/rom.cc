@@ -11,12 +11,20 @@ const size_t HEADER_FLAGS6_SIZE                 = 1;
 const size_t HEADER_FLAGS7_SIZE                 = 1;
 const size_t HEADER_8_15_CONSTANT_SIZE          = 8;
 
+const size_t TRAINER_SIZE                       = 512;
+const size_t PRG_ROM_PAGE_SIZE                  = 0x4000;
+const size_t CHR_ROM_PAGE_SIZE                  = 0x2000;
+
+const uint8_t FLAGS6_VERTICAL_MIRRORING         = 1 << 0;
+const uint8_t FLAGS6_TRAINER                    = 1 << 2;
+
 const uint8_t HEADER_CONSTANT[4]                = { 'N', 'E', 'S', 0x1A };
 const uint8_t HEADER_8_15_CONSTANT[8]           = { 0 };
 
 
 ROM::ROM(const string& fname) :
-    rom(new ifstream())
+    rom(new ifstream()),
+    valid(false)
 {
     this->rom->open(fname, ios::binary);
     
@@ -26,6 +34,10 @@ ROM::ROM(const string& fname) :
     
     if (!read_header()) {
         cerr << "ERROR: Invalid ROM format - failed header check.\n";
+    } else if (!read_data()) {
+        cerr << "ERROR: Invalid ROM format - truncated PRG/CHR data.\n";
+    } else {
+        this->valid = true;
     }
 }
 
@@ -56,6 +68,19 @@ bool ROM::read_header()
     return true;
 }
 
+bool ROM::read_data()
+{
+    if (this->flags6 & FLAGS6_TRAINER)
+        rom->seekg(TRAINER_SIZE, ios::cur);
+    
+    this->prg_rom.resize(this->prg_rom_pages * PRG_ROM_PAGE_SIZE);
+    this->chr_rom.resize(this->char_rom_pages * CHR_ROM_PAGE_SIZE);
+    rom->read(reinterpret_cast<char*>(this->prg_rom.data()), this->prg_rom.size());
+    rom->read(reinterpret_cast<char*>(this->chr_rom.data()), this->chr_rom.size());
+    
+    return !rom->fail();
+}
+
 uint8_t ROM::get_char_rom_pages()
 {
     return this->char_rom_pages;
@@ -75,3 +100,28 @@ uint8_t ROM::get_flags7()
 {
     return this->flags7;
 }
+
+uint8_t ROM::get_mapper()
+{
+    return (this->flags6 >> 4) | (this->flags7 & 0xF0);
+}
+
+bool ROM::has_vertical_mirroring()
+{
+    return this->flags6 & FLAGS6_VERTICAL_MIRRORING;
+}
+
+bool ROM::is_valid()
+{
+    return this->valid;
+}
+
+const vector<uint8_t>& ROM::get_prg_rom()
+{
+    return this->prg_rom;
+}
+
+const vector<uint8_t>& ROM::get_chr_rom()
+{
+    return this->chr_rom;
+}
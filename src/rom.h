@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <fstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -14,8 +15,12 @@ private:
     uint8_t     flags6;
     uint8_t     flags7;
     ifstream*   rom;
+    bool        valid;
+    vector<uint8_t> prg_rom;
+    vector<uint8_t> chr_rom;
     
     bool read_header();
+    bool read_data();
     
 public:
     ROM(const string& fname);
@@ -25,5 +30,11 @@ public:
     uint8_t get_char_rom_pages();
     uint8_t get_flags6();
     uint8_t get_flags7();
+    uint8_t get_mapper();
+    bool    has_vertical_mirroring();
+    bool    is_valid();
+    
+    const vector<uint8_t>& get_prg_rom();
+    const vector<uint8_t>& get_chr_rom();
 };
 
@@ -0,0 +1,88 @@
+#include "run_ahead.h"
+
+RunAheadThread::RunAheadThread(NES& main, unsigned frames) :
+    nes(new NES()),
+    frames(frames),
+    pending(new NESSnapshot()),
+    working(new NESSnapshot())
+{
+    FrameOutput& output = main.get_output();
+
+    this->nes->copy_cartridge(main);
+    this->nes->get_ppu().set_frame_sink([this, &output](const uint8_t* pixels, uint64_t frame) {
+        if (!this->target)
+            output.publish_frame(pixels, frame);
+    });
+    this->worker = thread(&RunAheadThread::worker_loop, this);
+}
+
+RunAheadThread::~RunAheadThread()
+{
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stopping = true;
+    }
+
+    this->wake.notify_one();
+    this->worker.join();
+}
+
+void RunAheadThread::worker_loop()
+{
+    unique_lock<mutex> guard(this->lock);
+
+    for (;;) {
+        this->wake.wait(guard, [this] { return this->fresh || this->stopping; });
+
+        if (this->stopping)
+            return;
+
+        swap(this->pending, this->working);
+        this->fresh = false;
+        this->busy = true;
+        guard.unlock();
+
+        this->nes->load_state(*this->working);
+
+        for (unsigned i = 1; i <= this->frames; i++)
+            this->nes->emulate_frame(i == this->frames, false);
+
+        guard.lock();
+        this->busy = false;
+        this->idle.notify_all();
+    }
+}
+
+void RunAheadThread::submit(unique_ptr<NESSnapshot>& snap)
+{
+    {
+        lock_guard<mutex> guard(this->lock);
+
+        if (this->fresh)
+            this->replaced++;
+
+        swap(snap, this->pending);
+        this->fresh = true;
+    }
+
+    this->wake.notify_one();
+}
+
+void RunAheadThread::sync()
+{
+    unique_lock<mutex> guard(this->lock);
+    this->idle.wait(guard, [this] { return !this->fresh && !this->busy; });
+}
+
+void RunAheadThread::set_frame_target(FrameTarget* target)
+{
+    this->sync();
+    this->target = target;
+    this->nes->set_frame_target(target);
+}
+
+uint64_t RunAheadThread::get_replaced()
+{
+    lock_guard<mutex> guard(this->lock);
+    return this->replaced;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "nes.h"
+
+using namespace std;
+
+/*
+ * Second console for threaded run-ahead. The main instance hands over a snapshot after every
+ * real frame; this thread loads it, emulates the frames ahead with the input in it and
+ * publishes the last one to the main instance's output. A snapshot that arrives while the
+ * previous one is still running replaces the one waiting, so the main thread never blocks.
+ */
+class RunAheadThread
+{
+private:
+    unique_ptr<NES>         nes;
+    unsigned                frames;
+    FrameTarget*            target = nullptr;
+    unique_ptr<NESSnapshot> pending;
+    unique_ptr<NESSnapshot> working;
+    bool                    fresh = false;
+    bool                    busy = false;
+    bool                    stopping = false;
+    uint64_t                replaced = 0;
+    mutex                   lock;
+    condition_variable      wake;
+    condition_variable      idle;
+    thread                  worker;
+
+    void                    worker_loop();
+
+public:
+    RunAheadThread(NES& main, unsigned frames);
+    ~RunAheadThread();
+
+    RunAheadThread(const RunAheadThread&) = delete;
+    RunAheadThread& operator=(const RunAheadThread&) = delete;
+
+    /* Swaps snap with the waiting slot, so the caller gets a free buffer back */
+    void                    submit(unique_ptr<NESSnapshot>& snap);
+    /* Waits until the newest snapshot has been run and its frame published */
+    void                    sync();
+    /* Renders the frames ahead into target instead of the main output; waits for the one running */
+    void                    set_frame_target(FrameTarget* target);
+    /* Snapshots dropped because a newer one arrived before they were picked up */
+    uint64_t                get_replaced();
+};
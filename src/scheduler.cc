@@ -0,0 +1,233 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "timeline.h"
+
+/* Weight of the newest frame in a session's cost average, as a shift */
+const unsigned COST_AVERAGE_SHIFT = 3;
+
+template <typename T>
+static bool later_release(const T* a, const T* b)
+{
+    return a->release > b->release;
+}
+
+template <typename T>
+static bool later_deadline(const T* a, const T* b)
+{
+    return a->deadline > b->deadline;
+}
+
+SessionScheduler::SessionScheduler(size_t num_workers, double max_utilization) :
+    max_utilization(max_utilization)
+{
+    for (size_t i = 0; i < max(num_workers, (size_t) 1); i++)
+        this->workers.emplace_back(&SessionScheduler::worker_loop, this);
+}
+
+SessionScheduler::~SessionScheduler()
+{
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stopping = true;
+    }
+
+    this->wake.notify_all();
+
+    for (thread& worker : this->workers)
+        worker.join();
+}
+
+void SessionScheduler::queue(Session* session)
+{
+    this->pending.push_back(session);
+    push_heap(this->pending.begin(), this->pending.end(), later_release<Session>);
+}
+
+/* Releases every frame that is due and picks the earliest deadline, sleeping until there is one */
+SessionScheduler::Session* SessionScheduler::next_ready(unique_lock<mutex>& guard)
+{
+    for (;;) {
+        if (this->stopping)
+            return nullptr;
+
+        uint64_t now = Timeline::now();
+
+        while (!this->pending.empty() && this->pending.front()->release <= now) {
+            pop_heap(this->pending.begin(), this->pending.end(), later_release<Session>);
+            this->ready.push_back(this->pending.back());
+            push_heap(this->ready.begin(), this->ready.end(), later_deadline<Session>);
+            this->pending.pop_back();
+        }
+
+        if (!this->ready.empty()) {
+            pop_heap(this->ready.begin(), this->ready.end(), later_deadline<Session>);
+            Session* session = this->ready.back();
+            this->ready.pop_back();
+            return session;
+        }
+
+        if (this->pending.empty()) {
+            this->wake.wait(guard);
+        } else {
+            chrono::steady_clock::time_point at(chrono::nanoseconds(this->pending.front()->release));
+            this->wake.wait_until(guard, at);
+        }
+    }
+}
+
+void SessionScheduler::finish(Session* session, uint64_t start, uint64_t end)
+{
+    HostedSessionStats& s = session->stats;
+    uint64_t cost = end - start;
+    int64_t late = (int64_t) (end - session->deadline);
+
+    s.cost_ns = s.frames ? s.cost_ns - (s.cost_ns >> COST_AVERAGE_SHIFT) + (cost >> COST_AVERAGE_SHIFT) : cost;
+    s.max_cost_ns = max(s.max_cost_ns, cost);
+    s.frames++;
+    this->stats.frames++;
+
+    if (late > 0) {
+        s.misses++;
+        this->stats.misses++;
+    }
+
+    int64_t bucket = (late + LATENESS_FLOOR_NS) / (int64_t) LATENESS_BUCKET_NS;
+    this->lateness[min(max(bucket, (int64_t) 0), (int64_t) LATENESS_BUCKETS - 1)]++;
+    this->stats.lateness_max_ns = this->stats.frames == 1 ? late : max(this->stats.lateness_max_ns, late);
+
+    /* Frames already a whole period late are not worth running: start again from now */
+    session->release += session->period_ns;
+    if (session->release + session->period_ns <= end) {
+        session->release = end;
+        s.resyncs++;
+        this->stats.resyncs++;
+    }
+    session->deadline = session->release + session->period_ns;
+}
+
+void SessionScheduler::worker_loop()
+{
+    unique_lock<mutex> guard(this->lock);
+
+    for (;;) {
+        Session* session = this->next_ready(guard);
+        if (!session)
+            return;
+
+        session->running = true;
+        guard.unlock();
+
+        uint64_t start = Timeline::now();
+        session->frame();
+        uint64_t end = Timeline::now();
+
+        guard.lock();
+        session->running = false;
+        this->finish(session, start, end);
+        this->queue(session);
+        this->done.notify_all();
+    }
+}
+
+double SessionScheduler::load()
+{
+    double total = 0;
+
+    for (auto& entry : this->sessions)
+        total += (double) entry.second->stats.cost_ns / entry.second->period_ns;
+
+    return total;
+}
+
+int SessionScheduler::add_session(const function<void()>& frame, uint64_t period_ns, uint64_t cost_ns)
+{
+    lock_guard<mutex> guard(this->lock);
+
+    if (cost_ns == 0) {
+        for (auto& entry : this->sessions)
+            cost_ns = max(cost_ns, entry.second->stats.cost_ns);
+    }
+
+    if (this->load() + (double) cost_ns / period_ns > this->max_utilization * this->workers.size()) {
+        this->stats.rejected++;
+        return -1;
+    }
+
+    unique_ptr<Session> session(new Session());
+    session->frame = frame;
+    session->period_ns = period_ns;
+    session->release = Timeline::now();
+    session->deadline = session->release + period_ns;
+    session->running = false;
+    session->stats.cost_ns = cost_ns;   // Until the first frame is measured
+
+    int id = this->next_id++;
+    this->queue(session.get());
+    this->sessions[id] = move(session);
+    this->wake.notify_one();
+    return id;
+}
+
+void SessionScheduler::remove_session(int id)
+{
+    unique_lock<mutex> guard(this->lock);
+    auto it = this->sessions.find(id);
+
+    if (it == this->sessions.end())
+        return;
+
+    Session* session = it->second.get();
+    this->done.wait(guard, [&] { return !session->running; });
+
+    for (vector<Session*>* heap : { &this->pending, &this->ready }) {
+        heap->erase(remove(heap->begin(), heap->end(), session), heap->end());
+    }
+    make_heap(this->pending.begin(), this->pending.end(), later_release<Session>);
+    make_heap(this->ready.begin(), this->ready.end(), later_deadline<Session>);
+
+    this->sessions.erase(it);
+}
+
+double SessionScheduler::get_utilization()
+{
+    lock_guard<mutex> guard(this->lock);
+    return this->load() / this->workers.size();
+}
+
+HostedSessionStats SessionScheduler::get_session_stats(int id)
+{
+    lock_guard<mutex> guard(this->lock);
+    auto it = this->sessions.find(id);
+    return it == this->sessions.end() ? HostedSessionStats() : it->second->stats;
+}
+
+/* Upper edge of the bucket holding the p quantile, so it never flatters, capped at the worst seen */
+int64_t SessionScheduler::lateness_percentile(double p)
+{
+    uint64_t target = (uint64_t) (p * this->stats.frames);
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < LATENESS_BUCKETS; i++) {
+        seen += this->lateness[i];
+        if (seen > target)
+            return min((int64_t) ((i + 1) * LATENESS_BUCKET_NS) - LATENESS_FLOOR_NS, this->stats.lateness_max_ns);
+    }
+
+    return this->stats.lateness_max_ns;
+}
+
+SchedulerStats SessionScheduler::get_stats()
+{
+    lock_guard<mutex> guard(this->lock);
+    SchedulerStats stats = this->stats;
+
+    if (stats.frames) {
+        stats.lateness_p50_ns = this->lateness_percentile(0.5);
+        stats.lateness_p99_ns = this->lateness_percentile(0.99);
+    }
+
+    return stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/* Share of every worker admission control lets the sessions' estimated frame costs fill */
+const double DEFAULT_MAX_UTILIZATION = 0.85;
+/* Lateness histogram: LATENESS_BUCKETS buckets of LATENESS_BUCKET_NS, the first at -LATENESS_FLOOR_NS */
+const uint64_t LATENESS_BUCKET_NS = 100000;
+const size_t LATENESS_BUCKETS = 1000;
+const int64_t LATENESS_FLOOR_NS = 25000000;
+
+struct HostedSessionStats {
+    uint64_t    frames;
+    uint64_t    misses;         // Frames finished after their deadline
+    uint64_t    resyncs;        // Times the session fell a whole period behind and was re-released
+    uint64_t    cost_ns;        // Moving average of a frame's run time
+    uint64_t    max_cost_ns;
+};
+
+struct SchedulerStats {
+    uint64_t    frames;
+    uint64_t    misses;
+    uint64_t    resyncs;
+    uint64_t    rejected;       // Sessions refused by admission control
+    int64_t     lateness_p50_ns;    // Finish minus deadline; negative is slack left
+    int64_t     lateness_p99_ns;
+    int64_t     lateness_max_ns;
+};
+
+/*
+ * Runs many real-time sessions, one frame at a time, on a fixed set of worker threads. Frame k
+ * of a session is released at its start plus k periods and is due one period later; workers
+ * always take the released frame with the earliest deadline. A session whose frame is still
+ * running is not eligible, so a session never runs on two workers at once.
+ *
+ * A session is admitted only while the sum of cost / period over all sessions stays under
+ * max_utilization per worker, costs being measured as frames run.
+ */
+class SessionScheduler
+{
+private:
+    struct Session {
+        function<void()>    frame;
+        uint64_t            period_ns;
+        uint64_t            release;
+        uint64_t            deadline;
+        bool                running;
+        HostedSessionStats  stats;
+    };
+
+    vector<thread>      workers;
+    mutex               lock;
+    condition_variable  wake;
+    condition_variable  done;
+    map<int, unique_ptr<Session>> sessions;
+    vector<Session*>    pending;    // Heap on release time
+    vector<Session*>    ready;      // Heap on deadline
+    double              max_utilization;
+    int                 next_id = 0;
+    uint64_t            lateness[LATENESS_BUCKETS] = {};
+    SchedulerStats      stats = {};
+    bool                stopping = false;
+
+    void        worker_loop();
+    void        queue(Session* session);
+    Session*    next_ready(unique_lock<mutex>& guard);
+    void        finish(Session* session, uint64_t start, uint64_t end);
+    double      load();
+    int64_t     lateness_percentile(double p);
+
+public:
+    SessionScheduler(size_t num_workers, double max_utilization = DEFAULT_MAX_UTILIZATION);
+    ~SessionScheduler();
+
+    SessionScheduler(const SessionScheduler&) = delete;
+    SessionScheduler& operator=(const SessionScheduler&) = delete;
+
+    /*
+     * frame runs one frame of the session, typically [&nes] { nes.run_frame(); }, and its first
+     * frame is released straight away. cost_ns is the expected run time of a frame; with 0 the
+     * costliest frame average measured so far is assumed. Returns the session's id, or -1 if it
+     * does not fit.
+     */
+    int         add_session(const function<void()>& frame, uint64_t period_ns, uint64_t cost_ns = 0);
+    /* Waits for the session's running frame, if any, to finish */
+    void        remove_session(int id);
+
+    /* Sum of cost / period over the sessions, per worker */
+    double      get_utilization();
+    HostedSessionStats get_session_stats(int id);
+    SchedulerStats get_stats();
+};
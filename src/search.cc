@@ -0,0 +1,177 @@
+#include "search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "state_hash.h"
+#include "thread_pool.h"
+
+struct SearchNode {
+    unique_ptr<NESSnapshot> snap;
+    uint64_t    hash;
+    double      score;
+    size_t      parent;     // Index in the previous level
+    uint8_t     input;
+};
+
+/* A step back along a kept node's path; nodes themselves are dropped with their level */
+struct SearchLink {
+    size_t      parent;
+    uint8_t     input;
+};
+
+static bool better(const SearchNode& a, const SearchNode& b)
+{
+    return a.score != b.score ? a.score > b.score : a.hash < b.hash;
+}
+
+/* Groups equal states, each led by the way of reaching it from the lowest parent and input */
+static bool by_origin(const SearchNode& a, const SearchNode& b)
+{
+    if (a.hash != b.hash)
+        return a.hash < b.hash;
+    return a.parent != b.parent ? a.parent < b.parent : a.input < b.input;
+}
+
+StateSearch::StateSearch(NES& start, const SearchConfig& config, const function<double(NES&)>& score) :
+    start(start),
+    config(config),
+    score(score)
+{
+}
+
+SearchResult StateSearch::run()
+{
+    uint64_t began = Timeline::now();
+    SearchResult result = {};
+    StateSet seen(this->config.max_states);
+    ThreadPool pool(this->config.threads);
+
+    vector<unique_ptr<NES>> consoles;
+    for (size_t i = 0; i <= pool.size(); i++) {
+        consoles.emplace_back(new NES());
+        consoles.back()->copy_cartridge(this->start);
+    }
+
+    vector<SearchNode> frontier(1);
+    frontier[0].snap.reset(new NESSnapshot());
+    this->start.save_state(*frontier[0].snap);
+    frontier[0].hash = this->start.hash_state();
+    frontier[0].score = this->score(this->start);
+    seen.insert(frontier[0].hash);
+
+    /* The best node is always first in its level once sorted */
+    result.score = frontier[0].score;
+    result.hash = frontier[0].hash;
+    size_t best_level = 0;
+    vector<vector<SearchLink>> links(1, vector<SearchLink>(1));
+    atomic<uint64_t> duplicates(0);
+
+    for (unsigned level = 1; level <= this->config.depth && !frontier.empty(); level++) {
+        vector<vector<SearchNode>> found(consoles.size());
+        atomic<size_t> next(0);
+        /* Sized for every child, so it never fills; seen itself only changes between levels */
+        StateSet level_seen(frontier.size() * this->config.inputs.size());
+
+        /* One item per console; each takes frontier states until none are left */
+        pool.parallel_for(consoles.size(), [&](size_t worker) {
+            NES& nes = *consoles[worker];
+            size_t i;
+
+            while ((i = next.fetch_add(1, memory_order_relaxed)) < frontier.size()) {
+                for (uint8_t input : this->config.inputs) {
+                    nes.load_state(*frontier[i].snap);
+                    nes.get_controllers().set_buttons(0, input);
+
+                    for (unsigned f = 0; f < this->config.frames_per_step; f++)
+                        nes.emulate_frame(false, false);
+
+                    uint64_t hash = nes.hash_state();
+                    if (seen.contains(hash)) {
+                        duplicates.fetch_add(1, memory_order_relaxed);
+                        continue;
+                    }
+
+                    /* Only the first copy of a state in this level is saved and scored */
+                    SearchNode child = { nullptr, hash, 0, i, input };
+                    if (level_seen.insert(hash)) {
+                        child.snap.reset(new NESSnapshot());
+                        child.score = this->score(nes);
+                        nes.save_state(*child.snap);
+                    }
+                    found[worker].push_back(move(child));
+                }
+            }
+        });
+
+        vector<SearchNode> reached;
+        for (vector<SearchNode>& nodes : found)
+            move(nodes.begin(), nodes.end(), back_inserter(reached));
+
+        /*
+         * A state reached several ways keeps the lowest parent and input, whichever thread saved
+         * it, and seen is filled in hash order, so even a full set drops the same states each run
+         */
+        sort(reached.begin(), reached.end(), by_origin);
+        vector<SearchNode> children;
+
+        for (size_t i = 0, end; i < reached.size(); i = end) {
+            size_t saved = i;
+            for (end = i; end < reached.size() && reached[end].hash == reached[i].hash; end++) {
+                if (reached[end].snap)
+                    saved = end;
+            }
+
+            duplicates += end - i - 1;
+            if (!seen.insert(reached[i].hash)) {
+                duplicates++;
+                continue;
+            }
+
+            SearchNode& child = reached[i];
+            if (saved != i) {
+                child.snap = move(reached[saved].snap);
+                child.score = reached[saved].score;
+            }
+            children.push_back(move(child));
+        }
+
+        result.explored += frontier.size() * this->config.inputs.size();
+        result.unique += children.size();
+
+        if (this->config.beam_width && children.size() > this->config.beam_width) {
+            partial_sort(children.begin(), children.begin() + this->config.beam_width, children.end(), better);
+            children.resize(this->config.beam_width);
+        } else {
+            sort(children.begin(), children.end(), better);
+        }
+
+        if (children.empty())
+            break;
+
+        links.emplace_back();
+        for (const SearchNode& child : children)
+            links.back().push_back({ child.parent, child.input });
+
+        if (children[0].score > result.score) {
+            result.score = children[0].score;
+            result.hash = children[0].hash;
+            best_level = level;
+        }
+
+        result.depth = level;
+        frontier = move(children);
+    }
+
+    result.duplicates = duplicates.load();
+    result.inputs.resize(best_level);
+
+    for (size_t level = best_level, i = 0; level > 0; level--) {
+        result.inputs[level - 1] = links[level][i].input;
+        i = links[level][i].parent;
+    }
+
+    result.elapsed_ns = Timeline::now() - began;
+    return result;
+}
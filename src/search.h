@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "input.h"
+#include "nes.h"
+
+using namespace std;
+
+const uint8_t DEFAULT_SEARCH_INPUTS[] = {
+    0, BUTTON_RIGHT, BUTTON_RIGHT | BUTTON_A, BUTTON_RIGHT | BUTTON_B, BUTTON_RIGHT | BUTTON_A | BUTTON_B,
+    BUTTON_LEFT, BUTTON_A, BUTTON_START
+};
+
+struct SearchConfig {
+    vector<uint8_t> inputs = vector<uint8_t>(begin(DEFAULT_SEARCH_INPUTS), end(DEFAULT_SEARCH_INPUTS));
+    unsigned    frames_per_step = 4;    // Each input is held this many frames
+    unsigned    depth = 8;              // Steps from the start state
+    size_t      beam_width = 256;       // New states kept per level, best first; 0 keeps them all
+    size_t      threads = 0;            // Workers besides the calling thread
+    size_t      max_states = 1 << 20;   // Capacity of the set of seen states
+};
+
+struct SearchResult {
+    vector<uint8_t> inputs;             // Path to the best state, one entry per step
+    double      score;
+    uint64_t    hash;
+    unsigned    depth;                  // Levels that produced at least one new state
+    uint64_t    explored;               // Children emulated and hashed
+    uint64_t    unique;
+    uint64_t    duplicates;
+    uint64_t    elapsed_ns;
+};
+
+/*
+ * Beam search over controller 1 input from a start state. Each level expands every frontier
+ * state with every input on a pool of threads, one NES each; children whose machine state
+ * hash was seen in an earlier level are dropped at once, the rest are scored and the best
+ * beam_width form the next frontier. A state reached several ways in one level keeps the
+ * lowest parent and input, and ties in score go to the lower hash, so results, the path
+ * included, do not depend on thread timing.
+ */
+class StateSearch
+{
+private:
+    NES&                        start;
+    SearchConfig                config;
+    function<double(NES&)>      score;
+
+public:
+    /* score must only read the NES; it runs on several threads at once */
+    StateSearch(NES& start, const SearchConfig& config, const function<double(NES&)>& score);
+
+    /* Leaves the start NES as it was */
+    SearchResult run();
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+const size_t CACHE_LINE_SIZE = 64;
+
+/*
+ * Bounded single-producer/single-consumer queue. push() is only called from one thread and
+ * pop() from one other thread; neither ever blocks or takes a lock.
+ */
+template<typename T, size_t N>
+class SpscRing
+{
+    static_assert(N != 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+private:
+    T               buffer[N];
+    char            pad0[CACHE_LINE_SIZE];
+    atomic<size_t>  head;   // Next slot to pop, owned by the consumer
+    char            pad1[CACHE_LINE_SIZE];
+    atomic<size_t>  tail;   // Next slot to push, owned by the producer
+    char            pad2[CACHE_LINE_SIZE];
+
+public:
+    SpscRing() :
+        head(0),
+        tail(0)
+    {
+    }
+
+    bool push(const T& val)
+    {
+        size_t t = this->tail.load(memory_order_relaxed);
+
+        if (t - this->head.load(memory_order_acquire) == N)
+            return false;
+
+        this->buffer[t & (N - 1)] = val;
+        this->tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    bool pop(T& val)
+    {
+        size_t h = this->head.load(memory_order_relaxed);
+
+        if (h == this->tail.load(memory_order_acquire))
+            return false;
+
+        val = this->buffer[h & (N - 1)];
+        this->head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    /* Bulk versions: as many as fit, or as many as there are, published at once */
+    size_t push(const T* vals, size_t count)
+    {
+        size_t t = this->tail.load(memory_order_relaxed);
+        size_t n = min(count, N - (t - this->head.load(memory_order_acquire)));
+
+        for (size_t i = 0; i < n; i++)
+            this->buffer[(t + i) & (N - 1)] = vals[i];
+
+        this->tail.store(t + n, memory_order_release);
+        return n;
+    }
+
+    size_t pop(T* vals, size_t count)
+    {
+        size_t h = this->head.load(memory_order_relaxed);
+        size_t n = min(count, this->tail.load(memory_order_acquire) - h);
+
+        for (size_t i = 0; i < n; i++)
+            vals[i] = this->buffer[(h + i) & (N - 1)];
+
+        this->head.store(h + n, memory_order_release);
+        return n;
+    }
+
+    /* Consumer side: looks at the oldest element without removing it */
+    bool peek(T& val)
+    {
+        size_t h = this->head.load(memory_order_relaxed);
+
+        if (h == this->tail.load(memory_order_acquire))
+            return false;
+
+        val = this->buffer[h & (N - 1)];
+        return true;
+    }
+
+    size_t size()
+    {
+        return this->tail.load(memory_order_acquire) - this->head.load(memory_order_acquire);
+    }
+
+    bool empty()
+    {
+        return this->size() == 0;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+};
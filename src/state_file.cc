@@ -0,0 +1,356 @@
+#include "state_file.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "state_hash.h"
+
+static_assert(is_trivially_copyable<NESSnapshot>::value, "snapshots are stored as their bytes");
+
+const uint8_t ZERO_RUN_FLAG = 0x80;
+const size_t MAX_LITERALS = 0x80;
+const size_t MAX_ZERO_RUN = 0x8000;
+/* Shorter runs of zeros cost no more as literals */
+const size_t MIN_ZERO_RUN = 3;
+
+static const size_t SECTION_OFFSETS[NUM_STATE_SECTIONS] = {
+    offsetof(NESSnapshot, cpu),
+    offsetof(NESSnapshot, ppu),
+    offsetof(NESSnapshot, apu),
+    offsetof(NESSnapshot, controllers)
+};
+
+static const size_t SECTION_SIZES[NUM_STATE_SECTIONS] = {
+    sizeof(CPUSnapshot),
+    sizeof(PPUSnapshot),
+    sizeof(APUSnapshot),
+    sizeof(ControllerSnapshot)
+};
+
+/* Adds message to errors if the caller collects them, otherwise prints it */
+static void report(string* errors, const string& message)
+{
+    if (errors)
+        *errors += (errors->empty() ? "" : " ") + message;
+    else
+        cerr << "ERROR: " << message << "\n";
+}
+
+static size_t align_up(size_t n)
+{
+    return (n + STATE_FILE_ALIGN - 1) & ~(STATE_FILE_ALIGN - 1);
+}
+
+static const size_t BODY_OFFSET = align_up(sizeof(StateFileHeader));
+
+size_t compress_bound(size_t size)
+{
+    return size + size / MAX_LITERALS + 2;
+}
+
+size_t compress_zero_runs(const uint8_t* in, size_t size, uint8_t* out, size_t capacity)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < size) {
+        size_t zeros = 0;
+        while (i + zeros < size && zeros < MAX_ZERO_RUN && in[i + zeros] == 0)
+            zeros++;
+
+        if (zeros >= MIN_ZERO_RUN) {
+            if (o + 2 > capacity)
+                return 0;
+
+            out[o++] = ZERO_RUN_FLAG | (zeros - 1) >> 8;
+            out[o++] = (zeros - 1) & 0xFF;
+            i += zeros;
+            continue;
+        }
+
+        /* Literals up to the next run worth coding; there is none at i, so at least one */
+        size_t start = i;
+        while (i < size && i - start < MAX_LITERALS) {
+            if (i + MIN_ZERO_RUN <= size && in[i] == 0 && in[i + 1] == 0 && in[i + 2] == 0)
+                break;
+            i++;
+        }
+
+        size_t n = i - start;
+        if (o + 1 + n > capacity)
+            return 0;
+
+        out[o++] = n - 1;
+        memcpy(&out[o], &in[start], n);
+        o += n;
+    }
+
+    return o;
+}
+
+bool decompress_zero_runs(const uint8_t* in, size_t stored_size, uint8_t* out, size_t size)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < stored_size) {
+        uint8_t control = in[i++];
+
+        if (control < ZERO_RUN_FLAG) {
+            size_t n = control + 1;
+            if (n > stored_size - i || n > size - o)
+                return false;
+
+            memcpy(&out[o], &in[i], n);
+            i += n;
+            o += n;
+        } else {
+            if (i == stored_size)
+                return false;
+
+            size_t n = ((control & ~ZERO_RUN_FLAG) << 8 | in[i++]) + 1;
+            if (n > size - o)
+                return false;
+
+            memset(&out[o], 0, n);
+            o += n;
+        }
+    }
+
+    return o == size;
+}
+
+bool write_state_file(const string& path, const NESSnapshot& snap, unsigned compress, string* errors)
+{
+    const uint8_t* body = (const uint8_t*) &snap;
+    vector<uint8_t> file(BODY_OFFSET);
+    StateFileHeader header = {};
+
+    memcpy(header.magic, STATE_FILE_MAGIC, sizeof(STATE_FILE_MAGIC));
+    header.version = STATE_FILE_VERSION;
+    header.header_size = sizeof(StateFileHeader);
+    header.snapshot_size = sizeof(NESSnapshot);
+
+    for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+        StateSection& section = header.sections[i];
+        section.size = SECTION_SIZES[i];
+        section.hash = hash_bytes(body + SECTION_OFFSETS[i], SECTION_SIZES[i], 0);
+    }
+
+    if (!compress) {
+        /* The body is the snapshot as it is in memory, padding and all */
+        for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+            header.sections[i].offset = BODY_OFFSET + SECTION_OFFSETS[i];
+            header.sections[i].stored_size = SECTION_SIZES[i];
+        }
+        file.insert(file.end(), body, body + sizeof(NESSnapshot));
+    } else {
+        for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+            StateSection& section = header.sections[i];
+            const uint8_t* data = body + SECTION_OFFSETS[i];
+            size_t offset = align_up(file.size());
+
+            file.resize(offset + compress_bound(section.size));
+            section.offset = offset;
+            section.stored_size = 0;
+
+            if (compress & (1 << i))
+                section.stored_size = compress_zero_runs(data, section.size, &file[offset], file.size() - offset);
+
+            /* Sections that would not get smaller are kept as they are */
+            if (section.stored_size && section.stored_size < section.size) {
+                section.flags = SECTION_COMPRESSED;
+            } else {
+                section.stored_size = section.size;
+                memcpy(&file[offset], data, section.size);
+            }
+
+            file.resize(offset + section.stored_size);
+        }
+    }
+
+    header.file_size = file.size();
+    memcpy(file.data(), &header, sizeof(header));
+
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write((const char*) file.data(), file.size());
+
+    if (!out) {
+        report(errors, "Could not write state file " + path + ": " + strerror(errno) + ".");
+        return false;
+    }
+
+    return true;
+}
+
+StateFile::StateFile(const string& path, string* errors) :
+    errors(errors)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        report(this->errors, "Could not open state file " + path + ": " + strerror(errno) + ".");
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    if ((size_t) st.st_size < sizeof(StateFileHeader)) {
+        report(this->errors, path + " is too short to be a state file.");
+        close(fd);
+        return;
+    }
+
+    void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED) {
+        report(this->errors, "Could not map state file " + path + ": " + strerror(errno) + ".");
+        return;
+    }
+
+    this->map = (const uint8_t*) mem;
+    this->map_size = st.st_size;
+    this->header = (const StateFileHeader*) mem;
+
+    if (!this->check_header(path)) {
+        munmap((void*) this->map, this->map_size);
+        this->map = nullptr;
+        this->header = nullptr;
+    }
+}
+
+StateFile::~StateFile()
+{
+    if (this->map)
+        munmap((void*) this->map, this->map_size);
+}
+
+bool StateFile::check_header(const string& path)
+{
+    const StateFileHeader& h = *this->header;
+
+    if (memcmp(h.magic, STATE_FILE_MAGIC, sizeof(STATE_FILE_MAGIC)) != 0) {
+        report(this->errors, path + " is not a state file.");
+        return false;
+    }
+
+    if (h.version != STATE_FILE_VERSION || h.header_size != sizeof(StateFileHeader) ||
+        h.snapshot_size != sizeof(NESSnapshot))
+    {
+        report(this->errors, path + " is a version " + to_string(h.version) + " state file of a different layout.");
+        return false;
+    }
+
+    if (h.file_size != this->map_size) {
+        report(this->errors, path + " is " + to_string(this->map_size) + " bytes, its header says " + to_string(h.file_size) + ".");
+        return false;
+    }
+
+    for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+        const StateSection& s = h.sections[i];
+        bool compressed = s.flags & SECTION_COMPRESSED;
+
+        if (s.size != SECTION_SIZES[i] || (s.flags & ~SECTION_COMPRESSED) || (!compressed && s.stored_size != s.size) ||
+            s.offset % alignof(NESSnapshot) || s.offset < sizeof(StateFileHeader) || s.offset > this->map_size ||
+            s.stored_size > this->map_size - s.offset)
+        {
+            report(this->errors, path + " has a bad " + STATE_SECTION_NAMES[i] + " section.");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool StateFile::is_open()
+{
+    return this->header != nullptr;
+}
+
+const StateFileHeader& StateFile::get_header()
+{
+    return *this->header;
+}
+
+const NESSnapshot* StateFile::get_snapshot()
+{
+    if (!this->header || this->map_size < BODY_OFFSET + sizeof(NESSnapshot))
+        return nullptr;
+
+    for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+        const StateSection& s = this->header->sections[i];
+
+        if ((s.flags & SECTION_COMPRESSED) || s.offset != BODY_OFFSET + SECTION_OFFSETS[i])
+            return nullptr;
+    }
+
+    return (const NESSnapshot*) (this->map + BODY_OFFSET);
+}
+
+bool StateFile::read(NESSnapshot& out)
+{
+    if (!this->header)
+        return false;
+
+    const NESSnapshot* in_place = this->get_snapshot();
+    if (in_place) {
+        memcpy(&out, in_place, sizeof(NESSnapshot));
+        return true;
+    }
+
+    uint8_t* body = (uint8_t*) &out;
+
+    for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+        const StateSection& s = this->header->sections[i];
+        const uint8_t* stored = this->map + s.offset;
+        uint8_t* dest = body + SECTION_OFFSETS[i];
+
+        if (!(s.flags & SECTION_COMPRESSED))
+            memcpy(dest, stored, s.size);
+        else if (!decompress_zero_runs(stored, s.stored_size, dest, s.size))
+            return false;
+    }
+
+    return true;
+}
+
+bool StateFile::validate()
+{
+    if (!this->header)
+        return false;
+
+    vector<uint8_t> decoded;
+
+    for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+        const StateSection& s = this->header->sections[i];
+        const uint8_t* data = this->map + s.offset;
+
+        if (s.flags & SECTION_COMPRESSED) {
+            decoded.resize(s.size);
+            if (!decompress_zero_runs(data, s.stored_size, decoded.data(), s.size)) {
+                report(this->errors, string("The ") + STATE_SECTION_NAMES[i] + " section does not decode.");
+                return false;
+            }
+            data = decoded.data();
+        }
+
+        if (hash_bytes(data, s.size, 0) != s.hash) {
+            report(this->errors, string("The ") + STATE_SECTION_NAMES[i] + " section does not match its hash.");
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "nes.h"
+
+using namespace std;
+
+const char STATE_FILE_MAGIC[8] = { 'N', 'E', 'S', 'S', 'N', 'A', 'P', '\x1A' };
+const uint32_t STATE_FILE_VERSION = 1;
+/* The body and every compressed section start on this boundary, so mappings can be used in place */
+const size_t STATE_FILE_ALIGN = 64;
+
+enum StateSectionKind {
+    SECTION_CPU,
+    SECTION_PPU,
+    SECTION_APU,
+    SECTION_CONTROLLERS,
+    NUM_STATE_SECTIONS
+};
+
+const char* const STATE_SECTION_NAMES[] = { "cpu", "ppu", "apu", "controllers" };
+
+enum StateSectionFlags : uint32_t {
+    SECTION_COMPRESSED  = 1 << 0    // Zero-run coded; see compress_zero_runs()
+};
+
+struct StateSection {
+    uint64_t    offset;         // From the start of the file
+    uint64_t    size;           // In memory: the size of the snapshot member
+    uint64_t    stored_size;    // In the file: size, unless compressed
+    uint64_t    hash;           // hash_bytes() of the size bytes in memory
+    uint32_t    flags;
+    uint32_t    reserved;
+};
+
+/*
+ * The whole layout is fixed and native-endian, so nothing is parsed on load. With no section
+ * compressed the sections sit exactly where NESSnapshot keeps its members, from the first
+ * aligned offset after the header on, and the body of the file is an NESSnapshot.
+ */
+struct StateFileHeader {
+    char            magic[8];
+    uint32_t        version;
+    uint32_t        header_size;
+    uint64_t        file_size;
+    uint64_t        snapshot_size;
+    StateSection    sections[NUM_STATE_SECTIONS];
+};
+
+/* Bit i compresses section i */
+const unsigned COMPRESS_NONE = 0;
+const unsigned COMPRESS_ALL = (1 << NUM_STATE_SECTIONS) - 1;
+
+/*
+ * Byte codec for snapshots, which are mostly zeros: a control byte below 0x80 is followed by
+ * that many plus one literal bytes; one at or above 0x80 and the byte after it give a run of
+ * zeros, ((control & 0x7F) << 8 | next) + 1 long. Returns the bytes written, or 0 if out is
+ * too small; compress_bound() is always enough.
+ */
+size_t      compress_bound(size_t size);
+size_t      compress_zero_runs(const uint8_t* in, size_t size, uint8_t* out, size_t capacity);
+/* False if in does not decode to exactly size bytes */
+bool        decompress_zero_runs(const uint8_t* in, size_t stored_size, uint8_t* out, size_t size);
+
+/* errors, if given, collects what went wrong instead of it being printed */
+bool        write_state_file(const string& path, const NESSnapshot& snap, unsigned compress = COMPRESS_NONE,
+                             string* errors = nullptr);
+
+/*
+ * A state file mapped read-only. Opening checks the header and that every section lies inside
+ * the file; section contents are only checked by validate(), so loading costs no more than the
+ * copy itself.
+ */
+class StateFile
+{
+private:
+    const uint8_t*          map = nullptr;
+    size_t                  map_size = 0;
+    const StateFileHeader*  header = nullptr;
+    string*                 errors;
+
+    bool        check_header(const string& path);
+
+public:
+    /* errors, if given, collects what went wrong here and in validate() instead of it being printed */
+    StateFile(const string& path, string* errors = nullptr);
+    ~StateFile();
+
+    StateFile(const StateFile&) = delete;
+    StateFile& operator=(const StateFile&) = delete;
+
+    bool        is_open();
+    const StateFileHeader& get_header();
+
+    /* The snapshot in the mapping itself, or nullptr if any section is compressed */
+    const NESSnapshot* get_snapshot();
+    /* One bulk copy when uncompressed, otherwise a copy or decode per section */
+    bool        read(NESSnapshot& out);
+    /* Decodes every section and checks it against its hash */
+    bool        validate();
+};
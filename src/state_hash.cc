@@ -0,0 +1,64 @@
+#include "state_hash.h"
+
+StateSet::StateSet(size_t capacity) :
+    count(0)
+{
+    size_t size = 16;
+    while (size < capacity * 2)
+        size <<= 1;
+
+    this->slots.reset(new atomic<uint64_t>[size]);
+    this->mask = size - 1;
+    this->clear();
+}
+
+bool StateSet::insert(uint64_t hash)
+{
+    hash = hash ? hash : 1;
+
+    for (size_t i = hash & this->mask, probes = 0; probes <= this->mask; i = (i + 1) & this->mask, probes++) {
+        uint64_t cur = this->slots[i].load(memory_order_relaxed);
+
+        if (cur == 0) {
+            if (this->slots[i].compare_exchange_strong(cur, hash, memory_order_relaxed)) {
+                this->count.fetch_add(1, memory_order_relaxed);
+                return true;
+            }
+        }
+
+        /* Either taken before we looked or just now, possibly by the same hash */
+        if (cur == hash)
+            return false;
+    }
+
+    return false;
+}
+
+bool StateSet::contains(uint64_t hash)
+{
+    hash = hash ? hash : 1;
+
+    for (size_t i = hash & this->mask, probes = 0; probes <= this->mask; i = (i + 1) & this->mask, probes++) {
+        uint64_t cur = this->slots[i].load(memory_order_relaxed);
+
+        if (cur == hash)
+            return true;
+        if (cur == 0)
+            return false;
+    }
+
+    return false;
+}
+
+size_t StateSet::size()
+{
+    return this->count.load(memory_order_relaxed);
+}
+
+void StateSet::clear()
+{
+    for (size_t i = 0; i <= this->mask; i++)
+        this->slots[i].store(0, memory_order_relaxed);
+
+    this->count.store(0, memory_order_relaxed);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+const uint64_t HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t HASH_PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t HASH_PRIME4 = 0x85EBCA77C2B2AE63ULL;
+
+static inline uint64_t hash_rotl(uint64_t x, unsigned r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t word)
+{
+    return hash_rotl(acc + word * HASH_PRIME2, 31) * HASH_PRIME1;
+}
+
+static inline uint64_t hash_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= HASH_PRIME2;
+    h ^= h >> 29;
+    h *= HASH_PRIME3;
+    return h ^ (h >> 32);
+}
+
+/*
+ * 64-bit hash of machine state, chained through seed. The bulk runs four independent lanes of
+ * 8 bytes each, so the multiplies overlap; state is a few kilobytes, so this is what counts.
+ */
+static inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    uint64_t h = seed + HASH_PRIME4 + size;
+
+    if (size >= 32) {
+        uint64_t lanes[4] = { seed + HASH_PRIME1 + HASH_PRIME2, seed + HASH_PRIME2, seed, seed - HASH_PRIME1 };
+
+        for (; size >= 32; p += 32, size -= 32) {
+            uint64_t words[4];
+            memcpy(words, p, sizeof(words));
+
+            for (size_t i = 0; i < 4; i++)
+                lanes[i] = hash_round(lanes[i], words[i]);
+        }
+
+        h += hash_rotl(lanes[0], 1) + hash_rotl(lanes[1], 7) + hash_rotl(lanes[2], 12) + hash_rotl(lanes[3], 18);
+    }
+
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        h = hash_rotl(h ^ hash_round(0, word), 27) * HASH_PRIME1 + HASH_PRIME4;
+    }
+
+    for (; size; p++, size--)
+        h = hash_rotl(h ^ (*p * HASH_PRIME4), 11) * HASH_PRIME1;
+
+    return hash_mix(h);
+}
+
+static inline uint64_t hash_word(uint64_t word, uint64_t seed)
+{
+    return hash_mix(hash_round(seed + HASH_PRIME4, word));
+}
+
+/*
+ * Lock-free set of state hashes for deduplicating across threads: open addressing with linear
+ * probing over a fixed table of atomic slots, claimed with one compare-and-swap. 0 marks a free
+ * slot, so a hash of 0 is stored as 1.
+ */
+class StateSet
+{
+private:
+    unique_ptr<atomic<uint64_t>[]>  slots;
+    size_t                          mask;
+    atomic<size_t>                  count;
+
+public:
+    /* Room for at least capacity hashes, kept at most half full */
+    StateSet(size_t capacity);
+
+    StateSet(const StateSet&) = delete;
+    StateSet& operator=(const StateSet&) = delete;
+
+    /* True if hash was not in the set. A full set reports everything as already seen */
+    bool        insert(uint64_t hash);
+    bool        contains(uint64_t hash);
+    size_t      size();
+    /* Not safe against concurrent inserts */
+    void        clear();
+};
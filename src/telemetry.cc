@@ -0,0 +1,193 @@
+#include "telemetry.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nes.h"
+
+Telemetry::Telemetry(const string& name, unsigned ram_interval) :
+    path(TELEMETRY_PREFIX + name),
+    ram_interval(ram_interval)
+{
+    int fd = shm_open(this->path.c_str(), O_CREAT | O_RDWR, 0644);
+
+    if (fd < 0 || ftruncate(fd, sizeof(TelemetryBlock)) < 0) {
+        cerr << "ERROR: Could not create telemetry segment " << this->path << ": " << strerror(errno) << ".\n";
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    void* mem = mmap(nullptr, sizeof(TelemetryBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED) {
+        cerr << "ERROR: Could not map telemetry segment " << this->path << ": " << strerror(errno) << ".\n";
+        shm_unlink(this->path.c_str());
+        return;
+    }
+
+    this->block = new (mem) TelemetryBlock();
+    memset(&this->block->data, 0, sizeof(this->block->data));
+    this->block->data.pid = getpid();
+    this->block->data.frame_ns_min = UINT64_MAX;
+    this->block->version = TELEMETRY_VERSION;
+    this->block->size = sizeof(TelemetryBlock);
+    this->block->seq.store(0, memory_order_relaxed);
+
+    /* Readers check the magic last */
+    atomic_thread_fence(memory_order_release);
+    memcpy(this->block->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+}
+
+Telemetry::~Telemetry()
+{
+    if (!this->block)
+        return;
+
+    this->set_status(SESSION_STOPPED);
+    munmap(this->block, sizeof(TelemetryBlock));
+    shm_unlink(this->path.c_str());
+}
+
+bool Telemetry::is_open()
+{
+    return this->block != nullptr;
+}
+
+inline void Telemetry::begin_write()
+{
+    this->block->seq.store(this->block->seq.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+inline void Telemetry::end_write()
+{
+    this->block->seq.store(this->block->seq.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void Telemetry::set_status(SessionStatus status)
+{
+    if (!this->block)
+        return;
+
+    this->begin_write();
+    this->block->data.status = status;
+    this->end_write();
+}
+
+void Telemetry::publish(NES& nes, uint64_t frame_ns)
+{
+    if (!this->block)
+        return;
+
+    TelemetryData& d = this->block->data;
+    const NESStats& stats = nes.get_stats();
+    uint64_t cycles = nes.get_cpu().get_cycles();
+    uint64_t us = frame_ns / 1000;
+    size_t bucket = us ? 63 - __builtin_clzll(us) : 0;
+
+    this->begin_write();
+
+    d.status = SESSION_RUNNING;
+    d.run_ahead_frames = nes.get_run_ahead_frames();
+    d.updated_ns = Timeline::now();
+    d.frames++;
+    d.cycles = cycles;
+    /* Nothing to measure on the first publish, nor across a rewind by load_state() */
+    d.emulated_mhz = frame_ns && cycles >= this->last_cycles ? (cycles - this->last_cycles) * 1000.0 / frame_ns : 0.0;
+    d.frame_ns_last = frame_ns;
+    d.frame_ns_min = min(d.frame_ns_min, frame_ns);
+    d.frame_ns_max = max(d.frame_ns_max, frame_ns);
+    d.frame_ns_total += frame_ns;
+    d.frame_time_hist[min(bucket, FRAME_TIME_BUCKETS - 1)]++;
+    d.run_slices = stats.run_slices;
+    d.apu_syncs = stats.apu_syncs;
+    d.oam_dmas = stats.oam_dmas;
+    d.states_saved = stats.states_saved;
+    d.states_loaded = stats.states_loaded;
+    d.save_ns = stats.save_ns;
+    d.load_ns = stats.load_ns;
+
+    if (this->ram_interval && d.frames % this->ram_interval == 0) {
+        memcpy(d.ram, nes.get_cpu().get_ram(), RAM_SIZE);
+        d.ram_frame = d.frames;
+    }
+
+    this->end_write();
+    this->last_cycles = cycles;
+}
+
+TelemetryReader::TelemetryReader(const string& name)
+{
+    string path = TELEMETRY_PREFIX + name;
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+
+    if (fd < 0) {
+        cerr << "ERROR: Could not open telemetry segment " << path << ": " << strerror(errno) << ".\n";
+        return;
+    }
+
+    struct stat st;
+    void* mem = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(TelemetryBlock))
+        mem = mmap(nullptr, sizeof(TelemetryBlock), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED) {
+        cerr << "ERROR: Could not map telemetry segment " << path << ".\n";
+        return;
+    }
+
+    this->block = (const TelemetryBlock*) mem;
+    atomic_thread_fence(memory_order_acquire);
+
+    if (memcmp(this->block->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC)) != 0 ||
+        this->block->version != TELEMETRY_VERSION || this->block->size != sizeof(TelemetryBlock))
+    {
+        cerr << "ERROR: " << path << " is not a version " << TELEMETRY_VERSION << " telemetry segment.\n";
+        munmap((void*) this->block, sizeof(TelemetryBlock));
+        this->block = nullptr;
+    }
+}
+
+TelemetryReader::~TelemetryReader()
+{
+    if (this->block)
+        munmap((void*) this->block, sizeof(TelemetryBlock));
+}
+
+bool TelemetryReader::is_open()
+{
+    return this->block != nullptr;
+}
+
+bool TelemetryReader::read(TelemetryData& out)
+{
+    if (!this->block)
+        return false;
+
+    for (;;) {
+        uint32_t before = this->block->seq.load(memory_order_acquire);
+
+        if (before & 1) {
+            this_thread::yield();
+            continue;
+        }
+
+        memcpy(&out, &this->block->data, sizeof(out));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (this->block->seq.load(memory_order_relaxed) == before)
+            return true;
+    }
+}
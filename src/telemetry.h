@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "cpu.h"
+
+using namespace std;
+
+const char TELEMETRY_MAGIC[8] = { 'N', 'E', 'S', 'T', 'E', 'L', 'E', 'M' };
+const uint32_t TELEMETRY_VERSION = 1;
+const char* const TELEMETRY_PREFIX = "/nes-telemetry-";
+/* Bucket i counts frames that took [2^i, 2^(i+1)) microseconds; the last bucket takes the rest */
+const size_t FRAME_TIME_BUCKETS = 24;
+
+class NES;
+
+enum SessionStatus : uint32_t {
+    SESSION_IDLE,
+    SESSION_RUNNING,
+    SESSION_PAUSED,
+    SESSION_STOPPED
+};
+
+const char* const SESSION_STATUS_NAMES[] = { "idle", "running", "paused", "stopped" };
+
+/* Everything a reader sees; only plain data, since it lives in shared memory */
+struct TelemetryData {
+    uint64_t    pid;
+    uint32_t    status;
+    uint32_t    run_ahead_frames;
+    uint64_t    updated_ns;         // Host steady clock at the last publish
+    uint64_t    frames;             // Frames published, i.e. run_frame() calls
+    uint64_t    cycles;             // CPU cycles of the emulated timeline
+    double      emulated_mhz;       // Over the last frame
+    uint64_t    frame_ns_last;
+    uint64_t    frame_ns_min;
+    uint64_t    frame_ns_max;
+    uint64_t    frame_ns_total;
+    uint64_t    frame_time_hist[FRAME_TIME_BUCKETS];
+    uint64_t    run_slices;
+    uint64_t    apu_syncs;
+    uint64_t    oam_dmas;
+    uint64_t    states_saved;
+    uint64_t    states_loaded;
+    uint64_t    save_ns;
+    uint64_t    load_ns;
+    uint64_t    ram_frame;          // Frame ram was copied on; 0 if it never was
+    uint8_t     ram[RAM_SIZE];
+};
+
+/*
+ * The shared segment. The writer makes seq odd, updates data in place and makes it even again;
+ * readers copy data and retry unless seq was the same even number before and after.
+ */
+struct TelemetryBlock {
+    char                magic[8];
+    uint32_t            version;
+    uint32_t            size;
+    atomic<uint32_t>    seq;
+    TelemetryData       data;
+};
+
+/*
+ * Publishes one process's emulator state to a POSIX shared-memory segment named
+ * TELEMETRY_PREFIX + name, for readers in other processes. The writer never waits on readers.
+ * The segment is removed when the Telemetry is destroyed.
+ */
+class Telemetry
+{
+private:
+    string          path;
+    TelemetryBlock* block = nullptr;
+    unsigned        ram_interval;
+    uint64_t        last_cycles = UINT64_MAX;   // Above any count until the first publish
+
+    inline void     begin_write();
+    inline void     end_write();
+
+public:
+    /* ram_interval: copy the 2 KB of RAM every that many frames, 0 for never */
+    Telemetry(const string& name, unsigned ram_interval = 0);
+    ~Telemetry();
+
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    bool            is_open();
+    void            set_status(SessionStatus status);
+    /* Called by NES::run_frame() with the host time the frame took */
+    void            publish(NES& nes, uint64_t frame_ns);
+};
+
+/* Reading side of a Telemetry segment */
+class TelemetryReader
+{
+private:
+    const TelemetryBlock*   block = nullptr;
+
+public:
+    TelemetryReader(const string& name);
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    bool            is_open();
+    /* A consistent copy of the newest data; false if the segment is not open */
+    bool            read(TelemetryData& out);
+};
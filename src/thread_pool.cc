@@ -0,0 +1,88 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t num_threads) :
+    next_item(0)
+{
+    for (size_t i = 0; i < num_threads; i++)
+        this->workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stopping = true;
+    }
+
+    this->wake.notify_all();
+
+    for (thread& worker : this->workers)
+        worker.join();
+}
+
+size_t ThreadPool::size()
+{
+    return this->workers.size();
+}
+
+void ThreadPool::run_items()
+{
+    size_t i;
+
+    while ((i = this->next_item.fetch_add(1, memory_order_relaxed)) < this->job_count)
+        (*this->job)(i);
+}
+
+void ThreadPool::worker_loop()
+{
+    uint64_t seen = 0;
+
+    for (;;) {
+        {
+            unique_lock<mutex> guard(this->lock);
+            this->wake.wait(guard, [&] { return this->stopping || this->generation != seen; });
+
+            if (this->stopping)
+                return;
+
+            seen = this->generation;
+        }
+
+        this->run_items();
+
+        {
+            lock_guard<mutex> guard(this->lock);
+
+            if (--this->busy == 0)
+                this->done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const function<void(size_t)>& fn)
+{
+    if (count == 0)
+        return;
+
+    if (this->workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->job = &fn;
+        this->job_count = count;
+        this->next_item.store(0, memory_order_relaxed);
+        this->busy = this->workers.size();
+        this->generation++;
+    }
+
+    this->wake.notify_all();
+    this->run_items();
+
+    unique_lock<mutex> guard(this->lock);
+    this->done.wait(guard, [&] { return this->busy == 0; });
+    this->job = nullptr;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Fixed set of worker threads for splitting one job (e.g. the rows of a frame) across cores.
+ * The calling thread takes part in the work, so a pool of size 0 simply runs the job inline.
+ */
+class ThreadPool
+{
+private:
+    vector<thread>                  workers;
+    mutex                           lock;
+    condition_variable              wake;
+    condition_variable              done;
+    const function<void(size_t)>*   job = nullptr;
+    size_t                          job_count = 0;
+    atomic<size_t>                  next_item;
+    size_t                          busy = 0;
+    uint64_t                        generation = 0;
+    bool                            stopping = false;
+
+    void        worker_loop();
+    void        run_items();
+
+public:
+    ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t      size();
+
+    /* Calls fn(i) for every i in [0, count) and returns once all calls have finished */
+    void        parallel_for(size_t count, const function<void(size_t)>& fn);
+};
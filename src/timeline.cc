@@ -0,0 +1,189 @@
+#include "timeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "apu.h"
+
+static atomic<uint64_t> next_timeline_id(1);
+
+TimelineBuffer::TimelineBuffer(thread::id owner, size_t tid, size_t capacity) :
+    owner(owner),
+    tid(tid),
+    name("thread " + to_string(tid)),
+    events(capacity),
+    size(0),
+    dropped(0)
+{
+}
+
+Timeline::Timeline(size_t capacity) :
+    id(next_timeline_id.fetch_add(1)),
+    capacity(capacity),
+    origin(Timeline::now())
+{
+}
+
+uint64_t Timeline::now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TimelineBuffer* Timeline::find_buffer()
+{
+    lock_guard<mutex> guard(this->lock);
+    thread::id self = this_thread::get_id();
+
+    for (auto& buffer : this->buffers) {
+        if (buffer->owner == self)
+            return buffer.get();
+    }
+
+    this->buffers.emplace_back(new TimelineBuffer(self, this->buffers.size() + 1, this->capacity));
+    return this->buffers.back().get();
+}
+
+TimelineBuffer* Timeline::local_buffer()
+{
+    /* Ids are never reused, so a cached buffer cannot belong to a timeline freed since */
+    static thread_local uint64_t cached_id = 0;
+    static thread_local TimelineBuffer* cached = nullptr;
+
+    if (cached_id != this->id) {
+        cached = this->find_buffer();
+        cached_id = this->id;
+    }
+
+    return cached;
+}
+
+void Timeline::record(const TimelineEvent& event)
+{
+    TimelineBuffer* buffer = this->local_buffer();
+    size_t size = buffer->size.load(memory_order_relaxed);
+
+    if (size == buffer->events.size()) {
+        buffer->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    buffer->events[size] = event;
+    buffer->size.store(size + 1, memory_order_release);
+}
+
+void Timeline::span(const char* name, const char* category, uint64_t host_start,
+                    uint64_t cycle_start, uint64_t cycle_end, uint64_t arg)
+{
+    this->record({ name, category, PHASE_SPAN, host_start, Timeline::now(), cycle_start, cycle_end, arg });
+}
+
+void Timeline::instant(const char* name, const char* category, uint64_t cycle, uint64_t arg)
+{
+    uint64_t t = Timeline::now();
+    this->record({ name, category, PHASE_INSTANT, t, t, cycle, cycle, arg });
+}
+
+void Timeline::name_thread(const string& name)
+{
+    TimelineBuffer* buffer = this->local_buffer();
+    lock_guard<mutex> guard(this->lock);
+    buffer->name = name;
+}
+
+size_t Timeline::get_event_count()
+{
+    lock_guard<mutex> guard(this->lock);
+    size_t total = 0;
+
+    for (auto& buffer : this->buffers)
+        total += buffer->size.load(memory_order_acquire);
+
+    return total;
+}
+
+uint64_t Timeline::get_dropped()
+{
+    lock_guard<mutex> guard(this->lock);
+    uint64_t total = 0;
+
+    for (auto& buffer : this->buffers)
+        total += buffer->dropped.load(memory_order_relaxed);
+
+    return total;
+}
+
+enum TimelineClock {
+    CLOCK_HOST = 1,     // Chrome trace pid of each view
+    CLOCK_EMULATED = 2
+};
+
+static void write_metadata(ostream& out, const char* kind, unsigned pid, size_t tid, const string& name)
+{
+    out << ",\n{\"name\":\"" << kind << "\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+        << ",\"args\":{\"name\":\"" << name << "\"}}";
+}
+
+static void write_event(ostream& out, const TimelineEvent& e, unsigned pid, size_t tid, double ts, double dur)
+{
+    out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"" << (char) e.phase
+        << "\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"ts\":" << ts;
+
+    if (e.phase == PHASE_SPAN)
+        out << ",\"dur\":" << dur;
+    else
+        out << ",\"s\":\"t\"";
+
+    out << ",\"args\":{\"arg\":" << e.arg;
+    if (e.cycle_start != NO_CYCLE)
+        out << ",\"cycle\":" << e.cycle_start;
+    out << "}}";
+}
+
+void Timeline::write_json(ostream& out)
+{
+    lock_guard<mutex> guard(this->lock);
+    const double us_per_cycle = 1e6 / CPU_CLOCK_RATE;
+
+    out << fixed;
+    out.precision(3);
+    /* Every entry after the first starts with its separator */
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << CLOCK_HOST << ",\"args\":{\"name\":\"host time\"}}";
+    write_metadata(out, "process_name", CLOCK_EMULATED, 0, "emulated time");
+
+    for (auto& buffer : this->buffers) {
+        size_t size = buffer->size.load(memory_order_acquire);
+
+        write_metadata(out, "thread_name", CLOCK_HOST, buffer->tid, buffer->name);
+        write_metadata(out, "thread_name", CLOCK_EMULATED, buffer->tid, buffer->name);
+
+        for (size_t i = 0; i < size; i++) {
+            const TimelineEvent& e = buffer->events[i];
+            uint64_t host_start = max(e.host_start, this->origin) - this->origin;
+
+            write_event(out, e, CLOCK_HOST, buffer->tid, host_start / 1000.0, (e.host_end - e.host_start) / 1000.0);
+
+            if (e.cycle_start != NO_CYCLE) {
+                write_event(out, e, CLOCK_EMULATED, buffer->tid, e.cycle_start * us_per_cycle,
+                            (e.cycle_end - e.cycle_start) * us_per_cycle);
+            }
+        }
+    }
+
+    out << "\n]}\n";
+}
+
+bool Timeline::write_json(const string& path)
+{
+    ofstream out(path);
+
+    if (!out) {
+        cerr << "ERROR: Could not open " << path << " for writing.\n";
+        return false;
+    }
+
+    this->write_json(out);
+    return true;
+}
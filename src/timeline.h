@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const size_t DEFAULT_TIMELINE_CAPACITY = 1 << 16;
+const uint64_t NO_CYCLE = UINT64_MAX;
+
+enum TimelinePhase : char {
+    PHASE_SPAN      = 'X',
+    PHASE_INSTANT   = 'i'
+};
+
+/* Names and categories must be string literals: only the pointers are kept */
+struct TimelineEvent {
+    const char*     name;
+    const char*     category;
+    TimelinePhase   phase;
+    uint64_t        host_start;     // Nanoseconds on the steady clock
+    uint64_t        host_end;
+    uint64_t        cycle_start;    // CPU cycles, or NO_CYCLE for host-only events
+    uint64_t        cycle_end;
+    uint64_t        arg;
+};
+
+/* One thread's events; only that thread appends, anyone may read the published prefix */
+struct TimelineBuffer {
+    thread::id              owner;
+    size_t                  tid;
+    string                  name;
+    vector<TimelineEvent>   events;
+    atomic<size_t>          size;
+    atomic<uint64_t>        dropped;
+
+    TimelineBuffer(thread::id owner, size_t tid, size_t capacity);
+};
+
+/*
+ * Timestamped spans and instants from every thread that touches the emulator, exported as
+ * Chrome trace-event JSON. Each thread appends to its own fixed-size buffer without locking;
+ * a full buffer drops and counts. Events carry both host time and emulated CPU cycles, and
+ * the export shows them twice: once on the host clock and once on the emulated clock.
+ */
+class Timeline
+{
+private:
+    uint64_t                            id;
+    size_t                              capacity;
+    uint64_t                            origin;
+    mutex                               lock;
+    vector<unique_ptr<TimelineBuffer>>  buffers;
+
+    TimelineBuffer*     local_buffer();
+    TimelineBuffer*     find_buffer();
+
+public:
+    Timeline(size_t capacity = DEFAULT_TIMELINE_CAPACITY);
+
+    Timeline(const Timeline&) = delete;
+    Timeline& operator=(const Timeline&) = delete;
+
+    static uint64_t     now();
+
+    void                record(const TimelineEvent& event);
+    void                span(const char* name, const char* category, uint64_t host_start,
+                             uint64_t cycle_start, uint64_t cycle_end, uint64_t arg = 0);
+    void                instant(const char* name, const char* category, uint64_t cycle, uint64_t arg = 0);
+    /* Labels the calling thread's track */
+    void                name_thread(const string& name);
+
+    size_t              get_event_count();
+    uint64_t            get_dropped();
+
+    /* Safe while threads are still recording; their newest events may be left out */
+    void                write_json(ostream& out);
+    bool                write_json(const string& path);
+};
+
+/* A span timed from construction to end(); does nothing without a timeline */
+class TimelineSpan
+{
+private:
+    Timeline*       timeline;
+    const char*     name;
+    const char*     category;
+    uint64_t        host_start;
+    uint64_t        cycle_start;
+
+public:
+    TimelineSpan(Timeline* timeline, const char* name, const char* category, uint64_t cycle_start) :
+        timeline(timeline),
+        name(name),
+        category(category),
+        host_start(timeline ? Timeline::now() : 0),
+        cycle_start(cycle_start)
+    {
+    }
+
+    void end(uint64_t cycle_end, uint64_t arg = 0)
+    {
+        if (this->timeline)
+            this->timeline->span(this->name, this->category, this->host_start, this->cycle_start, cycle_end, arg);
+    }
+};
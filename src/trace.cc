@@ -0,0 +1,210 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "cpu.h"
+#include "ppu_core.h"
+
+const unsigned TRACE_IDLE_US = 500;
+
+Tracer::Tracer(const string& path, TraceFormat format, bool lossless) :
+    format(format),
+    lossless(lossless),
+    stopping(false),
+    written(0),
+    dropped(0)
+{
+    this->file = fopen(path.c_str(), format == TRACE_RAW ? "wb" : "w");
+
+    if (!this->file) {
+        cerr << "ERROR: Could not open " << path << " for writing.\n";
+        this->stopping.store(true, memory_order_release);
+        return;
+    }
+
+    if (format == TRACE_RAW) {
+        TraceFileHeader header = {};
+        memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+        header.version = TRACE_VERSION;
+        header.record_size = sizeof(TraceRecord);
+        fwrite(&header, sizeof(header), 1, this->file);
+    }
+
+    this->worker = thread(&Tracer::worker_loop, this);
+}
+
+Tracer::~Tracer()
+{
+    this->close();
+}
+
+bool Tracer::is_open()
+{
+    return this->file != nullptr;
+}
+
+void Tracer::close()
+{
+    if (!this->file)
+        return;
+
+    this->stopping.store(true, memory_order_release);
+    this->worker.join();
+    fclose(this->file);
+    this->file = nullptr;
+}
+
+size_t Tracer::drain()
+{
+    TraceRecord batch[256];
+    char line[TRACE_LINE_SIZE];
+    size_t total = 0;
+
+    for (;;) {
+        size_t count = 0;
+
+        while (count < 256 && this->ring.pop(batch[count]))
+            count++;
+
+        if (count == 0)
+            return total;
+
+        if (this->format == TRACE_RAW) {
+            fwrite(batch, sizeof(TraceRecord), count, this->file);
+        } else {
+            for (size_t i = 0; i < count; i++)
+                fwrite(line, 1, format_line(batch[i], line, sizeof(line)), this->file);
+        }
+
+        total += count;
+        this->written.fetch_add(count, memory_order_relaxed);
+    }
+}
+
+void Tracer::worker_loop()
+{
+    /* The CPU never signals; an idle writer just naps, so recording stays a plain ring push */
+    while (!this->stopping.load(memory_order_acquire)) {
+        if (this->drain() == 0)
+            this_thread::sleep_for(chrono::microseconds(TRACE_IDLE_US));
+    }
+
+    this->drain();
+}
+
+uint64_t Tracer::get_written()
+{
+    return this->written.load(memory_order_relaxed);
+}
+
+uint64_t Tracer::get_dropped()
+{
+    return this->dropped.load(memory_order_relaxed);
+}
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/* Hand-rolled rather than snprintf: formatting is what bounds a lossless text trace */
+static char* put_hex(char* out, unsigned val, unsigned digits)
+{
+    for (unsigned i = digits; i > 0; i--) {
+        out[i - 1] = HEX_DIGITS[val & 0xF];
+        val >>= 4;
+    }
+
+    return out + digits;
+}
+
+static char* put_str(char* out, const char* str)
+{
+    while (*str)
+        *out++ = *str++;
+
+    return out;
+}
+
+static char* put_dec(char* out, uint64_t val, unsigned width)
+{
+    char digits[20];
+    unsigned n = 0;
+
+    do {
+        digits[n++] = '0' + val % 10;
+        val /= 10;
+    } while (val);
+
+    for (unsigned i = n; i < width; i++)
+        *out++ = ' ';
+
+    while (n)
+        *out++ = digits[--n];
+
+    return out;
+}
+
+static char* pad_to(char* out, char* line, size_t column)
+{
+    while ((size_t) (out - line) < column)
+        *out++ = ' ';
+
+    return out;
+}
+
+size_t Tracer::format_line(const TraceRecord& r, char* out, size_t size)
+{
+    char line[TRACE_LINE_SIZE];
+    char* p = line;
+    uint8_t len = INSTR_LEN[r.opcode] ? INSTR_LEN[r.opcode] : 1;
+    uint8_t lo = r.operands[0];
+    uint16_t word = lo | r.operands[1] << 8;
+
+    p = put_hex(p, r.pc, 4);
+    p = put_str(p, "  ");
+    p = put_hex(p, r.opcode, 2);
+    for (uint8_t i = 1; i < len; i++) {
+        *p++ = ' ';
+        p = put_hex(p, r.operands[i - 1], 2);
+    }
+    p = pad_to(p, line, 16);
+
+    p = put_str(p, MNEMONICS[r.opcode]);
+    *p++ = ' ';
+
+    switch (MAPPING_MODES[r.opcode]) {
+        case ACCUMULATOR: p = put_str(p, "A"); break;
+        case IMMEDIATE:   p = put_hex(put_str(p, "#$"), lo, 2); break;
+        case ZERO:        p = put_hex(put_str(p, "$"), lo, 2); break;
+        case ZERO_X:      p = put_str(put_hex(put_str(p, "$"), lo, 2), ",X"); break;
+        case ZERO_Y:      p = put_str(put_hex(put_str(p, "$"), lo, 2), ",Y"); break;
+        case ABSOLUTE:    p = put_hex(put_str(p, "$"), word, 4); break;
+        case ABSOLUTE_X:  p = put_str(put_hex(put_str(p, "$"), word, 4), ",X"); break;
+        case ABSOLUTE_Y:  p = put_str(put_hex(put_str(p, "$"), word, 4), ",Y"); break;
+        case INDIRECT:    p = put_str(put_hex(put_str(p, "($"), word, 4), ")"); break;
+        case INDIRECT_X:  p = put_str(put_hex(put_str(p, "($"), lo, 2), ",X)"); break;
+        case INDIRECT_Y:  p = put_str(put_hex(put_str(p, "($"), lo, 2), "),Y"); break;
+        case RELATIVE:    p = put_hex(put_str(p, "$"), (uint16_t) (r.pc + 2 + (int8_t) lo), 4); break;
+        default: break;
+    }
+    p = pad_to(p, line, 48);
+
+    /* The PPU runs three dots per CPU cycle from power-on */
+    uint64_t dots = r.cycle * DOTS_PER_CPU_CYCLE;
+
+    p = put_hex(put_str(p, "A:"), r.a, 2);
+    p = put_hex(put_str(p, " X:"), r.x, 2);
+    p = put_hex(put_str(p, " Y:"), r.y, 2);
+    p = put_hex(put_str(p, " P:"), r.p, 2);
+    p = put_hex(put_str(p, " SP:"), r.s, 2);
+    p = put_dec(put_str(p, " PPU:"), (dots / DOTS_PER_LINE) % LINES_PER_FRAME, 3);
+    p = put_dec(put_str(p, ","), dots % DOTS_PER_LINE, 3);
+    p = put_dec(put_str(p, " CYC:"), r.cycle, 0);
+    *p++ = '\n';
+
+    size_t n = min((size_t) (p - line), size - 1);
+    memcpy(out, line, n);
+    out[n] = '\0';
+    return n;
+}
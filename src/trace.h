@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "spsc_ring.h"
+
+using namespace std;
+
+const size_t TRACE_RING_SIZE = 1 << 16;
+const size_t TRACE_LINE_SIZE = 128;
+const char TRACE_MAGIC[8] = { 'N', 'E', 'S', 'T', 'R', 'A', 'C', 'E' };
+const uint32_t TRACE_VERSION = 1;
+
+enum TraceFormat {
+    TRACE_TEXT,     // One nestest-style line per instruction
+    TRACE_RAW       // Header, then TraceRecords as they are in memory
+};
+
+/* CPU state just before an instruction runs, with the instruction's bytes */
+struct TraceRecord {
+    uint64_t    cycle;
+    uint16_t    pc;
+    uint8_t     opcode;
+    uint8_t     operands[2];
+    uint8_t     a, x, y, p, s;
+};
+
+struct TraceFileHeader {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    record_size;
+};
+
+/*
+ * Instruction trace sink for one CPU. The CPU pushes binary records into a lock-free ring;
+ * a background thread formats them, or writes them raw, to a file. If the writer falls
+ * behind, records are dropped and counted. A lossless tracer makes the CPU wait instead,
+ * unless there is no writer to wait for: the file did not open, or the tracer was closed.
+ */
+class Tracer
+{
+private:
+    SpscRing<TraceRecord, TRACE_RING_SIZE>  ring;
+    FILE*               file = nullptr;
+    TraceFormat         format;
+    bool                lossless;
+    atomic<bool>        stopping;
+    atomic<uint64_t>    written;
+    atomic<uint64_t>    dropped;
+    thread              worker;
+
+    void                worker_loop();
+    size_t              drain();
+
+public:
+    Tracer(const string& path, TraceFormat format, bool lossless = false);
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    bool                is_open();
+    /* Writes out everything recorded so far and closes the file */
+    void                close();
+
+    /* CPU side */
+    inline void record(const TraceRecord& r)
+    {
+        while (!this->ring.push(r)) {
+            if (!this->lossless || this->stopping.load(memory_order_acquire)) {
+                this->dropped.fetch_add(1, memory_order_relaxed);
+                return;
+            }
+
+            this_thread::yield();
+        }
+    }
+
+    uint64_t            get_written();
+    uint64_t            get_dropped();
+
+    /* nestest.log layout, without the memory contents it shows after some operands */
+    static size_t       format_line(const TraceRecord& r, char* out, size_t size);
+};
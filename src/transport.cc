@@ -0,0 +1,159 @@
+#include "transport.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+void Transport::set_conditions(unsigned delay_ms, double loss, unsigned seed)
+{
+    this->delay = chrono::milliseconds(delay_ms);
+    this->loss = loss;
+    this->rng.seed(seed);
+}
+
+void Transport::flush()
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    while (!this->delayed.empty() && this->delayed.front().due <= now) {
+        const vector<uint8_t>& data = this->delayed.front().data;
+        this->transmit(data.data(), data.size());
+        this->delayed.pop_front();
+    }
+}
+
+bool Transport::send(const uint8_t* data, size_t size)
+{
+    if (size > MAX_DATAGRAM_SIZE)
+        return false;
+
+    if (this->loss > 0.0 && uniform_real_distribution<double>(0.0, 1.0)(this->rng) < this->loss) {
+        this->dropped++;
+        return true; // As far as the sender can tell, it went out
+    }
+
+    if (this->delay.count() == 0 && this->delayed.empty())
+        return this->transmit(data, size);
+
+    this->delayed.push_back({ chrono::steady_clock::now() + this->delay, vector<uint8_t>(data, data + size) });
+    this->flush();
+    return true;
+}
+
+size_t Transport::receive(uint8_t* data, size_t max_size)
+{
+    this->flush();
+    return this->poll(data, max_size);
+}
+
+uint64_t Transport::get_dropped()
+{
+    return this->dropped;
+}
+
+void LoopbackTransport::connect(LoopbackTransport& a, LoopbackTransport& b)
+{
+    a.peer = &b;
+    b.peer = &a;
+}
+
+bool LoopbackTransport::transmit(const uint8_t* data, size_t size)
+{
+    if (!this->peer)
+        return false;
+
+    lock_guard<mutex> guard(this->peer->lock);
+    this->peer->inbox.emplace_back(data, data + size);
+    return true;
+}
+
+size_t LoopbackTransport::poll(uint8_t* data, size_t max_size)
+{
+    lock_guard<mutex> guard(this->lock);
+
+    if (this->inbox.empty())
+        return 0;
+
+    size_t size = min(this->inbox.front().size(), max_size);
+    memcpy(data, this->inbox.front().data(), size);
+    this->inbox.pop_front();
+    return size;
+}
+
+static sockaddr_in loopback_addr(uint16_t port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+UdpTransport::UdpTransport(uint16_t local_port)
+{
+    this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (this->fd < 0) {
+        cerr << "ERROR: Could not create UDP socket: " << strerror(errno) << ".\n";
+        return;
+    }
+
+    sockaddr_in addr = loopback_addr(local_port);
+    socklen_t len = sizeof(addr);
+
+    if (bind(this->fd, (sockaddr*) &addr, len) < 0 ||
+        getsockname(this->fd, (sockaddr*) &addr, &len) < 0 ||
+        fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) | O_NONBLOCK) < 0) {
+        cerr << "ERROR: Could not bind UDP port " << local_port << ": " << strerror(errno) << ".\n";
+        ::close(this->fd);
+        this->fd = -1;
+        return;
+    }
+
+    this->local_port = ntohs(addr.sin_port);
+}
+
+UdpTransport::~UdpTransport()
+{
+    if (this->fd >= 0)
+        ::close(this->fd);
+}
+
+bool UdpTransport::is_open()
+{
+    return this->fd >= 0;
+}
+
+void UdpTransport::connect(uint16_t remote_port)
+{
+    this->remote_port = remote_port;
+}
+
+uint16_t UdpTransport::get_local_port()
+{
+    return this->local_port;
+}
+
+bool UdpTransport::transmit(const uint8_t* data, size_t size)
+{
+    if (this->fd < 0 || this->remote_port == 0)
+        return false;
+
+    sockaddr_in addr = loopback_addr(this->remote_port);
+    return sendto(this->fd, data, size, 0, (sockaddr*) &addr, sizeof(addr)) == (ssize_t) size;
+}
+
+size_t UdpTransport::poll(uint8_t* data, size_t max_size)
+{
+    if (this->fd < 0)
+        return 0;
+
+    ssize_t size = recv(this->fd, data, max_size, 0);
+    return size > 0 ? size : 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const size_t MAX_DATAGRAM_SIZE = 512;
+
+/*
+ * Unreliable datagram link between two sessions. Every transport can be given an artificial
+ * one-way delay and a loss rate, applied on the sending side, so the same session code can be
+ * tested against a bad network in-process or over real sockets. The loss RNG is seeded, so a
+ * given seed drops the same packets every run.
+ */
+class Transport
+{
+private:
+    struct Delayed {
+        chrono::steady_clock::time_point    due;
+        vector<uint8_t>                     data;
+    };
+
+    deque<Delayed>  delayed;
+    chrono::microseconds delay{0};
+    double          loss = 0.0;
+    minstd_rand     rng;
+    uint64_t        dropped = 0;
+
+    void            flush();
+
+protected:
+    virtual bool    transmit(const uint8_t* data, size_t size) = 0;
+    /* Returns the size of the next datagram received, 0 if there is none */
+    virtual size_t  poll(uint8_t* data, size_t max_size) = 0;
+
+public:
+    virtual ~Transport() {}
+
+    void            set_conditions(unsigned delay_ms, double loss, unsigned seed = 1);
+
+    /* Neither call ever blocks */
+    bool            send(const uint8_t* data, size_t size);
+    size_t          receive(uint8_t* data, size_t max_size);
+
+    /* Datagrams thrown away by the simulated loss */
+    uint64_t        get_dropped();
+};
+
+/* In-process transport: connect two endpoints and each one's sends arrive in the other's inbox */
+class LoopbackTransport : public Transport
+{
+private:
+    LoopbackTransport*      peer = nullptr;
+    mutex                   lock;
+    deque<vector<uint8_t>>  inbox;
+
+protected:
+    bool            transmit(const uint8_t* data, size_t size) override;
+    size_t          poll(uint8_t* data, size_t max_size) override;
+
+public:
+    static void     connect(LoopbackTransport& a, LoopbackTransport& b);
+};
+
+/* UDP between two ports on the loopback interface */
+class UdpTransport : public Transport
+{
+private:
+    int             fd = -1;
+    uint16_t        local_port = 0;
+    uint16_t        remote_port = 0;
+
+protected:
+    bool            transmit(const uint8_t* data, size_t size) override;
+    size_t          poll(uint8_t* data, size_t max_size) override;
+
+public:
+    /* Port 0 lets the system pick one, see get_local_port() */
+    UdpTransport(uint16_t local_port = 0);
+    ~UdpTransport();
+
+    UdpTransport(const UdpTransport&) = delete;
+    UdpTransport& operator=(const UdpTransport&) = delete;
+
+    bool            is_open();
+    void            connect(uint16_t remote_port);
+    uint16_t        get_local_port();
+};
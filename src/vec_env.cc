@@ -0,0 +1,134 @@
+#include "vec_env.h"
+
+#include <cstring>
+
+/* Hands the PPU a slot of the caller's observation buffer to render into */
+class VecEnv::EnvTarget : public FrameTarget
+{
+public:
+    uint8_t*    out = nullptr;
+
+    uint8_t* next_target() override
+    {
+        return this->out;
+    }
+
+    void present_target(__attribute__((unused)) uint64_t frame) override
+    {
+    }
+};
+
+VecEnv::VecEnv(ROM& rom, size_t num_envs, const VecEnvConfig& config) :
+    config(config),
+    envs(num_envs),
+    start(new NESSnapshot()),
+    start_observation(ENV_OBSERVATION_SIZE),
+    pool(config.threads)
+{
+    for (size_t i = 0; i < num_envs; i++) {
+        Env& env = this->envs[i];
+        env.nes.reset(new NES());
+        env.target.reset(new EnvTarget());
+        env.episode_frames = 0;
+
+        if (i == 0)
+            env.nes->load(rom);
+        else
+            env.nes->copy_cartridge(*this->envs[0].nes);
+
+        env.nes->set_frame_target(env.target.get());
+    }
+
+    if (num_envs == 0)
+        return;
+
+    /* The start observation is the last start frame, or the first frame for start_frames 0 */
+    NES& first = *this->envs[0].nes;
+    this->envs[0].target->out = this->start_observation.data();
+
+    for (unsigned f = 0; f < this->config.start_frames; f++)
+        first.emulate_frame(f + 1 == this->config.start_frames, false);
+
+    first.save_state(*this->start);
+
+    if (this->config.start_frames == 0) {
+        first.emulate_frame(true, false);
+        first.load_state(*this->start);
+    }
+
+    for (size_t i = 0; i < num_envs; i++)
+        this->reset_env(i);
+}
+
+VecEnv::~VecEnv()
+{
+}
+
+size_t VecEnv::size()
+{
+    return this->envs.size();
+}
+
+void VecEnv::reset_env(size_t i)
+{
+    this->envs[i].nes->load_state(*this->start);
+    this->envs[i].episode_frames = 0;
+}
+
+bool VecEnv::step_env(size_t i, uint8_t action, uint8_t* observation)
+{
+    Env& env = this->envs[i];
+    NES& nes = *env.nes;
+
+    env.target->out = observation;
+    nes.get_controllers().set_buttons(0, action);
+
+    for (unsigned f = 0; f < this->config.frame_skip; f++)
+        nes.emulate_frame(observation && f + 1 == this->config.frame_skip, false);
+
+    env.episode_frames += this->config.frame_skip;
+
+    return (this->config.max_episode_frames && env.episode_frames >= this->config.max_episode_frames) ||
+           (this->config.is_done && this->config.is_done(nes));
+}
+
+void VecEnv::reset(uint8_t* observations, uint8_t* ram)
+{
+    this->pool.parallel_for(this->envs.size(), [&](size_t i) {
+        this->reset_env(i);
+
+        if (observations)
+            memcpy(observations + i * ENV_OBSERVATION_SIZE, this->start_observation.data(), ENV_OBSERVATION_SIZE);
+        if (ram)
+            memcpy(ram + i * ENV_RAM_SIZE, this->get_ram_view(i), ENV_RAM_SIZE);
+    });
+}
+
+void VecEnv::step(const uint8_t* actions, uint8_t* observations, uint8_t* ram, uint8_t* dones)
+{
+    this->pool.parallel_for(this->envs.size(), [&](size_t i) {
+        bool done = this->step_env(i, actions[i], observations ? observations + i * ENV_OBSERVATION_SIZE : nullptr);
+
+        if (ram)
+            memcpy(ram + i * ENV_RAM_SIZE, this->get_ram_view(i), ENV_RAM_SIZE);
+        if (dones)
+            dones[i] = done;
+        if (done)
+            this->reset_env(i);
+    });
+}
+
+const uint8_t* VecEnv::get_ram_view(size_t i)
+{
+    return this->envs[i].nes->get_cpu().get_ram();
+}
+
+const uint8_t* VecEnv::get_start_observation()
+{
+    return this->start_observation.data();
+}
+
+NES& VecEnv::get_env(size_t i)
+{
+    return *this->envs[i].nes;
+}
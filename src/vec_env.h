@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "nes.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/* Per environment: one frame of palette indices, and the 2KB of work RAM */
+const size_t ENV_OBSERVATION_SIZE = FRAME_PIXELS;
+const size_t ENV_RAM_SIZE = RAM_SIZE;
+
+struct VecEnvConfig {
+    unsigned    frame_skip = 4;             // Frames each action is held for; only the last is rendered
+    uint64_t    max_episode_frames = 0;     // 0 for no limit
+    unsigned    start_frames = 0;           // Frames run from power-on before the start state is cached
+    size_t      threads = 0;                // Workers besides the calling thread
+    function<bool(NES&)>    is_done;        // Game-specific end of episode; runs on worker threads
+};
+
+/*
+ * Many instances of one cartridge stepped together for reinforcement learning. Outputs go into
+ * caller buffers laid out environment after environment: the PPU of environment i renders its
+ * frame straight into observations + i * ENV_OBSERVATION_SIZE, so observations are never copied.
+ * An environment whose episode ends reports done with its final observation and RAM, and is
+ * reloaded from the cached start state, so its next step begins a new episode.
+ */
+class VecEnv
+{
+private:
+    class EnvTarget;
+
+    struct Env {
+        unique_ptr<EnvTarget>   target;     // Outlives the NES that renders into it
+        unique_ptr<NES>         nes;
+        uint64_t                episode_frames;
+    };
+
+    VecEnvConfig                config;
+    vector<Env>                 envs;
+    unique_ptr<NESSnapshot>     start;
+    vector<uint8_t>             start_observation;
+    ThreadPool                  pool;
+
+    void        reset_env(size_t i);
+    bool        step_env(size_t i, uint8_t action, uint8_t* observation);
+
+public:
+    VecEnv(ROM& rom, size_t num_envs, const VecEnvConfig& config = VecEnvConfig());
+    ~VecEnv();
+
+    VecEnv(const VecEnv&) = delete;
+    VecEnv& operator=(const VecEnv&) = delete;
+
+    size_t      size();
+
+    /* Puts every environment back at the start state; either buffer may be nullptr */
+    void        reset(uint8_t* observations, uint8_t* ram);
+    /*
+     * Applies actions[i] to controller 1 of environment i for frame_skip frames, in parallel.
+     * observations, ram and dones may each be nullptr when not wanted; without observations
+     * nothing is rendered at all.
+     */
+    void        step(const uint8_t* actions, uint8_t* observations, uint8_t* ram, uint8_t* dones);
+
+    /* The live work RAM of environment i, valid until the next step() */
+    const uint8_t* get_ram_view(size_t i);
+    /* What every episode starts from */
+    const uint8_t* get_start_observation();
+    NES&        get_env(size_t i);
+};
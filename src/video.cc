@@ -0,0 +1,322 @@
+#include "video.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define VIDEO_HAVE_AVX2_PATH
+#endif
+
+static constexpr uint32_t rgba(uint32_t rgb)
+{
+    return 0xFF000000 | (rgb & 0xFF) << 16 | (rgb & 0xFF00) | (rgb >> 16 & 0xFF);
+}
+
+const uint32_t NES_PALETTE[NUM_PALETTE_COLORS] = {
+    rgba(0x747474), rgba(0x24188C), rgba(0x0000A8), rgba(0x44009C), rgba(0x8C0074), rgba(0xA80010), rgba(0xA40000), rgba(0x7C0800),
+    rgba(0x402C00), rgba(0x004400), rgba(0x005000), rgba(0x003C14), rgba(0x183C5C), rgba(0x000000), rgba(0x000000), rgba(0x000000),
+    rgba(0xBCBCBC), rgba(0x0070EC), rgba(0x2038EC), rgba(0x8000F0), rgba(0xBC00BC), rgba(0xE40058), rgba(0xD82800), rgba(0xC84C0C),
+    rgba(0x887000), rgba(0x009400), rgba(0x00A800), rgba(0x009038), rgba(0x008088), rgba(0x000000), rgba(0x000000), rgba(0x000000),
+    rgba(0xFCFCFC), rgba(0x3CBCFC), rgba(0x5C94FC), rgba(0xCC88FC), rgba(0xF478FC), rgba(0xFC74B4), rgba(0xFC7460), rgba(0xFC9838),
+    rgba(0xF0BC3C), rgba(0x80D010), rgba(0x4CDC48), rgba(0x58F898), rgba(0x00E8D8), rgba(0x787878), rgba(0x000000), rgba(0x000000),
+    rgba(0xFCFCFC), rgba(0xA8E4FC), rgba(0xC4D4FC), rgba(0xD4C8FC), rgba(0xFCC4FC), rgba(0xFCC4D8), rgba(0xFCBCB0), rgba(0xFCD8A8),
+    rgba(0xFCE4A0), rgba(0xE0FCA0), rgba(0xA8F0BC), rgba(0xB0FCCC), rgba(0x9CFCF0), rgba(0xC4C4C4), rgba(0x000000), rgba(0x000000)
+};
+
+/* 2C02 composite output levels: four luma rows, low half then high half of the square wave */
+const float NTSC_LEVELS[8]              = { 0.350f, 0.518f, 0.962f, 1.550f, 1.094f, 1.506f, 1.962f, 1.962f };
+const float NTSC_BLACK                  = 0.518f;
+const float NTSC_WHITE                  = 1.962f;
+
+/* 341 dots * 8 samples per scanline leaves each row 4 samples further round the subcarrier */
+const unsigned NTSC_PHASE_STEP_PER_ROW  = 4;
+const size_t NTSC_ROW_SAMPLES           = FRAME_WIDTH * NTSC_SAMPLES_PER_PIXEL;
+const size_t NTSC_HALF_WINDOW           = NTSC_PHASES / 2;
+const double NTSC_PI                    = 3.14159265358979323846;
+
+static uint8_t clamp_channel(float v)
+{
+    if (v <= 0.0f)
+        return 0;
+
+    if (v >= 1.0f)
+        return 0xFF;
+
+    return (uint8_t) (v * 255.0f + 0.5f);
+}
+
+static void convert_row_scalar(const uint8_t* src, uint32_t* dst, unsigned scale)
+{
+    if (scale == 1) {
+        for (size_t x = 0; x < FRAME_WIDTH; x++)
+            dst[x] = NES_PALETTE[src[x] & PALETTE_INDEX_MASK];
+        return;
+    }
+
+    for (size_t x = 0; x < FRAME_WIDTH; x++) {
+        uint32_t px = NES_PALETTE[src[x] & PALETTE_INDEX_MASK];
+        dst[2 * x] = px;
+        dst[2 * x + 1] = px;
+    }
+}
+
+#ifdef VIDEO_HAVE_AVX2_PATH
+__attribute__((target("avx2")))
+static void convert_row_avx2(const uint8_t* src, uint32_t* dst, unsigned scale)
+{
+    const __m256i mask = _mm256_set1_epi32(PALETTE_INDEX_MASK);
+    const __m256i dup_lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const __m256i dup_hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+
+    for (size_t x = 0; x < FRAME_WIDTH; x += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) &src[x]));
+        __m256i px = _mm256_i32gather_epi32((const int*) NES_PALETTE, _mm256_and_si256(idx, mask), 4);
+
+        if (scale == 1) {
+            _mm256_storeu_si256((__m256i*) &dst[x], px);
+        } else {
+            _mm256_storeu_si256((__m256i*) &dst[2 * x], _mm256_permutevar8x32_epi32(px, dup_lo));
+            _mm256_storeu_si256((__m256i*) &dst[2 * x + 8], _mm256_permutevar8x32_epi32(px, dup_hi));
+        }
+    }
+}
+
+static bool host_has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+VideoConverter::VideoConverter(unsigned scale, VideoFilter filter, size_t num_threads) :
+    scale(scale == 2 ? 2 : 1),
+    filter(filter),
+    pool(num_threads)
+{
+    for (size_t p = 0; p < NTSC_PHASES; p++) {
+        this->cos_phase[p] = (float) cos(NTSC_PI * p / 6.0);
+        this->sin_phase[p] = (float) sin(NTSC_PI * p / 6.0);
+    }
+
+    for (size_t c = 0; c < NUM_PALETTE_COLORS; c++) {
+        unsigned hue = c & 0x0F;
+        unsigned level = (c >> 4) & 0x03;
+
+        if (hue > 0x0D)
+            level = 1;
+
+        float lo = NTSC_LEVELS[level + 4 * (hue == 0x00)];
+        float hi = NTSC_LEVELS[level + 4 * (hue < 0x0D)];
+
+        for (size_t p = 0; p < NTSC_PHASES; p++) {
+            float v = (hue + p) % NTSC_PHASES < NTSC_HALF_WINDOW ? hi : lo;
+            this->signal[c][p] = (v - NTSC_BLACK) / (NTSC_WHITE - NTSC_BLACK);
+        }
+    }
+}
+
+size_t VideoConverter::get_width()
+{
+    return FRAME_WIDTH * this->scale;
+}
+
+size_t VideoConverter::get_height()
+{
+    return FRAME_HEIGHT * this->scale;
+}
+
+unsigned VideoConverter::get_scale()
+{
+    return this->scale;
+}
+
+VideoFilter VideoConverter::get_filter()
+{
+    return this->filter;
+}
+
+void VideoConverter::convert(const uint8_t* indices, uint32_t* out, unsigned frame_phase)
+{
+    if (this->filter == FILTER_NONE) {
+        this->convert_rgba(indices, out);
+        return;
+    }
+
+    const size_t width = this->get_width();
+    const size_t tasks = (FRAME_HEIGHT + NTSC_ROWS_PER_TASK - 1) / NTSC_ROWS_PER_TASK;
+
+    this->pool.parallel_for(tasks, [&](size_t task) {
+        size_t end = min(FRAME_HEIGHT, (task + 1) * NTSC_ROWS_PER_TASK);
+
+        for (size_t y = task * NTSC_ROWS_PER_TASK; y < end; y++) {
+            uint32_t* row = &out[y * this->scale * width];
+            this->convert_ntsc_row(&indices[y * FRAME_WIDTH], row, y, frame_phase);
+
+            if (this->scale == 2)
+                memcpy(row + width, row, width * sizeof(uint32_t));
+        }
+    });
+}
+
+void VideoConverter::convert_rgba(const uint8_t* indices, uint32_t* out)
+{
+    const size_t width = this->get_width();
+
+#ifdef VIDEO_HAVE_AVX2_PATH
+    static const bool use_avx2 = host_has_avx2();
+#endif
+
+    for (size_t y = 0; y < FRAME_HEIGHT; y++) {
+        const uint8_t* src = &indices[y * FRAME_WIDTH];
+        uint32_t* dst = &out[y * this->scale * width];
+
+#ifdef VIDEO_HAVE_AVX2_PATH
+        if (use_avx2)
+            convert_row_avx2(src, dst, this->scale);
+        else
+#endif
+            convert_row_scalar(src, dst, this->scale);
+
+        if (this->scale == 2)
+            memcpy(dst + width, dst, width * sizeof(uint32_t));
+    }
+}
+
+void VideoConverter::convert_ntsc_row(const uint8_t* row, uint32_t* out, size_t y, unsigned frame_phase)
+{
+    /* Prefix sums of the signal and its products with the subcarrier, so every decode window is O(1) */
+    float sum_y[NTSC_ROW_SAMPLES + 1];
+    float sum_i[NTSC_ROW_SAMPLES + 1];
+    float sum_q[NTSC_ROW_SAMPLES + 1];
+    unsigned phase = (frame_phase + y * NTSC_PHASE_STEP_PER_ROW) % NTSC_PHASES;
+
+    sum_y[0] = sum_i[0] = sum_q[0] = 0.0f;
+
+    for (size_t k = 0; k < NTSC_ROW_SAMPLES; k++) {
+        float v = this->signal[row[k / NTSC_SAMPLES_PER_PIXEL] & PALETTE_INDEX_MASK][phase];
+        sum_y[k + 1] = sum_y[k] + v;
+        sum_i[k + 1] = sum_i[k] + v * this->cos_phase[phase];
+        sum_q[k + 1] = sum_q[k] + v * this->sin_phase[phase];
+        phase = (phase + 1 == NTSC_PHASES) ? 0 : phase + 1;
+    }
+
+    const size_t width = this->get_width();
+    const float norm = 1.0f / NTSC_PHASES;
+
+    for (size_t x = 0; x < width; x++) {
+        size_t center = (2 * x + 1) * (NTSC_SAMPLES_PER_PIXEL / 2) / this->scale;
+        size_t a = center >= NTSC_HALF_WINDOW ? center - NTSC_HALF_WINDOW : 0;
+        size_t b = min(center + NTSC_HALF_WINDOW, NTSC_ROW_SAMPLES);
+
+        float luma = (sum_y[b] - sum_y[a]) * norm;
+        float i = (sum_i[b] - sum_i[a]) * norm;
+        float q = (sum_q[b] - sum_q[a]) * norm;
+
+        uint32_t r = clamp_channel(luma + 0.946882f * i + 0.623557f * q);
+        uint32_t g = clamp_channel(luma - 0.274788f * i - 0.635691f * q);
+        uint32_t bl = clamp_channel(luma - 1.108545f * i + 1.709007f * q);
+
+        out[x] = 0xFF000000 | bl << 16 | g << 8 | r;
+    }
+}
+
+PostProcessor::PostProcessor(unsigned scale, VideoFilter filter, size_t num_threads, const Sink& sink) :
+    converter(scale, filter, num_threads),
+    sink(sink),
+    pending(FRAME_PIXELS),
+    working(FRAME_PIXELS),
+    output(converter.get_width() * converter.get_height())
+{
+    this->worker = thread(&PostProcessor::worker_loop, this);
+}
+
+PostProcessor::~PostProcessor()
+{
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stopping = true;
+    }
+
+    this->wake.notify_one();
+    this->worker.join();
+}
+
+void PostProcessor::worker_loop()
+{
+    for (;;) {
+        uint64_t frame;
+
+        {
+            unique_lock<mutex> guard(this->lock);
+            this->wake.wait(guard, [&] { return this->stopping || this->has_pending; });
+
+            if (!this->has_pending)
+                return;
+
+            this->pending.swap(this->working);
+            frame = this->pending_frame;
+            this->has_pending = false;
+            this->converting = true;
+        }
+
+        /* NTSC frames alternate between two subcarrier phases because odd frames skip a dot */
+        this->converter.convert(this->working.data(), this->output.data(), (frame & 1) * NTSC_PHASE_STEP_PER_ROW);
+
+        if (this->sink)
+            this->sink(this->output.data(), this->converter.get_width(), this->converter.get_height(), frame);
+
+        {
+            lock_guard<mutex> guard(this->lock);
+            this->converting = false;
+            this->converted++;
+        }
+
+        this->idle.notify_all();
+    }
+}
+
+bool PostProcessor::submit(const uint8_t* indices)
+{
+    bool replaced;
+
+    {
+        lock_guard<mutex> guard(this->lock);
+        memcpy(this->pending.data(), indices, FRAME_PIXELS);
+        replaced = this->has_pending;
+
+        if (replaced)
+            this->dropped++;
+
+        this->has_pending = true;
+        this->pending_frame = this->submitted++;
+    }
+
+    this->wake.notify_one();
+    return !replaced;
+}
+
+void PostProcessor::flush()
+{
+    unique_lock<mutex> guard(this->lock);
+    this->idle.wait(guard, [&] { return !this->has_pending && !this->converting; });
+}
+
+uint64_t PostProcessor::get_submitted()
+{
+    lock_guard<mutex> guard(this->lock);
+    return this->submitted;
+}
+
+uint64_t PostProcessor::get_dropped()
+{
+    lock_guard<mutex> guard(this->lock);
+    return this->dropped;
+}
+
+uint64_t PostProcessor::get_converted()
+{
+    lock_guard<mutex> guard(this->lock);
+    return this->converted;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+using namespace std;
+
+const size_t FRAME_WIDTH = 256;
+const size_t FRAME_HEIGHT = 240;
+const size_t FRAME_PIXELS = FRAME_WIDTH * FRAME_HEIGHT;
+
+const size_t NUM_PALETTE_COLORS = 64;
+const uint8_t PALETTE_INDEX_MASK = 0x3F;
+
+/* Host pixels are RGBA32 in memory order, i.e. red is the lowest byte on little-endian hosts */
+extern const uint32_t NES_PALETTE[NUM_PALETTE_COLORS];
+
+/* Composite signal model: 8 samples per PPU dot, 12 samples per color subcarrier cycle */
+const size_t NTSC_SAMPLES_PER_PIXEL = 8;
+const size_t NTSC_PHASES = 12;
+const size_t NTSC_ROWS_PER_TASK = 8;
+
+enum VideoFilter {
+    FILTER_NONE,
+    FILTER_NTSC
+};
+
+/*
+ * Turns a finished frame of 6-bit palette indices into RGBA32 host pixels at 1x or 2x.
+ * FILTER_NONE is a straight table lookup (AVX2 gathers where the host supports them),
+ * FILTER_NTSC encodes each row as a composite signal and decodes it again, splitting
+ * the rows across the worker pool.
+ */
+class VideoConverter
+{
+private:
+    unsigned        scale;
+    VideoFilter     filter;
+    ThreadPool      pool;
+    float           signal[NUM_PALETTE_COLORS][NTSC_PHASES];
+    float           cos_phase[NTSC_PHASES];
+    float           sin_phase[NTSC_PHASES];
+
+    void            convert_rgba(const uint8_t* indices, uint32_t* out);
+    void            convert_ntsc_row(const uint8_t* row, uint32_t* out, size_t y, unsigned frame_phase);
+
+public:
+    VideoConverter(unsigned scale, VideoFilter filter, size_t num_threads);
+
+    size_t          get_width();
+    size_t          get_height();
+    unsigned        get_scale();
+    VideoFilter     get_filter();
+
+    /* out must hold get_width() * get_height() pixels */
+    void            convert(const uint8_t* indices, uint32_t* out, unsigned frame_phase = 0);
+};
+
+/*
+ * Runs a VideoConverter on its own thread, after emulation has finished a frame. submit() only
+ * copies the index frame; if the previous frame has not been picked up yet it is replaced and
+ * counted as dropped, so the emulation thread never waits for conversion.
+ */
+class PostProcessor
+{
+public:
+    typedef function<void(const uint32_t* pixels, size_t width, size_t height, uint64_t frame)> Sink;
+
+private:
+    VideoConverter      converter;
+    Sink                sink;
+    vector<uint8_t>     pending;
+    vector<uint8_t>     working;
+    vector<uint32_t>    output;
+    uint64_t            pending_frame = 0;
+    bool                has_pending = false;
+    bool                converting = false;
+    bool                stopping = false;
+    uint64_t            submitted = 0;
+    uint64_t            dropped = 0;
+    uint64_t            converted = 0;
+    mutex               lock;
+    condition_variable  wake;
+    condition_variable  idle;
+    thread              worker;
+
+    void                worker_loop();
+
+public:
+    PostProcessor(unsigned scale, VideoFilter filter, size_t num_threads, const Sink& sink);
+    ~PostProcessor();
+
+    PostProcessor(const PostProcessor&) = delete;
+    PostProcessor& operator=(const PostProcessor&) = delete;
+
+    bool                submit(const uint8_t* indices);
+    void                flush();
+
+    uint64_t            get_submitted();
+    uint64_t            get_dropped();
+    uint64_t            get_converted();
+};
@@ -0,0 +1,150 @@
+#include "wav_writer.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+const size_t WAV_RING_BLOCKS = 4;
+const chrono::milliseconds WAV_POLL_INTERVAL(50);
+
+static void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+WavWriter::WavWriter(const string& path, unsigned sample_rate, size_t block_samples) :
+    sample_rate(sample_rate),
+    block_samples(block_samples),
+    ring(block_samples * WAV_RING_BLOCKS),
+    block(block_samples),
+    samples_on_disk(0),
+    samples_dropped(0),
+    stopping(false)
+{
+    this->file = fopen(path.c_str(), "wb");
+
+    if (!this->file) {
+        cerr << "ERROR: Could not open " << path << " for writing.\n";
+        return;
+    }
+
+    this->write_header();
+    this->worker = thread(&WavWriter::worker_loop, this);
+}
+
+WavWriter::~WavWriter()
+{
+    this->close();
+}
+
+bool WavWriter::is_open()
+{
+    return this->file != nullptr;
+}
+
+void WavWriter::write_header()
+{
+    uint8_t header[WAV_HEADER_SIZE];
+    uint32_t data_bytes = (uint32_t) (this->samples_on_disk.load() * sizeof(int16_t));
+
+    memcpy(header, "RIFF", 4);
+    put32(header + 4, (uint32_t) (WAV_HEADER_SIZE - 8 + data_bytes));
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);                                 // fmt chunk size
+    put16(header + 20, 1);                                  // PCM
+    put16(header + 22, 1);                                  // Mono
+    put32(header + 24, this->sample_rate);
+    put32(header + 28, this->sample_rate * sizeof(int16_t));
+    put16(header + 32, sizeof(int16_t));                    // Block align
+    put16(header + 34, 16);                                 // Bits per sample
+    memcpy(header + 36, "data", 4);
+    put32(header + 40, data_bytes);
+
+    fseek(this->file, 0, SEEK_SET);
+    fwrite(header, 1, WAV_HEADER_SIZE, this->file);
+    fseek(this->file, 0, SEEK_END);
+}
+
+bool WavWriter::drain(size_t min_samples)
+{
+    bool wrote = false;
+
+    while (this->ring.size() >= min_samples && this->ring.size() > 0) {
+        size_t n = this->ring.read(this->block.data(), this->block_samples);
+
+        if (fwrite(this->block.data(), sizeof(int16_t), n, this->file) != n)
+            cerr << "ERROR: Short write to WAV file.\n";
+
+        this->samples_on_disk.fetch_add(n);
+        wrote = true;
+    }
+
+    return wrote;
+}
+
+void WavWriter::worker_loop()
+{
+    while (!this->stopping.load()) {
+        {
+            unique_lock<mutex> guard(this->lock);
+            this->wake.wait_for(guard, WAV_POLL_INTERVAL, [this] {
+                return this->stopping.load() || this->ring.size() >= this->block_samples;
+            });
+        }
+
+        this->drain(this->block_samples);
+    }
+
+    this->drain(1);
+}
+
+size_t WavWriter::write(const int16_t* samples, size_t count)
+{
+    if (!this->file)
+        return 0;
+
+    size_t written = this->ring.write(samples, count);
+
+    if (written < count)
+        this->samples_dropped.fetch_add(count - written, memory_order_relaxed);
+
+    /* A missed wakeup only costs one poll interval, so the producer never takes the lock */
+    if (this->ring.size() >= this->block_samples)
+        this->wake.notify_one();
+
+    return written;
+}
+
+void WavWriter::close()
+{
+    if (!this->file)
+        return;
+
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stopping.store(true);
+    }
+    this->wake.notify_one();
+    this->worker.join();
+
+    this->write_header();
+    fclose(this->file);
+    this->file = nullptr;
+}
+
+uint64_t WavWriter::get_samples_written()
+{
+    return this->samples_on_disk.load();
+}
+
+uint64_t WavWriter::get_samples_dropped()
+{
+    return this->samples_dropped.load();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "output.h"
+
+using namespace std;
+
+const size_t DEFAULT_WAV_BLOCK_SAMPLES = 1 << 15;
+const size_t WAV_HEADER_SIZE = 44;
+
+/*
+ * Streams mono 16-bit PCM to a WAV file. write() only copies into a lock-free ring and never
+ * waits; a background thread drains the ring and writes it out in large blocks. Samples that do
+ * not fit in the ring are dropped and counted. The header sizes are patched on close().
+ */
+class WavWriter
+{
+private:
+    FILE*               file = nullptr;
+    unsigned            sample_rate;
+    size_t              block_samples;
+    AudioRing           ring;
+    vector<int16_t>     block;
+    atomic<uint64_t>    samples_on_disk;
+    atomic<uint64_t>    samples_dropped;
+    atomic<bool>        stopping;
+    mutex               lock;
+    condition_variable  wake;
+    thread              worker;
+
+    void                worker_loop();
+    bool                drain(size_t min_samples);
+    void                write_header();
+
+public:
+    WavWriter(const string& path, unsigned sample_rate, size_t block_samples = DEFAULT_WAV_BLOCK_SAMPLES);
+    ~WavWriter();
+
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    bool                is_open();
+    /* Emulation side: never blocks, returns the number of samples accepted */
+    size_t              write(const int16_t* samples, size_t count);
+    /* Flushes everything queued, finalizes the header and closes the file */
+    void                close();
+
+    uint64_t            get_samples_written();
+    uint64_t            get_samples_dropped();
+};
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+
+#include "../src/apu.h"
+
+struct APUBench {
+    CPU cpu;
+    APU apu;
+
+    APUBench() :
+        apu(cpu)
+    {
+    }
+
+    void advance(uint64_t cycles)
+    {
+        cpu.set_cycles(cpu.get_cycles() + cycles);
+    }
+
+    /* Pulse 1 at about 440 Hz, constant volume 15, length counter halted */
+    void play_pulse()
+    {
+        apu.write_register(APU_STATUS, STATUS_PULSE1);
+        apu.write_register(APU_PULSE1, 0xBF);
+        apu.write_register(APU_PULSE1 + 2, 0xFD);
+        apu.write_register(APU_PULSE1 + 3, 0x00);
+    }
+};
+
+TEST(APU, LengthCounterSilencesChannel)
+{
+    unique_ptr<APUBench> bench(new APUBench());
+    APU& apu = bench->apu;
+
+    apu.write_register(APU_STATUS, STATUS_PULSE1);
+    apu.write_register(APU_PULSE1, 0x0F);
+    apu.write_register(APU_PULSE1 + 3, 0x18); // Length index 3: 2 half frames
+    ASSERT_EQ(apu.read_status() & STATUS_PULSE1, STATUS_PULSE1);
+
+    bench->advance(FRAME_STEP_CYCLES[0][1] + 4);
+    ASSERT_EQ(apu.read_status() & STATUS_PULSE1, STATUS_PULSE1);
+
+    bench->advance(FRAME_STEP_CYCLES[0][3] - FRAME_STEP_CYCLES[0][1]);
+    ASSERT_EQ(apu.read_status() & STATUS_PULSE1, 0);
+}
+
+TEST(APU, FrameIrqPredicted)
+{
+    unique_ptr<APUBench> bench(new APUBench());
+    APU& apu = bench->apu;
+
+    apu.write_register(APU_FRAME_COUNTER, 0x00);
+    uint64_t irq = apu.get_next_irq_cycle();
+    ASSERT_EQ(irq, bench->cpu.get_cycles() + 3 + FRAME_STEP_CYCLES[0][3]);
+
+    bench->cpu.set_cycles(irq - 1);
+    ASSERT_FALSE(apu.irq_pending());
+    bench->cpu.set_cycles(irq);
+    ASSERT_TRUE(apu.irq_pending());
+
+    bench->advance(1); // The flag is raised on two consecutive cycles
+    ASSERT_EQ(apu.read_status() & STATUS_FRAME_IRQ, STATUS_FRAME_IRQ);
+    bench->advance(1);
+    ASSERT_EQ(apu.read_status() & STATUS_FRAME_IRQ, 0);
+
+    apu.write_register(APU_FRAME_COUNTER, FRAME_IRQ_INHIBIT);
+    ASSERT_EQ(apu.get_next_irq_cycle(), NO_APU_EVENT);
+}
+
+TEST(APU, RunsOnlyWhenAccessed)
+{
+    unique_ptr<APUBench> bench(new APUBench());
+    APU& apu = bench->apu;
+
+    bench->play_pulse();
+    uint64_t synced = apu.get_state().time;
+
+    bench->advance(10000);
+    ASSERT_EQ(apu.get_state().time, synced);
+
+    apu.end_frame();
+    ASSERT_EQ(apu.get_state().time, bench->cpu.get_cycles());
+}
+
+TEST(APU, PulseProducesBandLimitedSamples)
+{
+    unique_ptr<APUBench> bench(new APUBench());
+    APU& apu = bench->apu;
+    int16_t samples[MAX_SAMPLES_PER_FRAME];
+
+    bench->play_pulse();
+    bench->advance(29781);
+    size_t count = apu.end_frame();
+    ASSERT_NEAR(count, 29781 * DEFAULT_SAMPLE_RATE / CPU_CLOCK_RATE, 2);
+    ASSERT_EQ(apu.read_samples(samples, MAX_SAMPLES_PER_FRAME), count);
+
+    /* Square wave: large swings, but no sample jumps straight from one rail to the other */
+    int peak = 0, max_step = 0;
+    for (size_t i = 1; i < count; i++) {
+        peak = max(peak, abs(samples[i]));
+        max_step = max(max_step, abs(samples[i] - samples[i - 1]));
+    }
+    ASSERT_GT(peak, 1000);
+    ASSERT_LT(max_step, 2 * peak);
+
+    apu.write_register(APU_STATUS, 0);
+    bench->advance(29781);
+    apu.end_frame();
+    count = apu.read_samples(samples, MAX_SAMPLES_PER_FRAME);
+    ASSERT_LT(abs(samples[count - 1]), peak / 4);
+}
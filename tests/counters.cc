@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "../src/counters.h"
+#include "fixtures.h"
+
+TEST(ExecCounters, CountsOpcodesModesAndRegions)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    ExecCounters counters;
+    load_program(*cpu, 0x0300, {
+        0xA2, 0x03,         // LDX #3
+        0xCA,               // DEX
+        0xD0, 0xFD,         // BNE -3
+        0x8D, 0x00, 0x20,   // STA $2000
+        0xEA                // NOP
+    });
+    cpu->set_counters(&counters);
+
+    /* LDX, three DEX/BNE pairs, STA, NOP */
+    cpu->run(2 + 3 * 2 + 2 * 3 + 2 + 4 + 2);
+    cpu->set_counters(nullptr);
+
+    ASSERT_EQ(counters.get_opcode(0xCA).count, 3u);
+    ASSERT_EQ(counters.get_opcode(0xD0).count, 3u);
+    ASSERT_EQ(counters.get_opcode(0xD0).cycles, 3u * 2 + 2);   // Taken twice, on the same page
+    ASSERT_EQ(counters.get_mode(IMPLICIT).count, 4u);
+    ASSERT_EQ(counters.get_mode(ABSOLUTE).cycles, 4u);
+    ASSERT_EQ(counters.get_region(REGION_PPU_REG).count, 1u);
+    ASSERT_EQ(counters.get_region(REGION_NONE).count, 8u);
+
+    CounterEntry total = counters.get_total();
+    ASSERT_EQ(total.count, 9u);
+    ASSERT_EQ(total.cycles, cpu->get_cycles());
+
+    cpu->run(cpu->get_cycles() + 100);    // Detached: nothing more is counted
+    ASSERT_EQ(counters.get_total().count, 9u);
+}
+
+TEST(ExecCounters, CountsPagePenalties)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    ExecCounters counters;
+    load_program(*cpu, 0x0300, {
+        0xA2, 0x10,         // LDX #$10
+        0xBD, 0xF8, 0x04,   // LDA $04F8,X: crosses into $0508
+        0xBD, 0x00, 0x04,   // LDA $0400,X: stays
+        0x9D, 0xF8, 0x04    // STA $04F8,X: always takes its extra cycle, no penalty
+    });
+    cpu->set_counters(&counters);
+    cpu->run(2 + 5 + 4 + 5);
+
+    ASSERT_EQ(counters.get_opcode(0xBD).count, 2u);
+    ASSERT_EQ(counters.get_opcode(0xBD).cycles, 9u);
+    ASSERT_EQ(counters.get_page_crossings(0xBD).count, 1u);
+    ASSERT_EQ(counters.get_page_crossings(0x9D).count, 0u);
+    ASSERT_EQ(counters.get_total_page_crossings().cycles, 1u);
+    ASSERT_EQ(counters.get_mode(ABSOLUTE_X).count, 3u);
+    ASSERT_EQ(counters.get_region(REGION_RAM).count, 3u);
+
+    counters.reset();
+    ASSERT_EQ(counters.get_total().count, 0u);
+}
+
+TEST(ExecCounters, WritesJsonAndCsv)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    ExecCounters counters;
+    load_program(*cpu, 0x0300, { 0xEA, 0xEA, 0xA9, 0x01 });   // NOP, NOP, LDA #1
+    cpu->set_counters(&counters);
+    cpu->run(6);
+
+    ostringstream json;
+    counters.write_json(json);
+    ASSERT_NE(json.str().find("\"NOP_EA\": { \"count\": 2, \"cycles\": 4 }"), string::npos);
+    ASSERT_NE(json.str().find("\"IMMEDIATE\": { \"count\": 1, \"cycles\": 2 }"), string::npos);
+    ASSERT_NE(json.str().find("\"none\": { \"count\": 3, \"cycles\": 6 }"), string::npos);
+    ASSERT_EQ(json.str().find("ram"), string::npos);
+
+    ostringstream csv;
+    counters.write_csv(csv);
+    ASSERT_EQ(csv.str(),
+        "kind,key,count,cycles\n"
+        "opcode,LDA_A9,1,2\n"
+        "opcode,NOP_EA,2,4\n"
+        "mode,IMPLICIT,2,4\n"
+        "mode,IMMEDIATE,1,2\n"
+        "region,none,3,6\n");
+}
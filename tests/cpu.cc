@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 
 #include <iostream>
+#include <vector>
 
 #include "../src/cpu.h"
+#include "fixtures.h"
 
 // TODO: Ensure flags work correctly on all instructions
 // TODO: Finish testing last few addressing modes
@@ -772,3 +774,93 @@ TEST(Instructions, PLP)
     cpu.exec(opcode);
     ASSERT_EQ(cpu.get_p(), EXPECTED);
 }
+
+/* load_program(), with all three vectors pointing at a NOP at handler */
+static void load_program_with_irq_handler(CPU& cpu, uint16_t addr, const vector<uint8_t>& program, uint16_t handler)
+{
+    load_program(cpu, addr, program);
+
+    for (uint16_t vector = NMI_VECTOR; vector != 0; vector += 2) {
+        cpu.set_mem8(vector, handler & 0xFF);
+        cpu.set_mem8(vector + 1, handler >> 8);
+    }
+
+    cpu.set_mem8(handler, 0xEA); // NOP
+}
+
+TEST(Interrupts, ResetLoadsVector)
+{
+    CPU cpu = CPU();
+    load_program_with_irq_handler(cpu, 0x0200, {}, 0x1234);
+    cpu.set_p(0);
+    cpu.reset();
+
+    ASSERT_EQ(cpu.get_pc(), 0x1234);
+    ASSERT_EQ(cpu.get_p() & FLAG_INTERRUPT, FLAG_INTERRUPT);
+    ASSERT_EQ(cpu.get_cycles(), INTERRUPT_CYCLES);
+}
+
+TEST(Interrupts, NmiPushesStateAndReturns)
+{
+    CPU cpu = CPU();
+    load_program_with_irq_handler(cpu, 0x0200, { 0xEA, 0xEA, 0xEA }, 0x0300);
+    cpu.set_mem8(0x0300, 0x40); // RTI
+    cpu.set_cycles(100);
+    cpu.set_p(FLAG_CARRY);
+
+    cpu.nmi(0);
+    cpu.run(101);
+    ASSERT_EQ(cpu.get_pc(), 0x0300);
+    ASSERT_EQ(cpu.get_p() & FLAG_INTERRUPT, FLAG_INTERRUPT);
+
+    cpu.run(cpu.get_cycles() + 1);
+    ASSERT_EQ(cpu.get_pc(), 0x0200);
+    ASSERT_EQ(cpu.get_p() & ~FLAG_UNUSED, FLAG_CARRY);
+}
+
+TEST(Interrupts, CliTakesEffectAfterNextInstruction)
+{
+    CPU cpu = CPU();
+    load_program_with_irq_handler(cpu, 0x0200, { 0x58, 0xEA, 0xEA, 0xEA }, 0x0300); // CLI, NOP, NOP, NOP
+    cpu.set_cycles(100);
+
+    cpu.set_irq(IRQ_APU, true, 0);
+    cpu.run(103);
+    ASSERT_EQ(cpu.get_pc(), 0x0300);
+
+    /* The IRQ is taken after the NOP following CLI, so that NOP's successor is the return address */
+    cpu.pull8();
+    ASSERT_EQ(cpu.pull16(), 0x0202);
+}
+
+TEST(Interrupts, IrqIgnoredWhileMasked)
+{
+    CPU cpu = CPU();
+    load_program_with_irq_handler(cpu, 0x0200, { 0xEA, 0xEA, 0xEA, 0xEA }, 0x0300);
+    cpu.set_cycles(100);
+
+    cpu.set_irq(IRQ_APU, true, 0);
+    cpu.run(108);
+    ASSERT_EQ(cpu.get_pc(), 0x0204);
+}
+
+TEST(Interrupts, TakenBranchDelaysNmi)
+{
+    /* Both instructions take 3 cycles; the NMI arrives during the last one */
+    CPU lda = CPU();
+    load_program_with_irq_handler(lda, 0x0200, { 0xA5, 0x00, 0xEA, 0xEA }, 0x0300); // LDA $00, NOP
+    lda.set_cycles(100);
+    lda.nmi(101);
+    lda.run(110);
+    lda.pull8();
+    ASSERT_EQ(lda.pull16(), 0x0202);
+
+    CPU branch = CPU();
+    load_program_with_irq_handler(branch, 0x0200, { 0xD0, 0x00, 0xEA, 0xEA }, 0x0300); // BNE +0, NOP
+    branch.set_cycles(100);
+    branch.set_p(0);
+    branch.nmi(101);
+    branch.run(110);
+    branch.pull8();
+    ASSERT_EQ(branch.pull16(), 0x0203);
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "../src/counters.h"
+#include "../src/debugger.h"
+#include "../src/nes.h"
+#include "../src/profiler.h"
+#include "fixtures.h"
+
+TEST(Debugger, WatchpointsSeeOnlyTheirAddress)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    unique_ptr<Debugger> debugger(new Debugger(*cpu));
+    vector<DebugEvent> events;
+    debugger->set_handler([&events](const DebugEvent& e) { events.push_back(e); });
+
+    load_program(*cpu, 0x0300, {
+        0xA9, 0x42,         // LDA #$42
+        0x8D, 0x10, 0x06,   // STA $0610
+        0x8D, 0x11, 0x06,   // STA $0611
+        0xAD, 0x10, 0x06,   // LDA $0610
+        0xAD, 0x11, 0x06    // LDA $0611
+    });
+    debugger->add_watchpoint(0x0610, WATCH_WRITE);
+    debugger->add_watchpoint(0x0611, WATCH_READ);
+
+    cpu->run(2 + 4 * 4);
+
+    ASSERT_EQ(events.size(), 2u);
+    ASSERT_EQ(events[0].kind, DEBUG_WATCH_WRITE);
+    ASSERT_EQ(events[0].addr, 0x0610);
+    ASSERT_EQ(events[0].val, 0x42);
+    ASSERT_EQ(events[0].pc, 0x0305);   // Past STA $0610
+    ASSERT_EQ(events[1].kind, DEBUG_WATCH_READ);
+    ASSERT_EQ(events[1].addr, 0x0611);
+    ASSERT_EQ(events[1].pc, 0x030E);
+
+    /* Stores through the watched page still land in memory */
+    ASSERT_EQ(cpu->get_mem8(0x0610), 0x42);
+    ASSERT_EQ(cpu->get_mem8(0x0611), 0x42);
+}
+
+TEST(Debugger, RemovingLastWatchpointRestoresDirectPage)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    unique_ptr<Debugger> debugger(new Debugger(*cpu));
+    uint8_t scratch[PAGE_SIZE];
+
+    debugger->add_watchpoint(0x0610);
+    debugger->add_watchpoint(0x0620);
+    ASSERT_EQ(cpu->read_page(0x06, scratch), scratch);
+
+    debugger->remove_watchpoint(0x0610);
+    ASSERT_EQ(cpu->read_page(0x06, scratch), scratch);
+
+    debugger->remove_watchpoint(0x0620);
+    ASSERT_EQ(cpu->read_page(0x06, scratch), cpu->get_memptr(0x0600));
+}
+
+TEST(Debugger, BreakpointFiresBeforeInstruction)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    unique_ptr<Debugger> debugger(new Debugger(*cpu));
+    vector<DebugEvent> events;
+    debugger->set_handler([&events, &cpu](const DebugEvent& e) {
+        events.push_back(e);
+        ASSERT_EQ(cpu->get_a(), 0x01); // The INX at the breakpoint has not run yet
+    });
+
+    load_program(*cpu, 0x0300, {
+        0xA9, 0x01,         // LDA #1
+        0xE8,               // INX
+        0x4C, 0x02, 0x03    // JMP $0302
+    });
+    debugger->add_breakpoint(0x0302);
+
+    cpu->run(2 + 3 * (2 + 3));
+
+    ASSERT_EQ(events.size(), 3u);
+    ASSERT_EQ(events[0].kind, DEBUG_BREAKPOINT);
+    ASSERT_EQ(events[0].addr, 0x0302);
+    ASSERT_EQ(events[0].cycle, 2u);
+    ASSERT_EQ(cpu->get_x(), 3);
+
+    debugger->remove_breakpoint(0x0302);
+    cpu->run(cpu->get_cycles() + 10);
+    ASSERT_EQ(events.size(), 3u);
+}
+
+TEST(Debugger, HandlerCanRemoveItsOwnBreakpoint)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    unique_ptr<Debugger> debugger(new Debugger(*cpu));
+    vector<DebugEvent> events;
+    debugger->set_handler([&events, &debugger](const DebugEvent& e) {
+        events.push_back(e);
+        debugger->remove_breakpoint(e.addr);
+    });
+
+    load_program(*cpu, 0x0300, {
+        0xE8,               // INX
+        0xE8,               // INX
+        0x4C, 0x00, 0x03    // JMP $0300
+    });
+    debugger->add_breakpoint(0x0301);
+
+    /* The rest of the run goes on without the hook, in the plain loop */
+    cpu->run(10 * (2 + 2 + 3));
+
+    ASSERT_EQ(events.size(), 1u);
+    ASSERT_EQ(events[0].addr, 0x0301);
+    ASSERT_EQ(cpu->get_x(), 20);
+}
+
+TEST(Debugger, HandlerCanDropCountersAndProfiler)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    unique_ptr<Debugger> debugger(new Debugger(*cpu));
+    ExecCounters counters;
+    Profiler profiler;
+    debugger->set_handler([&cpu](const DebugEvent&) {
+        cpu->set_counters(nullptr);
+        cpu->set_profiler(nullptr);
+    });
+
+    load_program(*cpu, 0x0300, {
+        0xE8,               // INX
+        0x86, 0x10,         // STX $10
+        0x4C, 0x00, 0x03    // JMP $0300
+    });
+    debugger->add_watchpoint(0x0010, WATCH_WRITE);
+    cpu->set_counters(&counters);
+    cpu->set_profiler(&profiler);
+
+    /* Dropped inside the first STX, in a loop with no exec hook; neither sees that STX end */
+    cpu->run(10 * (2 + 3 + 3));
+
+    ASSERT_EQ(cpu->get_x(), 10);
+    ASSERT_EQ(counters.get_total().count, 1u);
+}
+
+TEST(Debugger, SnapshotsIncludeWatchedPages)
+{
+    unique_ptr<NES> nes(new NES());
+    unique_ptr<Debugger> debugger(new Debugger(nes->get_cpu()));
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    CPU& cpu = nes->get_cpu();
+
+    debugger->add_watchpoint(0x0010);
+    cpu.set_mem8(0x0020, 0x5A);
+    nes->save_state(*snap);
+    cpu.set_mem8(0x0020, 0x00);
+    nes->load_state(*snap);
+
+    ASSERT_EQ(cpu.get_mem8(0x0020), 0x5A);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../src/nes.h"
+
+using namespace std;
+
+const char* const SMB_ROM_PATH = "rom/Super Mario Bros (E).nes";
+
+/* Super Mario Bros. on a fresh console, run headless for frames frames from power-on */
+inline unique_ptr<NES> boot_smb(unsigned frames = 0)
+{
+    unique_ptr<NES> nes(new NES());
+    ROM rom = ROM(SMB_ROM_PATH);
+    EXPECT_TRUE(nes->load(rom));
+
+    for (unsigned i = 0; i < frames; i++)
+        nes->emulate_frame(false, false);
+
+    return nes;
+}
+
+/* Copies program to addr and points the CPU at it */
+inline void load_program(CPU& cpu, uint16_t addr, const vector<uint8_t>& program)
+{
+    for (size_t i = 0; i < program.size(); i++)
+        cpu.set_mem8(addr + i, program[i]);
+    cpu.set_pc(addr);
+}
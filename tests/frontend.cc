@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/frontend.h"
+#include "../src/nes.h"
+#include "fixtures.h"
+
+TEST(Frontend, RendersStraightIntoSharedMemory)
+{
+    unique_ptr<NES> nes = boot_smb();
+    unique_ptr<FrontendServer> server(new FrontendServer());
+    ASSERT_TRUE(server->is_open());
+    FrontendClient client(dup(server->get_memory_fd()), dup(server->get_frame_fd()));
+    ASSERT_TRUE(client.is_open());
+    ASSERT_EQ(client.wait_frame(0), nullptr);
+
+    nes->set_frontend(server.get());
+    for (size_t i = 0; i < 40; i++)
+        nes->run_frame();
+
+    const SharedFrame* frame = client.wait_frame(0);
+    ASSERT_NE(frame, nullptr);
+    ASSERT_EQ(frame->frame, 39u);
+    ASSERT_EQ(memcmp(frame->pixels, nes->get_ppu().get_frame_buffer(), FRAME_PIXELS), 0);
+    ASSERT_EQ(client.wait_frame(0), nullptr);                   // Nothing newer yet
+    ASSERT_EQ(nes->get_output().acquire_frame(), nullptr);     // Nothing went to the FrameOutput
+
+    int16_t samples[MAX_SAMPLES_PER_FRAME];
+    ASSERT_GT(client.read_audio(samples, MAX_SAMPLES_PER_FRAME), 0u);
+
+    ASSERT_TRUE(client.set_buttons(0, BUTTON_START));
+    nes->run_frame();
+    ASSERT_EQ(nes->get_controllers().get_buttons(0), BUTTON_START);
+
+    nes->run_frame();
+    frame = client.wait_frame(0);
+    ASSERT_EQ(frame->frame, 41u);
+    ASSERT_EQ(memcmp(frame->pixels, nes->get_ppu().get_frame_buffer(), FRAME_PIXELS), 0);
+    nes->set_frontend(nullptr);
+}
+
+TEST(Frontend, GetsFramesFromThreadedRunAhead)
+{
+    unique_ptr<NES> nes = boot_smb();
+    unique_ptr<FrontendServer> server(new FrontendServer());
+    FrontendClient client(dup(server->get_memory_fd()), dup(server->get_frame_fd()));
+
+    /* Both orders: the second instance must follow the target set before and after it exists */
+    ASSERT_TRUE(nes->set_run_ahead(2, RUN_AHEAD_THREADED));
+    nes->set_frontend(server.get());
+    for (size_t i = 0; i < 20; i++)
+        nes->run_frame();
+    nes->sync_run_ahead();
+
+    const SharedFrame* frame = client.wait_frame(0);
+    ASSERT_NE(frame, nullptr);
+    ASSERT_GE(frame->frame, 20u);
+    ASSERT_EQ(nes->get_output().acquire_frame(), nullptr);
+
+    ASSERT_TRUE(nes->set_run_ahead(1, RUN_AHEAD_THREADED));
+    nes->run_frame();
+    nes->sync_run_ahead();
+    ASSERT_NE(client.wait_frame(0), nullptr);
+    ASSERT_EQ(nes->get_output().acquire_frame(), nullptr);
+
+    nes->set_frontend(nullptr);
+    nes->run_frame();
+    nes->sync_run_ahead();
+    ASSERT_NE(nes->get_output().acquire_frame(), nullptr);
+}
+
+TEST(Frontend, WakesAnotherProcess)
+{
+    unique_ptr<NES> nes = boot_smb();
+    FrontendServer server;
+    nes->set_frontend(&server);
+
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+
+    if (child == 0) {
+        FrontendClient client(dup(server.get_memory_fd()), dup(server.get_frame_fd()));
+        client.set_buttons(1, BUTTON_A);
+
+        /* Waits until it sees the third frame, or gives up after five seconds */
+        for (;;) {
+            const SharedFrame* frame = client.wait_frame(5000);
+            if (!frame)
+                _exit(1);
+            if (frame->frame >= 2)
+                _exit(0);
+        }
+    }
+
+    for (size_t i = 0; i < 3; i++)
+        nes->run_frame();
+
+    int status;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+
+    nes->run_frame();
+    ASSERT_EQ(nes->get_controllers().get_buttons(1), BUTTON_A);
+    nes->set_frontend(nullptr);
+}
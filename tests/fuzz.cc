@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../src/fuzz.h"
+#include "fixtures.h"
+
+TEST(Fuzz, RestoresOnlyDirtyPages)
+{
+    vector<uint8_t> coverage(COVERAGE_MAP_SIZE);
+    FuzzHarness harness(coverage.data());
+    const vector<uint8_t> stores = {
+        0xA9, 0x42,         // LDA #$42
+        0x8D, 0x00, 0x07,   // STA $0700
+        0x8D, 0x00, 0x30,   // STA $3000
+        0x4C, 0x08, 0x02    // JMP $0208
+    };
+    const vector<uint8_t> spin = {
+        0x4C, 0x00, 0x02    // JMP $0200
+    };
+    CPU& cpu = harness.get_cpu();
+
+    harness.run(stores.data(), stores.size());
+    ASSERT_EQ(cpu.read8(0x0700), 0x42);
+    ASSERT_EQ(cpu.read8(0x3000), 0x42);
+    ASSERT_EQ(harness.get_dirty_count(), 3u);     // Code, $07xx and $30xx
+
+    harness.run(spin.data(), spin.size());
+    ASSERT_EQ(cpu.read8(0x0700), 0x00);
+    ASSERT_EQ(cpu.read8(0x3000), 0x00);
+    ASSERT_EQ(cpu.read8(0x0208), 0x00);
+    ASSERT_EQ(cpu.get_a(), 0x00);
+    ASSERT_EQ(harness.get_dirty_count(), 1u);
+    ASSERT_EQ(harness.get_stats().pages_restored, 3u);
+}
+
+TEST(Fuzz, CoverageFollowsBranches)
+{
+    vector<uint8_t> coverage(COVERAGE_MAP_SIZE);
+    FuzzHarness harness(coverage.data());
+    vector<uint8_t> code = {
+        0xA9, 0x00,         // LDA #$00, patched below
+        0xF0, 0x02,         // BEQ +2
+        0xA2, 0x01,         // LDX #$01
+        0x4C, 0x06, 0x02    // JMP $0206
+    };
+
+    harness.run(code.data(), code.size());
+    vector<uint8_t> taken = coverage;
+
+    fill(coverage.begin(), coverage.end(), 0);
+    harness.run(code.data(), code.size());
+    ASSERT_EQ(coverage, taken);
+
+    code[1] = 0x01;
+    fill(coverage.begin(), coverage.end(), 0);
+    harness.run(code.data(), code.size());
+    ASSERT_NE(coverage, taken);
+    ASSERT_EQ(harness.get_cpu().get_x(), 0x01);
+}
+
+TEST(Fuzz, ReplaysControllerInputExactly)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    vector<uint8_t> coverage(COVERAGE_MAP_SIZE);
+    FuzzHarness harness(rom, 30, coverage.data());
+    vector<uint8_t> input(20, 0);
+    input[5] = BUTTON_START;
+    input[12] = BUTTON_A | BUTTON_RIGHT;
+
+    uint64_t start = harness.get_nes()->hash_state();
+    harness.run(input.data(), input.size());
+    uint64_t first = harness.get_nes()->hash_state();
+    size_t dirty = harness.get_dirty_count();
+
+    harness.run(nullptr, 0);
+    ASSERT_EQ(harness.get_nes()->hash_state(), start);
+
+    harness.run(input.data(), input.size());
+    ASSERT_EQ(harness.get_nes()->hash_state(), first);
+    ASSERT_NE(first, start);
+    ASSERT_GT(dirty, 0u);
+    ASSERT_LT(dirty, 32u);
+}
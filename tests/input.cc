@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <memory>
+
+#include "../src/nes.h"
+
+TEST(Controllers, ShiftRegisterReadsButtonsInOrder)
+{
+    Controllers pads;
+    pads.push(0, BUTTON_A | BUTTON_START | BUTTON_RIGHT, 0);
+
+    pads.write_strobe(1, 10);
+    pads.write_strobe(0, 11);
+
+    const uint8_t expected[8] = { 1, 0, 0, 1, 0, 0, 0, 1 };
+    for (size_t i = 0; i < 8; i++)
+        ASSERT_EQ(pads.read(0, 12 + i), JOYPAD_OPEN_BUS | expected[i]);
+
+    ASSERT_EQ(pads.read(0, 20), JOYPAD_OPEN_BUS | 1); // Past the eighth bit
+    ASSERT_EQ(pads.read(1, 21), JOYPAD_OPEN_BUS);     // Nothing pressed on port 2
+}
+
+TEST(Controllers, EventsApplyAtTheirCycle)
+{
+    Controllers pads;
+    pads.push(0, BUTTON_A, 100);
+    pads.push(0, 0, 200);
+
+    pads.write_strobe(1, 50);
+    ASSERT_EQ(pads.read(0, 99), JOYPAD_OPEN_BUS);      // Strobe high: live A button
+    ASSERT_EQ(pads.read(0, 100), JOYPAD_OPEN_BUS | 1);
+    ASSERT_EQ(pads.read(0, 199), JOYPAD_OPEN_BUS | 1);
+    ASSERT_EQ(pads.read(0, 200), JOYPAD_OPEN_BUS);
+
+    InputStats stats = pads.get_stats();
+    ASSERT_EQ(stats.events_applied, 2u);
+    ASSERT_EQ(stats.latency_samples, 2u);
+    ASSERT_EQ(stats.max_latency, 0u);
+}
+
+TEST(Controllers, FullQueueDropsEvents)
+{
+    Controllers pads;
+    size_t accepted = 0;
+    for (size_t i = 0; i < 2 * INPUT_QUEUE_SIZE; i++)
+        accepted += pads.push(0, i, i);
+
+    ASSERT_LT(accepted, 2 * INPUT_QUEUE_SIZE);
+    ASSERT_EQ(pads.get_stats().events_dropped, 2 * INPUT_QUEUE_SIZE - accepted);
+}
+
+/* A game loop polling port 1 sees each event within about one poll period, not one frame */
+TEST(Controllers, InputLatencyInEmulatedCycles)
+{
+    unique_ptr<NES> nes(new NES());
+    CPU& cpu = nes->get_cpu();
+
+    const vector<uint8_t> program = {
+        0xA9, 0x01,         // LDA #1           2 cycles
+        0x8D, 0x16, 0x40,   // STA $4016        4
+        0xA9, 0x00,         // LDA #0           2
+        0x8D, 0x16, 0x40,   // STA $4016        4
+        0xAD, 0x16, 0x40,   // LDA $4016        4
+        0x85, 0x10,         // STA $10          3
+        0x4C, 0x00, 0x03    // JMP $0300        3
+    };
+    const uint64_t poll_period = 22;
+    for (size_t i = 0; i < program.size(); i++)
+        cpu.set_mem8(0x0300 + i, program[i]);
+    cpu.set_pc(0x0300);
+
+    Controllers& pads = nes->get_controllers();
+    const uint64_t stamps[] = { 1000, 5003, 12345, 20011, 28000, 40007, 51234 };
+    const size_t num_events = sizeof(stamps) / sizeof(stamps[0]);
+    for (size_t i = 0; i < num_events; i++)
+        pads.push(0, i % 2 == 0 ? BUTTON_A : 0, stamps[i]);
+
+    nes->run_frame();
+    nes->run_frame();
+
+    InputStats stats = pads.get_stats();
+    ASSERT_EQ(stats.events_applied, num_events);
+    ASSERT_EQ(stats.latency_samples, num_events);
+    ASSERT_LT(stats.max_latency, 2 * poll_period);
+    ASSERT_EQ(cpu.get_mem8(0x10) & 1, 1);   // Last event pressed A
+
+    cout << dec << "input latency: mean " << stats.total_latency / stats.latency_samples
+         << " max " << stats.max_latency << " cycles" << endl;
+    RecordProperty("max_latency_cycles", (int)stats.max_latency);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "../src/libnes.h"
+
+using namespace std;
+
+static const char* SMB = "rom/Super Mario Bros (E).nes";
+
+TEST(LibNES, RunsFramesWithScriptedInput)
+{
+    ASSERT_EQ(nes_abi_version(), (uint32_t) NES_ABI_VERSION);
+    ASSERT_EQ(nes_create("rom/missing.nes"), nullptr);
+
+    nes_t* a = nes_create(SMB);
+    nes_t* b = nes_create_from(a);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+
+    /* One call per batch of frames, buttons included, gives the same as one call per frame */
+    vector<uint8_t> buttons(20 * NES_NUM_PORTS);
+    for (size_t i = 0; i < buttons.size(); i++)
+        buttons[i] = (uint8_t) (i * 7);
+
+    ASSERT_EQ(nes_run_frames(a, 20, buttons.data(), NES_RUN_NO_AUDIO), NES_OK);
+    for (size_t f = 0; f < 20; f++)
+        ASSERT_EQ(nes_run_frames(b, 1, &buttons[f * NES_NUM_PORTS], NES_RUN_NO_AUDIO), NES_OK);
+
+    nes_regs_t ra, rb;
+    ASSERT_EQ(nes_get_regs(a, &ra), NES_OK);
+    ASSERT_EQ(nes_get_regs(b, &rb), NES_OK);
+    ASSERT_EQ(ra.pc, rb.pc);
+    ASSERT_EQ(ra.cycles, rb.cycles);
+    ASSERT_EQ(memcmp(nes_frame_buffer(a), nes_frame_buffer(b), NES_FRAME_WIDTH * NES_FRAME_HEIGHT), 0);
+
+    nes_destroy(a);
+    nes_destroy(b);
+    ASSERT_EQ(nes_run_frames(nullptr, 1, nullptr, 0), NES_ERROR_ARGUMENT);
+}
+
+TEST(LibNES, ReadsAndWritesRanges)
+{
+    nes_t* nes = nes_create(SMB);
+    vector<uint8_t> data(0x300);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (uint8_t) i;
+
+    /* Straddles pages; ROM ignores writes, I/O reads as 0 */
+    ASSERT_EQ(nes_write_memory(nes, 0x0180, data.data(), data.size()), NES_OK);
+    vector<uint8_t> back(data.size());
+    ASSERT_EQ(nes_read_memory(nes, 0x0180, back.data(), back.size()), NES_OK);
+    ASSERT_EQ(back, data);
+
+    uint8_t rom[4], io[4];
+    ASSERT_EQ(nes_read_memory(nes, 0xFFFC, rom, 4), NES_OK);
+    ASSERT_EQ(nes_write_memory(nes, 0xFFFC, data.data(), 4), NES_OK);
+    ASSERT_EQ(nes_read_memory(nes, 0xFFFC, io, 4), NES_OK);
+    ASSERT_EQ(memcmp(rom, io, 4), 0);
+    ASSERT_EQ(nes_read_memory(nes, 0x2000, io, 4), NES_OK);
+    ASSERT_EQ(io[0] | io[1] | io[2] | io[3], 0);
+
+    ASSERT_EQ(nes_read_memory(nes, 0xFFFF, rom, 2), NES_ERROR_ARGUMENT);
+    nes_destroy(nes);
+}
+
+TEST(LibNES, SavesStatesIntoCallerMemory)
+{
+    nes_t* nes = nes_create(SMB);
+    vector<uint64_t> state((nes_state_size() + 7) / 8);
+    size_t size = state.size() * 8;
+
+    ASSERT_EQ(nes_run_frames(nes, 10, nullptr, 0), NES_OK);
+    ASSERT_EQ(nes_save_state(nes, state.data(), size), NES_OK);
+
+    uint8_t ram[0x800], later[0x800];
+    nes_read_memory(nes, 0, ram, sizeof(ram));
+    nes_run_frames(nes, 10, nullptr, NES_RUN_NO_VIDEO | NES_RUN_NO_AUDIO);
+    ASSERT_EQ(nes_load_state(nes, state.data(), size), NES_OK);
+    nes_read_memory(nes, 0, later, sizeof(later));
+    ASSERT_EQ(memcmp(ram, later, sizeof(ram)), 0);
+
+    ASSERT_EQ(nes_save_state(nes, state.data(), size - 1), NES_ERROR_STATE);
+    ASSERT_EQ(nes_save_state(nes, (uint8_t*) state.data() + 1, size - 8), NES_ERROR_STATE);
+    ((uint8_t*) state.data())[0] ^= 1;
+    ASSERT_EQ(nes_load_state(nes, state.data(), size), NES_ERROR_STATE);
+    ASSERT_STREQ(nes_status_string(NES_ERROR_STATE), "invalid state buffer");
+    nes_destroy(nes);
+}
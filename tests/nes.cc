@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "../src/nes.h"
+#include "fixtures.h"
+
+TEST(NES, LoadMapsPrgRom)
+{
+    unique_ptr<NES> nes(new NES());
+    ROM rom = ROM(SMB_ROM_PATH);
+    ASSERT_TRUE(nes->load(rom));
+
+    CPU& cpu = nes->get_cpu();
+    ASSERT_EQ(cpu.read8(0x8000), rom.get_prg_rom()[0]);
+    ASSERT_EQ(cpu.read8(0xFFFC), rom.get_prg_rom()[0x7FFC]);
+
+    cpu.write8(0x8000, ~rom.get_prg_rom()[0]); // PRG ROM is read-only
+    ASSERT_EQ(cpu.read8(0x8000), rom.get_prg_rom()[0]);
+}
+
+TEST(NES, RunFrameAdvancesOneFrame)
+{
+    unique_ptr<NES> nes = boot_smb();
+
+    nes->get_cpu().set_pc(nes->get_cpu().get_mem16(0xFFFC));
+    nes->run_frame();
+    nes->run_frame();
+
+    ASSERT_EQ(nes->get_ppu().get_frame(), 2u);
+    ASSERT_GE(nes->get_cpu().get_cycles(), 2 * DOTS_PER_FRAME / DOTS_PER_CPU_CYCLE);
+    ASSERT_LT(nes->get_cpu().get_cycles(), 2 * DOTS_PER_FRAME / DOTS_PER_CPU_CYCLE + 8);
+}
+
+TEST(NES, OamDmaCopiesPageAndStalls)
+{
+    unique_ptr<NES> nes(new NES());
+    CPU& cpu = nes->get_cpu();
+
+    for (size_t i = 0; i < OAM_SIZE; i++)
+        cpu.write8(0x0200 + i, i ^ 0x5A);
+
+    cpu.write8(0x2003, 0x10); // OAMADDR: the copy wraps around
+    cpu.set_cycles(100);
+    cpu.write8(OAM_DMA_REG, 0x02);
+
+    ASSERT_EQ(cpu.get_cycles(), 100 + OAM_DMA_CYCLES);
+    const PPUState& s = nes->get_ppu().get_state();
+    for (size_t i = 0; i < OAM_SIZE; i++)
+        ASSERT_EQ(s.oam[(0x10 + i) & 0xFF], i ^ 0x5A);
+
+    cpu.set_cycles(101);
+    cpu.write8(OAM_DMA_REG, 0x02);
+    ASSERT_EQ(cpu.get_cycles(), 101 + OAM_DMA_CYCLES + 1);
+}
+
+TEST(NES, OamDmaFromIoPageReadsThroughBus)
+{
+    unique_ptr<NES> nes(new NES());
+    CPU& cpu = nes->get_cpu();
+
+    cpu.write8(OAM_DMA_REG, 0x40); // APU page: every byte goes through NES::io_read
+    const PPUState& s = nes->get_ppu().get_state();
+    ASSERT_EQ(s.oam[0x00], 0x40);  // Open bus
+    ASSERT_EQ(s.oam[0x15], 0x00);  // APU status, nothing playing
+}
+
+/* Without a cartridge every page is RAM, so tests can supply their own program and vectors */
+static void load_ram_program(CPU& cpu, uint16_t addr, const vector<uint8_t>& program)
+{
+    for (size_t i = 0; i < program.size(); i++)
+        cpu.set_mem8(addr + i, program[i]);
+}
+
+static void set_vector(CPU& cpu, uint16_t vector, uint16_t addr)
+{
+    cpu.set_mem8(vector, addr & 0xFF);
+    cpu.set_mem8(vector + 1, addr >> 8);
+}
+
+TEST(NES, NmiFiresEveryVblank)
+{
+    unique_ptr<NES> nes(new NES());
+    CPU& cpu = nes->get_cpu();
+
+    load_ram_program(cpu, 0x0300, { 0x4C, 0x00, 0x03 });        // JMP $0300
+    load_ram_program(cpu, 0x0400, { 0xE6, 0x10, 0x40 });        // INC $10, RTI
+    set_vector(cpu, NMI_VECTOR, 0x0400);
+    cpu.set_pc(0x0300);
+    cpu.write8(0x2000, CTRL_NMI);
+
+    for (size_t i = 0; i < 3; i++)
+        nes->run_frame();
+
+    ASSERT_EQ(cpu.get_mem8(0x10), 3);
+}
+
+TEST(NES, ApuFrameIrqReachesCpu)
+{
+    unique_ptr<NES> nes(new NES());
+    CPU& cpu = nes->get_cpu();
+
+    load_ram_program(cpu, 0x0300, { 0x58, 0x4C, 0x01, 0x03 });  // CLI, JMP $0301
+    load_ram_program(cpu, 0x0500, { 0xAD, 0x15, 0x40,           // LDA $4015 (acknowledge)
+                                    0xE6, 0x11, 0x40 });        // INC $11, RTI
+    set_vector(cpu, IRQ_VECTOR, 0x0500);
+    cpu.set_pc(0x0300);
+    cpu.write8(APU_FRAME_COUNTER, 0x00);
+
+    for (size_t i = 0; i < 4; i++)
+        nes->run_frame();
+
+    /* One IRQ per 29830-cycle sequence, each acknowledged */
+    uint64_t expected = cpu.get_cycles() / FRAME_SEQUENCE_CYCLES[0];
+    ASSERT_EQ(cpu.get_mem8(0x11), expected);
+    ASSERT_EQ(cpu.get_irq_lines(), 0);
+}
+
+TEST(NES, LoadStateReplaysIdentically)
+{
+    unique_ptr<NES> nes = boot_smb();
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+
+    for (size_t i = 0; i < 30; i++)
+        nes->run_frame();
+
+    nes->save_state(*snap);
+    for (size_t i = 0; i < 20; i++)
+        nes->run_frame();
+
+    uint64_t cycles = nes->get_cpu().get_cycles();
+    vector<uint8_t> ram(nes->get_cpu().get_ram(), nes->get_cpu().get_ram() + RAM_SIZE);
+
+    nes->load_state(*snap);
+    ASSERT_EQ(nes->get_ppu().get_frame(), 30u);
+    for (size_t i = 0; i < 20; i++)
+        nes->run_frame();
+
+    ASSERT_EQ(nes->get_cpu().get_cycles(), cycles);
+    ASSERT_EQ(vector<uint8_t>(nes->get_cpu().get_ram(), nes->get_cpu().get_ram() + RAM_SIZE), ram);
+}
+
+/* Run-ahead must show the future frame while playing, and keeping, the real timeline */
+static void check_run_ahead(RunAheadMode mode)
+{
+    const unsigned ahead = 2;
+    const size_t frames = 40;
+    unique_ptr<NES> plain = boot_smb();
+    unique_ptr<NES> nes = boot_smb();
+    ASSERT_TRUE(nes->set_run_ahead(ahead, mode));
+
+    vector<int16_t> plain_audio, audio;
+    int16_t block[MAX_SAMPLES_PER_FRAME];
+
+    for (size_t i = 0; i < frames; i++) {
+        plain->run_frame();
+        nes->run_frame();
+        nes->sync_run_ahead();
+
+        size_t count = plain->get_output().read_audio(block, MAX_SAMPLES_PER_FRAME);
+        plain_audio.insert(plain_audio.end(), block, block + count);
+        count = nes->get_output().read_audio(block, MAX_SAMPLES_PER_FRAME);
+        audio.insert(audio.end(), block, block + count);
+    }
+
+    ASSERT_EQ(nes->get_cpu().get_cycles(), plain->get_cpu().get_cycles());
+    ASSERT_EQ(nes->get_ppu().get_frame(), frames);
+    ASSERT_EQ(audio, plain_audio);
+
+    const VideoFrame* shown = nes->get_output().acquire_frame();
+    ASSERT_NE(shown, nullptr);
+    ASSERT_EQ(shown->frame, frames - 1 + ahead);
+
+    for (unsigned i = 0; i < ahead; i++)
+        plain->run_frame();
+
+    const VideoFrame* future = plain->get_output().acquire_frame();
+    ASSERT_EQ(future->frame, shown->frame);
+    ASSERT_EQ(memcmp(future->pixels, shown->pixels, FRAME_PIXELS), 0);
+}
+
+TEST(NES, RunAheadShowsFutureFrame)
+{
+    check_run_ahead(RUN_AHEAD_INLINE);
+}
+
+TEST(NES, ThreadedRunAheadShowsFutureFrame)
+{
+    check_run_ahead(RUN_AHEAD_THREADED);
+}
+
+TEST(NES, RunAheadLimit)
+{
+    unique_ptr<NES> nes(new NES());
+    ASSERT_FALSE(nes->set_run_ahead(MAX_RUN_AHEAD_FRAMES + 1));
+    ASSERT_TRUE(nes->set_run_ahead(MAX_RUN_AHEAD_FRAMES));
+    ASSERT_TRUE(nes->set_run_ahead(0));
+    ASSERT_EQ(nes->get_run_ahead_frames(), 0u);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+
+#include "../src/netplay.h"
+#include "fixtures.h"
+
+TEST(Transport, LoopbackDeliversInOrder)
+{
+    LoopbackTransport a, b;
+    LoopbackTransport::connect(a, b);
+
+    for (uint8_t i = 0; i < 10; i++)
+        ASSERT_TRUE(a.send(&i, 1));
+
+    uint8_t data[MAX_DATAGRAM_SIZE];
+    for (uint8_t i = 0; i < 10; i++) {
+        ASSERT_EQ(b.receive(data, sizeof(data)), 1u);
+        ASSERT_EQ(data[0], i);
+    }
+    ASSERT_EQ(b.receive(data, sizeof(data)), 0u);
+}
+
+TEST(Transport, ConditionsDelayAndDrop)
+{
+    LoopbackTransport a, b;
+    LoopbackTransport::connect(a, b);
+    uint8_t data[MAX_DATAGRAM_SIZE] = {};
+
+    a.set_conditions(0, 0.25, 7);
+    for (size_t i = 0; i < 1000; i++)
+        a.send(data, 1);
+
+    size_t received = 0;
+    while (b.receive(data, sizeof(data)))
+        received++;
+
+    ASSERT_EQ(received + a.get_dropped(), 1000u);
+    ASSERT_GT(a.get_dropped(), 200u);
+    ASSERT_LT(a.get_dropped(), 300u);
+
+    a.set_conditions(20, 0.0);
+    a.send(data, 1);
+    ASSERT_EQ(b.receive(data, sizeof(data)), 0u);
+    this_thread::sleep_for(chrono::milliseconds(25));
+    ASSERT_EQ(b.receive(data, sizeof(data)), 0u); // Only the sender's calls flush its queue
+    a.send(data, 1);
+    ASSERT_EQ(b.receive(data, sizeof(data)), 1u);
+}
+
+/* Scripted players: both change buttons often early on, then hold still for the last frames */
+static const uint32_t SESSION_FRAMES = 180;
+
+static uint8_t script(uint8_t port, uint32_t frame)
+{
+    if (frame >= SESSION_FRAMES - 30)
+        return 0;
+
+    if (port == 1)
+        return frame / 5;
+
+    return (frame / 7) % 3 == 0 ? BUTTON_START : BUTTON_RIGHT;
+}
+
+static void play_session(Transport& ta, Transport& tb)
+{
+    unique_ptr<NES> a = boot_smb(), b = boot_smb(), reference = boot_smb();
+    RollbackSession sa(*a, ta, 0), sb(*b, tb, 1);
+
+    while (sa.get_frame() < SESSION_FRAMES || sb.get_frame() < SESSION_FRAMES) {
+        if (sa.get_frame() < SESSION_FRAMES)
+            sa.advance_frame(script(0, sa.get_frame()));
+        else
+            sa.poll();
+
+        if (sb.get_frame() < SESSION_FRAMES)
+            sb.advance_frame(script(1, sb.get_frame()));
+        else
+            sb.poll();
+    }
+
+    for (uint32_t f = 0; f < SESSION_FRAMES; f++) {
+        reference->get_controllers().set_buttons(0, script(0, f));
+        reference->get_controllers().set_buttons(1, script(1, f));
+        reference->emulate_frame(false, false);
+    }
+
+    /* Both sides end up where a single console fed both players' real input does */
+    for (NES* nes : { a.get(), b.get() }) {
+        ASSERT_EQ(nes->get_cpu().get_cycles(), reference->get_cpu().get_cycles());
+        ASSERT_EQ(memcmp(nes->get_cpu().get_ram(), reference->get_cpu().get_ram(), RAM_SIZE), 0);
+    }
+
+    SessionStats stats[2] = { sa.get_stats(), sb.get_stats() };
+    for (const SessionStats& s : stats) {
+        ASSERT_EQ(s.frames, SESSION_FRAMES);
+        ASSERT_LE(s.max_rollback_depth, MAX_ROLLBACK_FRAMES + 1);
+        if (s.rollbacks) {
+            ASSERT_GT(s.max_resim_ns, 0u);
+            EXPECT_GE(s.max_rollback_depth, 1u);
+            EXPECT_GE(s.frames_resimulated, s.rollbacks);
+            EXPECT_LE(s.frames_resimulated, s.rollbacks * s.max_rollback_depth);
+        }
+    }
+    ASSERT_GT(stats[0].rollbacks + stats[1].rollbacks, 0u);
+}
+
+TEST(RollbackSession, LoopbackWithDelayAndLossMatchesReference)
+{
+    LoopbackTransport ta, tb;
+    LoopbackTransport::connect(ta, tb);
+    ta.set_conditions(3, 0.2, 1);
+    tb.set_conditions(3, 0.2, 2);
+
+    play_session(ta, tb);
+}
+
+TEST(RollbackSession, UdpWithDelayAndLossMatchesReference)
+{
+    UdpTransport ta, tb;
+    if (!ta.is_open() || !tb.is_open())
+        GTEST_SKIP();
+
+    ta.connect(tb.get_local_port());
+    tb.connect(ta.get_local_port());
+    ta.set_conditions(2, 0.1, 3);
+    tb.set_conditions(2, 0.1, 4);
+
+    play_session(ta, tb);
+}
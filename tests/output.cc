@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/nes.h"
+#include "../src/output.h"
+
+TEST(Output, TripleBufferKeepsNewest)
+{
+    TripleBuffer<int> buffer;
+    ASSERT_FALSE(buffer.acquire());
+
+    buffer.get_back() = 1;
+    ASSERT_TRUE(buffer.publish());
+    buffer.get_back() = 2;
+    ASSERT_FALSE(buffer.publish()); // 1 was never picked up
+
+    ASSERT_TRUE(buffer.acquire());
+    ASSERT_EQ(buffer.get_front(), 2);
+    ASSERT_FALSE(buffer.acquire());
+    ASSERT_EQ(buffer.get_front(), 2);
+}
+
+TEST(Output, FrameStats)
+{
+    unique_ptr<FrameOutput> output(new FrameOutput());
+    vector<uint8_t> pixels(FRAME_PIXELS, 0x0F);
+    ASSERT_EQ(output->acquire_frame(), nullptr);
+
+    output->publish_frame(pixels.data(), 0);
+    output->publish_frame(pixels.data(), 1);
+    ASSERT_EQ(output->acquire_frame()->frame, 1u);
+    ASSERT_EQ(output->acquire_frame()->frame, 1u);
+
+    OutputStats stats = output->get_stats();
+    ASSERT_EQ(stats.frames_published, 2u);
+    ASSERT_EQ(stats.frames_dropped, 1u);
+    ASSERT_EQ(stats.frames_presented, 1u);
+    ASSERT_EQ(stats.frames_duplicated, 1u);
+}
+
+TEST(Output, AudioRingWrapsAndCountsOverruns)
+{
+    FrameOutput output(8);
+    int16_t in[6] = { 1, 2, 3, 4, 5, 6 };
+    int16_t out[8] = { 0 };
+
+    output.write_audio(in, 6);
+    ASSERT_EQ(output.read_audio(out, 4), 4u);
+    output.write_audio(in, 6);  // Wraps round the end of the ring
+    ASSERT_EQ(output.get_stats().audio_depth, 8u);
+    ASSERT_EQ(output.read_audio(out, 8), 8u);
+    ASSERT_EQ(out[0], 5);
+    ASSERT_EQ(out[2], 1);
+    ASSERT_EQ(out[7], 6);
+
+    output.write_audio(in, 6);
+    output.write_audio(in, 6);
+    ASSERT_EQ(output.read_audio(out, 8), 8u);
+    ASSERT_EQ(output.read_audio(out, 8), 0u);
+
+    OutputStats stats = output.get_stats();
+    ASSERT_EQ(stats.samples_dropped, 4u);
+    ASSERT_EQ(stats.audio_underruns, 1u);
+    ASSERT_EQ(stats.audio_max_depth, 8u);
+}
+
+TEST(Output, ConcurrentPresenterSeesOrderedFrames)
+{
+    unique_ptr<FrameOutput> output(new FrameOutput());
+    vector<uint8_t> pixels(FRAME_PIXELS);
+    const uint64_t frames = 500;
+    bool ordered = true;
+
+    thread presenter([&] {
+        uint64_t last = 0;
+        bool seen = false;
+
+        while (!seen || last + 1 < frames) {
+            const VideoFrame* frame = output->acquire_frame();
+
+            if (!frame)
+                continue;
+
+            if (seen && frame->frame < last)
+                ordered = false;
+
+            if (frame->pixels[0] != (uint8_t) frame->frame || frame->pixels[FRAME_PIXELS - 1] != (uint8_t) frame->frame)
+                ordered = false;
+
+            last = frame->frame;
+            seen = true;
+        }
+    });
+
+    for (uint64_t i = 0; i < frames; i++) {
+        pixels[0] = pixels[FRAME_PIXELS - 1] = (uint8_t) i;
+        output->publish_frame(pixels.data(), i);
+    }
+
+    presenter.join();
+    ASSERT_TRUE(ordered);
+
+    OutputStats stats = output->get_stats();
+    ASSERT_EQ(stats.frames_published, frames);
+    ASSERT_EQ(stats.frames_presented + stats.frames_dropped, frames);
+}
+
+TEST(Output, NESPublishesFrames)
+{
+    unique_ptr<NES> nes(new NES());
+    nes->run_frame();
+    nes->run_frame();
+
+    const VideoFrame* frame = nes->get_output().acquire_frame();
+    ASSERT_NE(frame, nullptr);
+    ASSERT_EQ(frame->frame, 1u);
+    ASSERT_EQ(nes->get_output().get_stats().frames_published, 2u);
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "../src/cpu.h"
+#include "../src/ppu.h"
+
+const uint16_t PPUCTRL_ADDR     = 0x2000;
+const uint16_t PPUMASK_ADDR     = 0x2001;
+const uint16_t PPUSTATUS_ADDR   = 0x2002;
+const uint16_t OAMADDR_ADDR     = 0x2003;
+const uint16_t OAMDATA_ADDR     = 0x2004;
+const uint16_t PPUSCROLL_ADDR   = 0x2005;
+const uint16_t PPUADDR_ADDR     = 0x2006;
+const uint16_t PPUDATA_ADDR     = 0x2007;
+
+struct PPUBench {
+    CPU cpu;
+    PPU ppu;
+
+    PPUBench() :
+        ppu(cpu)
+    {
+        cpu.map_io(0x20, 0x3F, &ppu);
+    }
+
+    /* Moves the clock to a dot within the current frame */
+    void set_dot(uint32_t dot)
+    {
+        cpu.set_cycles((ppu.get_frame() * DOTS_PER_FRAME + dot) / DOTS_PER_CPU_CYCLE);
+    }
+
+    void write_vram(uint16_t addr, uint8_t val)
+    {
+        cpu.write8(PPUADDR_ADDR, addr >> 8);
+        cpu.write8(PPUADDR_ADDR, addr & 0xFF);
+        cpu.write8(PPUDATA_ADDR, val);
+    }
+
+    /* CHR RAM tile 1 is solid color 1, tile 2 has its left half in color 3; sprite 0 sits on row 32 */
+    void setup_scene()
+    {
+        for (uint16_t row = 0; row < 8; row++) {
+            write_vram(0x0010 + row, 0xFF);
+            write_vram(0x0020 + row, 0xF0);
+            write_vram(0x0028 + row, 0xF0);
+        }
+
+        for (uint16_t i = 0; i < 0x3C0; i++)
+            write_vram(0x2000 + i, (i % 3) ? 1 : 0);
+
+        for (uint16_t i = 0; i < 0x20; i++) {
+            if (i < 0x10 || (i & 0x03))
+                write_vram(0x3F00 + i, 0x01 + i);
+        }
+
+        const uint8_t sprite0[] = { 31, 2, 0x00, 40 };
+        cpu.write8(OAMADDR_ADDR, 0);
+
+        for (uint8_t b : sprite0)
+            cpu.write8(OAMDATA_ADDR, b);
+
+        cpu.write8(PPUSCROLL_ADDR, 0);
+        cpu.write8(PPUSCROLL_ADDR, 0);
+        cpu.write8(PPUCTRL_ADDR, 0x00);
+        cpu.write8(PPUMASK_ADDR, MASK_BG | MASK_SPRITES | MASK_BG_LEFT | MASK_SPRITES_LEFT);
+    }
+};
+
+TEST(PPU, DataReadsAreBuffered)
+{
+    unique_ptr<PPUBench> b(new PPUBench());
+    b->write_vram(0x2005, 0xAB);
+    b->write_vram(0x2006, 0xCD);
+    b->cpu.write8(PPUADDR_ADDR, 0x20);
+    b->cpu.write8(PPUADDR_ADDR, 0x05);
+    b->cpu.read8(PPUDATA_ADDR); // Primes the buffer
+    ASSERT_EQ(b->cpu.read8(PPUDATA_ADDR), 0xAB);
+    ASSERT_EQ(b->cpu.read8(PPUDATA_ADDR), 0xCD);
+}
+
+TEST(PPU, PaletteMirrors)
+{
+    unique_ptr<PPUBench> b(new PPUBench());
+    b->write_vram(0x3F10, 0x2A);
+    ASSERT_EQ(b->ppu.read_vram(0x3F00), 0x2A);
+    b->write_vram(0x3F04, 0x11);
+    ASSERT_EQ(b->ppu.read_vram(0x3F24), 0x11);
+}
+
+TEST(PPU, VblankPredictedFromTiming)
+{
+    unique_ptr<PPUBench> b(new PPUBench());
+    b->ppu.begin_frame();
+    b->set_dot(VBLANK_DOT - DOTS_PER_CPU_CYCLE);
+    ASSERT_EQ(b->cpu.read8(PPUSTATUS_ADDR) & STATUS_VBLANK, 0);
+    b->set_dot(VBLANK_DOT + DOTS_PER_CPU_CYCLE);
+    ASSERT_EQ(b->cpu.read8(PPUSTATUS_ADDR) & STATUS_VBLANK, STATUS_VBLANK);
+    ASSERT_EQ(b->cpu.read8(PPUSTATUS_ADDR) & STATUS_VBLANK, 0); // Cleared by the first read
+    b->ppu.end_frame();
+}
+
+TEST(PPU, Sprite0HitPredicted)
+{
+    unique_ptr<PPUBench> b(new PPUBench());
+    b->setup_scene();
+    b->ppu.finish_frame();
+    b->ppu.begin_frame();
+
+    /* Sprite 0 is drawn from line 32; column 40 is over an opaque background tile */
+    uint32_t hit = (32 + 1) * DOTS_PER_LINE + 40 + 1;
+    b->set_dot(hit - 2 * DOTS_PER_LINE);
+    ASSERT_EQ(b->cpu.read8(PPUSTATUS_ADDR) & STATUS_SPRITE0_HIT, 0);
+    b->set_dot(hit + DOTS_PER_CPU_CYCLE);
+    ASSERT_EQ(b->cpu.read8(PPUSTATUS_ADDR) & STATUS_SPRITE0_HIT, STATUS_SPRITE0_HIT);
+    b->ppu.end_frame();
+}
+
+static void run_scene(PPUBench& b)
+{
+    b.setup_scene();
+    b.ppu.finish_frame();
+
+    for (int frame = 0; frame < 3; frame++) {
+        b.ppu.begin_frame();
+        b.set_dot(120 * DOTS_PER_LINE);
+        b.cpu.write8(PPUSCROLL_ADDR, 13 * (frame + 1));
+        b.cpu.write8(PPUSCROLL_ADDR, 0);
+        b.set_dot(VBLANK_DOT);
+        b.ppu.end_frame();
+        b.ppu.finish_frame();
+    }
+}
+
+TEST(PPU, ThreadedMatchesInline)
+{
+    unique_ptr<PPUBench> inline_bench(new PPUBench());
+    unique_ptr<PPUBench> threaded_bench(new PPUBench());
+    threaded_bench->ppu.set_render_mode(RENDER_THREADED);
+
+    run_scene(*inline_bench);
+    run_scene(*threaded_bench);
+
+    const uint8_t* expected = inline_bench->ppu.get_frame_buffer();
+    const uint8_t* actual = threaded_bench->ppu.get_frame_buffer();
+
+    for (size_t i = 0; i < FRAME_PIXELS; i++)
+        ASSERT_EQ(expected[i], actual[i]) << "pixel " << i;
+
+    /* Top-left tile is transparent (backdrop), the next one is solid color 1 of palette 0 */
+    ASSERT_EQ(expected[0], 0x01);
+    ASSERT_EQ(expected[8], 0x02);
+    /* Below line 120 the scroll moved by 39 pixels, so the same pattern appears shifted */
+    ASSERT_NE(memcmp(&expected[100 * FRAME_WIDTH], &expected[130 * FRAME_WIDTH], FRAME_WIDTH), 0);
+}
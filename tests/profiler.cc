@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "../src/profiler.h"
+#include "fixtures.h"
+
+TEST(Profiler, ChargesCyclesToRoutines)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    Profiler profiler(100);
+    load_program(*cpu, 0x0300, { 0x20, 0x00, 0x04, 0x4C, 0x00, 0x03 });   // JSR $0400, JMP $0300
+    load_program(*cpu, 0x0400, { 0xA2, 0xFF, 0xCA, 0xD0, 0xFD, 0x60 });   // LDX #$FF, DEX, BNE -3, RTS
+    cpu->set_pc(0x0300);
+    cpu->set_profiler(&profiler);
+    profiler.set_symbol(0x0400, "delay");
+
+    cpu->run(100000);
+    cpu->set_profiler(nullptr);
+
+    ASSERT_EQ(profiler.get_samples(), 1000u);
+    ASSERT_GT(profiler.get_self_cycles(0x0400), 95000u);
+    ASSERT_LE(profiler.get_depth(), 1u);
+
+    ostringstream folded;
+    profiler.write_folded(folded);
+    ASSERT_NE(folded.str().find("[reset];delay "), string::npos);
+    ASSERT_NE(folded.str().find("[reset] "), string::npos);
+}
+
+TEST(Profiler, MarksInterruptFrames)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    Profiler profiler(10);
+    load_program(*cpu, 0x0300, { 0x4C, 0x00, 0x03 });                      // JMP $0300
+    load_program(*cpu, 0x0500, { 0x20, 0x00, 0x06, 0x40 });                // JSR $0600, RTI
+    load_program(*cpu, 0x0600, { 0xA0, 0x40, 0x88, 0xD0, 0xFD, 0x60 });   // LDY #$40, DEY, BNE -3, RTS
+    cpu->set_mem8(NMI_VECTOR, 0x00);
+    cpu->set_mem8(NMI_VECTOR + 1, 0x05);
+    cpu->set_pc(0x0300);
+    cpu->set_profiler(&profiler);
+
+    cpu->nmi(cpu->get_cycles());
+    cpu->run(2000);
+
+    ASSERT_EQ(profiler.get_depth(), 0u);
+    ASSERT_GT(profiler.get_self_cycles(0x0600), 250u);
+
+    ostringstream folded;
+    profiler.write_folded(folded);
+    ASSERT_NE(folded.str().find("[reset];[NMI];$0500;$0600 "), string::npos);
+}
+
+TEST(Profiler, FollowsStackPointerThroughJumpTables)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    Profiler profiler(7);
+    load_program(*cpu, 0x0300, { 0x20, 0x80, 0x03, 0x4C, 0x00, 0x03 });   // JSR $0380, JMP $0300
+    load_program(*cpu, 0x0380, { 0x20, 0x00, 0x04 });                      // JSR $0400, never returns here
+    load_program(*cpu, 0x0400, { 0x68, 0x68, 0x4C, 0x80, 0x04 });         // PLA, PLA, JMP $0480
+    load_program(*cpu, 0x0480, { 0x60 });                                  // RTS, from $0380
+    cpu->set_pc(0x0300);
+    cpu->set_profiler(&profiler);
+
+    /* Every pass leaves an unbalanced JSR; a stack that trusted RTS would fill up */
+    cpu->run(10000);
+
+    ASSERT_LE(profiler.get_depth(), 2u);
+    ASSERT_GT(profiler.get_self_cycles(0x0400), 0u);
+}
@@ -10,3 +10,13 @@ TEST(ROM, HeaderTest)
     ASSERT_EQ(rom.get_flags6(), 0b00000001);
     ASSERT_EQ(rom.get_flags7(), 0b00000000);
 }
+
+TEST(ROM, LoadsPrgAndChr)
+{
+    ROM rom = ROM("rom/Super Mario Bros (E).nes");
+    ASSERT_TRUE(rom.is_valid());
+    ASSERT_EQ(rom.get_mapper(), 0);
+    ASSERT_TRUE(rom.has_vertical_mirroring());
+    ASSERT_EQ(rom.get_prg_rom().size(), 2u * 0x4000);
+    ASSERT_EQ(rom.get_chr_rom().size(), 1u * 0x2000);
+}
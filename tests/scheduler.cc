@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../src/scheduler.h"
+#include "../src/timeline.h"
+
+const uint64_t MS = 1000000;
+
+/* Stands in for an emulated frame: keeps a core busy for ns */
+static void spin(uint64_t ns)
+{
+    uint64_t end = Timeline::now() + ns;
+    while (Timeline::now() < end)
+        ;
+}
+
+TEST(SessionScheduler, RunsSessionsOncePerPeriod)
+{
+    SessionScheduler scheduler(1);
+    atomic<int> frames[3] = {};
+
+    for (int i = 0; i < 3; i++)
+        ASSERT_EQ(scheduler.add_session([&frames, i] { frames[i]++; spin(MS / 2); }, 10 * MS), i);
+
+    this_thread::sleep_for(chrono::milliseconds(205));
+    scheduler.remove_session(1);
+    int removed_at = frames[1];
+    this_thread::sleep_for(chrono::milliseconds(50));
+
+    /* Released at 0, 10, ..., 200 ms; the sandbox may be slow, so allow some frames to slip */
+    for (int i = 0; i < 3; i++) {
+        ASSERT_GE(frames[i], 15);
+        ASSERT_LE(frames[i], 27);
+    }
+    ASSERT_EQ(frames[1], removed_at);
+
+    HostedSessionStats session = scheduler.get_session_stats(0);
+    ASSERT_GE(session.cost_ns, MS / 2);
+    ASSERT_LT(session.cost_ns, 5 * MS);
+    ASSERT_EQ(scheduler.get_session_stats(1).frames, 0u);
+}
+
+TEST(SessionScheduler, AdmitsOnlyWhatFits)
+{
+    SessionScheduler scheduler(2, 0.8);
+
+    ASSERT_EQ(scheduler.add_session([] { spin(MS); }, 10 * MS, 6 * MS), 0);
+    ASSERT_EQ(scheduler.add_session([] { spin(MS); }, 10 * MS, 6 * MS), 1);
+    ASSERT_EQ(scheduler.add_session([] { spin(MS); }, 10 * MS, 6 * MS), -1);
+    ASSERT_NEAR(scheduler.get_utilization(), 0.6, 0.01);
+
+    /* Once measured, the sessions cost about 1 ms each, and new ones are assumed to cost as much */
+    this_thread::sleep_for(chrono::milliseconds(150));
+    ASSERT_LT(scheduler.get_utilization(), 0.4);
+    ASSERT_GE(scheduler.add_session([] { spin(MS); }, 10 * MS), 0);
+    ASSERT_EQ(scheduler.get_stats().rejected, 1u);
+}
+
+TEST(SessionScheduler, ReportsMissedDeadlines)
+{
+    SessionScheduler scheduler(1);
+
+    /* Takes 8 ms of a 5 ms period, admitted only because its cost was understated */
+    ASSERT_EQ(scheduler.add_session([] { spin(8 * MS); }, 5 * MS, MS), 0);
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    SchedulerStats stats = scheduler.get_stats();
+    ASSERT_GT(stats.frames, 5u);
+    ASSERT_EQ(stats.misses, stats.frames);
+    ASSERT_GT(stats.resyncs, 0u);
+    ASSERT_GE(stats.lateness_p50_ns, (int64_t) (3 * MS));
+    ASSERT_GE(stats.lateness_max_ns, stats.lateness_p99_ns);
+    ASSERT_GE(stats.lateness_p99_ns, stats.lateness_p50_ns);
+}
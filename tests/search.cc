@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/search.h"
+#include "../src/state_hash.h"
+#include "fixtures.h"
+
+TEST(StateHash, FollowsTheMachineNotTheInstance)
+{
+    unique_ptr<NES> nes = boot_smb();
+    for (size_t i = 0; i < 5; i++)
+        nes->run_frame();
+
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    nes->save_state(*snap);
+    uint64_t hash = nes->hash_state();
+
+    unique_ptr<NES> copy(new NES());
+    copy->copy_cartridge(*nes);
+    copy->load_state(*snap);
+    ASSERT_EQ(copy->hash_state(), hash);
+
+    /* Held buttons are the host's until the game latches them */
+    copy->get_controllers().set_buttons(0, BUTTON_A);
+    ASSERT_EQ(copy->hash_state(), hash);
+
+    copy->get_cpu().write8(0x0123, copy->get_cpu().read8(0x0123) ^ 1);
+    ASSERT_NE(copy->hash_state(), hash);
+    copy->get_cpu().write8(0x0123, copy->get_cpu().read8(0x0123) ^ 1);
+    ASSERT_EQ(copy->hash_state(), hash);
+
+    copy->get_ppu().write_register(PPUMASK, MASK_BG);
+    ASSERT_NE(copy->hash_state(), hash);
+}
+
+TEST(StateSet, InsertsEachHashOnceAcrossThreads)
+{
+    StateSet set(4000);
+    vector<thread> threads;
+    vector<size_t> inserted(4);
+
+    /* Every thread inserts the same 3000 hashes, 0 among them */
+    for (size_t t = 0; t < inserted.size(); t++) {
+        threads.emplace_back([&set, &inserted, t] {
+            for (uint64_t i = 0; i < 3000; i++)
+                inserted[t] += set.insert(i * HASH_PRIME1);
+        });
+    }
+    for (thread& th : threads)
+        th.join();
+
+    ASSERT_EQ(inserted[0] + inserted[1] + inserted[2] + inserted[3], 3000u);
+    ASSERT_EQ(set.size(), 3000u);
+    ASSERT_TRUE(set.contains(0));
+    ASSERT_FALSE(set.contains(3000 * HASH_PRIME1));
+}
+
+TEST(StateSearch, FindsAReplayablePath)
+{
+    unique_ptr<NES> nes = boot_smb();
+    uint64_t start_hash = nes->hash_state();
+
+    SearchConfig config;
+    config.inputs = { 0, BUTTON_START, BUTTON_A };
+    config.frames_per_step = 2;
+    config.depth = 3;
+    config.beam_width = 4;
+    config.threads = 1;
+
+    /* Score by a RAM byte that changes early, so the best state is not the start */
+    StateSearch search(*nes, config, [](NES& n) { return (double) n.get_cpu().get_cycles() + n.get_cpu().read8(0x0000); });
+    SearchResult result = search.run();
+
+    ASSERT_EQ(nes->hash_state(), start_hash);
+    ASSERT_EQ(result.depth, 3u);
+    ASSERT_EQ(result.inputs.size(), 3u);
+    ASSERT_EQ(result.explored, result.unique + result.duplicates);
+    ASSERT_GT(result.duplicates, 0u);   // Nothing reads the pads this early
+
+    /* Replaying the path on a fresh console lands on the same state */
+    unique_ptr<NES> replay = boot_smb();
+    for (uint8_t input : result.inputs) {
+        replay->get_controllers().set_buttons(0, input);
+        for (unsigned f = 0; f < config.frames_per_step; f++)
+            replay->emulate_frame(false, false);
+    }
+    ASSERT_EQ(replay->hash_state(), result.hash);
+}
+
+TEST(StateSearch, PathDoesNotDependOnThreads)
+{
+    /* Polls the pad forever and keeps only A, so every state is reached from every parent */
+    unique_ptr<NES> nes = boot_smb();
+    load_program(nes->get_cpu(), 0x0300, {
+        0xA9, 0x01, 0x8D, 0x16, 0x40,   // LDA #1, STA $4016
+        0xA9, 0x00, 0x8D, 0x16, 0x40,   // LDA #0, STA $4016
+        0xAD, 0x16, 0x40, 0x29, 0x01,   // LDA $4016, AND #1
+        0x85, 0x10, 0xA2, 0x07,         // STA $10, LDX #7
+        0xAD, 0x16, 0x40, 0xCA,         // LDA $4016, DEX
+        0xD0, 0xFA, 0x4C, 0x00, 0x03    // BNE -6, JMP $0300
+    });
+
+    SearchConfig config;
+    config.inputs = { 0, BUTTON_A, BUTTON_B, BUTTON_A | BUTTON_B };
+    config.frames_per_step = 1;
+    config.depth = 8;
+
+    auto score = [](NES& n) { return (double) n.get_cpu().get_cycles(); };
+    SearchResult single = StateSearch(*nes, config, score).run();
+    ASSERT_GT(single.duplicates, 0u);
+
+    config.threads = 3;
+    for (int run = 0; run < 20; run++) {
+        SearchResult result = StateSearch(*nes, config, score).run();
+        ASSERT_EQ(result.hash, single.hash);
+        ASSERT_EQ(result.inputs, single.inputs);
+        ASSERT_EQ(result.duplicates, single.duplicates);
+    }
+}
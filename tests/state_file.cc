@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "../src/state_file.h"
+#include "fixtures.h"
+
+TEST(StateFile, LoadsInPlaceAndCompressed)
+{
+    const char* plain = "/tmp/nes-state-file-test.nst";
+    const char* packed = "/tmp/nes-state-file-test.nsz";
+    unique_ptr<NES> nes = boot_smb(30);
+    unique_ptr<NES> other = boot_smb(0);
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    unique_ptr<NESSnapshot> loaded(new NESSnapshot());
+
+    nes->save_state(*snap);
+    uint64_t expected = nes->hash_state();
+    ASSERT_TRUE(write_state_file(plain, *snap));
+    ASSERT_TRUE(write_state_file(packed, *snap, COMPRESS_ALL));
+
+    StateFile file(plain);
+    ASSERT_TRUE(file.is_open());
+    ASSERT_TRUE(file.validate());
+    ASSERT_NE(file.get_snapshot(), nullptr);
+    other->load_state(*file.get_snapshot());
+    ASSERT_EQ(other->hash_state(), expected);
+
+    StateFile small(packed);
+    ASSERT_TRUE(small.is_open());
+    ASSERT_TRUE(small.validate());
+    ASSERT_EQ(small.get_snapshot(), nullptr);
+    ASSERT_LT(small.get_header().file_size, file.get_header().file_size / 4);
+    ASSERT_TRUE(small.read(*loaded));
+    other = boot_smb(0);
+    other->load_state(*loaded);
+    ASSERT_EQ(other->hash_state(), expected);
+
+    remove(plain);
+    remove(packed);
+}
+
+TEST(StateFile, RejectsDamagedFiles)
+{
+    const char* path = "/tmp/nes-state-file-damaged.nsz";
+    unique_ptr<NES> nes = boot_smb(10);
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    nes->save_state(*snap);
+    ASSERT_TRUE(write_state_file(path, *snap, COMPRESS_ALL));
+
+    vector<char> bytes;
+    {
+        ifstream in(path, ios::binary);
+        bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    const StateFileHeader* header = (const StateFileHeader*) bytes.data();
+    size_t ppu_at = header->sections[SECTION_PPU].offset;
+
+    /* A flipped byte inside a section opens, since nothing is parsed, but does not validate */
+    bytes[ppu_at + 1] ^= 0x01;
+    ofstream(path, ios::binary).write(bytes.data(), bytes.size());
+    StateFile flipped(path);
+    ASSERT_TRUE(flipped.is_open());
+    ASSERT_FALSE(flipped.validate());
+
+    /* Truncation and a layout from another version are caught on open */
+    ofstream(path, ios::binary).write(bytes.data(), bytes.size() - 1);
+    ASSERT_FALSE(StateFile(path).is_open());
+
+    bytes[ppu_at + 1] ^= 0x01;
+    ((StateFileHeader*) bytes.data())->version++;
+    ofstream(path, ios::binary).write(bytes.data(), bytes.size());
+    ASSERT_FALSE(StateFile(path).is_open());
+
+    remove(path);
+}
+
+TEST(StateFile, CollectsErrorsInsteadOfPrinting)
+{
+    const char* path = "/tmp/nes-state-file-errors.nst";
+    unique_ptr<NES> nes = boot_smb();
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    nes->save_state(*snap);
+    ASSERT_TRUE(write_state_file(path, *snap));
+
+    {
+        fstream f(path, ios::binary | ios::in | ios::out);
+        StateFileHeader header;
+        f.read((char*) &header, sizeof(header));
+        f.seekg(header.sections[SECTION_CPU].offset);
+        char byte = f.get();
+        f.seekp(header.sections[SECTION_CPU].offset);
+        f.put(byte ^ 0x01);
+    }
+
+    string missing_errors;
+    string damaged_errors;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(StateFile("/tmp/nes-state-file-missing.nst", &missing_errors).is_open());
+    StateFile damaged(path, &damaged_errors);
+    EXPECT_TRUE(damaged.is_open());
+    EXPECT_FALSE(damaged.validate());
+    ASSERT_EQ(testing::internal::GetCapturedStderr(), "");
+
+    ASSERT_NE(missing_errors.find("Could not open state file"), string::npos);
+    ASSERT_EQ(damaged_errors, "The cpu section does not match its hash.");
+    remove(path);
+}
+
+TEST(StateFile, ZeroRunCodecRoundTrips)
+{
+    vector<uint8_t> data(70000, 0);
+    for (size_t i = 0; i < data.size(); i += 97)
+        data[i] = i & 0xFF;
+    for (size_t i = 40000; i < 40400; i++)
+        data[i] = i * 7 + 1;
+    data[data.size() - 1] = 0x55;
+
+    vector<uint8_t> packed(compress_bound(data.size()));
+    size_t n = compress_zero_runs(data.data(), data.size(), packed.data(), packed.size());
+    ASSERT_GT(n, 0u);
+    ASSERT_LT(n, data.size() / 8);
+
+    vector<uint8_t> out(data.size());
+    ASSERT_TRUE(decompress_zero_runs(packed.data(), n, out.data(), out.size()));
+    ASSERT_EQ(out, data);
+    ASSERT_FALSE(decompress_zero_runs(packed.data(), n - 1, out.data(), out.size()));
+    ASSERT_EQ(compress_zero_runs(data.data(), data.size(), packed.data(), n - 1), 0u);
+}
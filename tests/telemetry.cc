@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "../src/nes.h"
+#include "../src/telemetry.h"
+#include "fixtures.h"
+
+TEST(Telemetry, PublishesFramesAndRam)
+{
+    unique_ptr<NES> nes = boot_smb();
+
+    Telemetry telemetry("test-frames", 4);
+    ASSERT_TRUE(telemetry.is_open());
+    nes->set_telemetry(&telemetry);
+    nes->set_run_ahead(1);
+
+    for (size_t i = 0; i < 10; i++)
+        nes->run_frame();
+
+    TelemetryReader reader("test-frames");
+    TelemetryData d;
+    ASSERT_TRUE(reader.read(d));
+
+    ASSERT_EQ(d.status, SESSION_RUNNING);
+    ASSERT_EQ(d.frames, 10u);
+    ASSERT_EQ(d.cycles, nes->get_cpu().get_cycles());
+    ASSERT_EQ(d.run_ahead_frames, 1u);
+    ASSERT_EQ(d.states_saved, 10u);
+    ASSERT_EQ(d.states_loaded, 10u);
+    ASSERT_GE(d.run_slices, 2 * 20u);
+    ASSERT_GT(d.emulated_mhz, 0.0);
+    ASSERT_LE(d.frame_ns_min, d.frame_ns_max);
+
+    uint64_t histogram = 0;
+    for (size_t i = 0; i < FRAME_TIME_BUCKETS; i++)
+        histogram += d.frame_time_hist[i];
+    ASSERT_EQ(histogram, 10u);
+
+    /* Copied on frame 8; the console has run two more since */
+    ASSERT_EQ(d.ram_frame, 8u);
+
+    telemetry.set_status(SESSION_PAUSED);
+    ASSERT_TRUE(reader.read(d));
+    ASSERT_EQ(d.status, SESSION_PAUSED);
+    nes->set_telemetry(nullptr);
+}
+
+TEST(Telemetry, RateStartsAtZeroAndSurvivesRewinds)
+{
+    unique_ptr<NES> nes = boot_smb(30);
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    Telemetry telemetry("test-rate");
+    TelemetryReader reader("test-rate");
+    TelemetryData d;
+    const uint64_t frame_ns = 20000000;
+
+    /* Attached to a console that has been running: the cycles since power-on are not one frame */
+    nes->save_state(*snap);
+    telemetry.publish(*nes, frame_ns);
+    ASSERT_TRUE(reader.read(d));
+    ASSERT_EQ(d.emulated_mhz, 0.0);
+
+    uint64_t before = nes->get_cpu().get_cycles();
+    nes->emulate_frame(false, false);
+    telemetry.publish(*nes, frame_ns);
+    ASSERT_TRUE(reader.read(d));
+    ASSERT_DOUBLE_EQ(d.emulated_mhz, (nes->get_cpu().get_cycles() - before) * 1000.0 / frame_ns);
+
+    nes->load_state(*snap);
+    telemetry.publish(*nes, frame_ns);
+    ASSERT_TRUE(reader.read(d));
+    ASSERT_EQ(d.emulated_mhz, 0.0);
+}
+
+TEST(Telemetry, ReaderNeverSeesTornWrites)
+{
+    unique_ptr<NES> nes(new NES());
+    Telemetry telemetry("test-torn", 1);
+    TelemetryReader reader("test-torn");
+    ASSERT_TRUE(reader.is_open());
+
+    /* Each publish fills RAM with one value and records it as the frame time */
+    atomic<bool> done(false);
+    thread writer([&]() {
+        for (uint64_t i = 1; i <= 20000; i++) {
+            memset(nes->get_cpu().get_ram(), i & 0xFF, RAM_SIZE);
+            telemetry.publish(*nes, i);
+        }
+        done = true;
+    });
+
+    TelemetryData d;
+    size_t reads = 0;
+    while (!done || reads == 0) {
+        ASSERT_TRUE(reader.read(d));
+        ASSERT_EQ(d.frame_ns_last, d.frames);
+        ASSERT_EQ(d.ram[0], d.frames & 0xFF);
+        ASSERT_EQ(d.ram[RAM_SIZE - 1], d.frames & 0xFF);
+        reads++;
+    }
+
+    writer.join();
+}
+
+TEST(Telemetry, MissingSegmentDoesNotOpen)
+{
+    TelemetryReader reader("test-missing");
+    TelemetryData d;
+    ASSERT_FALSE(reader.is_open());
+    ASSERT_FALSE(reader.read(d));
+}
@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "../src/thread_pool.h"
+
+TEST(ThreadPool, RunsEveryItemOnce)
+{
+    ThreadPool pool(3);
+    vector<atomic<int>> hits(1000);
+
+    for (int round = 0; round < 10; round++)
+        pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+
+    for (atomic<int>& hit : hits)
+        ASSERT_EQ(hit.load(), 10);
+}
+
+TEST(ThreadPool, InlineWithoutWorkers)
+{
+    ThreadPool pool(0);
+    size_t sum = 0;
+    pool.parallel_for(100, [&](size_t i) { sum += i; });
+    ASSERT_EQ(sum, 4950u);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "../src/nes.h"
+#include "fixtures.h"
+
+static size_t count_of(const string& text, const string& what)
+{
+    size_t count = 0;
+
+    for (size_t at = text.find(what); at != string::npos; at = text.find(what, at + 1))
+        count++;
+
+    return count;
+}
+
+TEST(Timeline, KeepsOneBufferPerThread)
+{
+    Timeline timeline(4);
+    timeline.name_thread("main");
+    timeline.instant("a", "test", 100);
+
+    thread other([&timeline]() {
+        timeline.name_thread("worker");
+        for (size_t i = 0; i < 6; i++)
+            timeline.span("b", "test", Timeline::now(), NO_CYCLE, NO_CYCLE);
+    });
+    other.join();
+
+    ASSERT_EQ(timeline.get_event_count(), 5u);
+    ASSERT_EQ(timeline.get_dropped(), 2u);
+
+    ostringstream json;
+    timeline.write_json(json);
+    ASSERT_EQ(count_of(json.str(), "\"name\":\"main\""), 2u);
+    ASSERT_EQ(count_of(json.str(), "\"name\":\"worker\""), 2u);
+    ASSERT_EQ(count_of(json.str(), "\"name\":\"a\""), 2u);       // Host and emulated clocks
+    ASSERT_EQ(count_of(json.str(), "\"name\":\"b\""), 4u);       // Host clock only
+    ASSERT_NE(json.str().find("\"ph\":\"i\",\"pid\":2,\"tid\":1,\"ts\":55.873"), string::npos);
+    ASSERT_EQ(json.str().substr(json.str().size() - 4), "\n]}\n");
+}
+
+TEST(Timeline, RecordsEmulatorEvents)
+{
+    unique_ptr<NES> nes = boot_smb();
+
+    Timeline timeline;
+    nes->set_timeline(&timeline);
+    for (size_t i = 0; i < 10; i++)
+        nes->run_frame();
+
+    thread presenter([&nes]() {
+        nes->get_output().acquire_frame();
+        nes->get_output().acquire_frame();
+    });
+    presenter.join();
+    nes->set_timeline(nullptr);
+    nes->run_frame();
+
+    ostringstream json;
+    timeline.write_json(json);
+    const string& text = json.str();
+    ASSERT_EQ(count_of(text, "\"name\":\"frame\""), 2 * 10u);
+    ASSERT_EQ(count_of(text, "\"name\":\"publish\""), 10u);
+    ASSERT_EQ(count_of(text, "\"name\":\"present\""), 1u);
+    ASSERT_EQ(count_of(text, "\"name\":\"present.duplicate\""), 1u);
+    ASSERT_GT(count_of(text, "\"name\":\"cpu.run\""), 2 * 10u);
+    ASSERT_GT(count_of(text, "\"name\":\"nmi\""), 0u);
+    ASSERT_GT(count_of(text, "\"name\":\"oam_dma\""), 0u);
+    ASSERT_GT(count_of(text, "\"name\":\"apu.sync\""), 0u);
+}
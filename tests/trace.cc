@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/cpu.h"
+
+TEST(Tracer, FormatsNestestLines)
+{
+    char line[TRACE_LINE_SIZE];
+
+    Tracer::format_line({ 7, 0xC000, 0x4C, { 0xF5, 0xC5 }, 0x00, 0x00, 0x00, 0x24, 0xFD }, line, sizeof(line));
+    ASSERT_STREQ(line, "C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7\n");
+
+    Tracer::format_line({ 10, 0xC5F5, 0xA2, { 0x00, 0x86 }, 0x00, 0x00, 0x00, 0x24, 0xFD }, line, sizeof(line));
+    ASSERT_STREQ(line, "C5F5  A2 00     LDX #$00                        A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 30 CYC:10\n");
+
+    Tracer::format_line({ 26, 0xC72D, 0xEA, { 0x00, 0x00 }, 0x00, 0x00, 0x00, 0x24, 0xFB }, line, sizeof(line));
+    ASSERT_STREQ(line, "C72D  EA        NOP                             A:00 X:00 Y:00 P:24 SP:FB PPU:  0, 78 CYC:26\n");
+}
+
+static void run_traced(Tracer& tracer)
+{
+    unique_ptr<CPU> cpu(new CPU());
+    const vector<uint8_t> program = {
+        0xA2, 0x03,         // LDX #3
+        0xCA,               // DEX
+        0xD0, 0xFD,         // BNE -3
+        0xEA                // NOP
+    };
+
+    for (size_t i = 0; i < program.size(); i++)
+        cpu->set_mem8(0x0300 + i, program[i]);
+    cpu->set_pc(0x0300);
+    cpu->set_tracer(&tracer);
+
+    /* LDX, three DEX/BNE pairs, NOP */
+    cpu->run(2 + 3 * 2 + 2 * 3 + 2 + 2);
+    tracer.close();
+}
+
+TEST(Tracer, WritesTextTrace)
+{
+    const char* path = "/tmp/nes-trace-test.log";
+    Tracer tracer(path, TRACE_TEXT, true);
+    ASSERT_TRUE(tracer.is_open());
+    run_traced(tracer);
+
+    ifstream in(path);
+    vector<string> lines;
+    for (string line; getline(in, line); )
+        lines.push_back(line);
+
+    ASSERT_EQ(lines.size(), 8u);
+    ASSERT_EQ(tracer.get_written(), 8u);
+    ASSERT_EQ(tracer.get_dropped(), 0u);
+    ASSERT_EQ(lines[0].substr(0, 24), "0300  A2 03     LDX #$03");
+    ASSERT_EQ(lines[2].substr(0, 25), "0303  D0 FD     BNE $0302");
+    ASSERT_EQ(lines[7].substr(0, 20), "0305  EA        NOP ");
+    remove(path);
+}
+
+TEST(Tracer, WritesRawTrace)
+{
+    const char* path = "/tmp/nes-trace-test.bin";
+    Tracer tracer(path, TRACE_RAW, true);
+    run_traced(tracer);
+
+    ifstream in(path, ios::binary);
+    TraceFileHeader header;
+    in.read((char*) &header, sizeof(header));
+    ASSERT_EQ(string(header.magic, sizeof(header.magic)), string(TRACE_MAGIC, sizeof(TRACE_MAGIC)));
+    ASSERT_EQ(header.record_size, sizeof(TraceRecord));
+
+    vector<TraceRecord> records(8);
+    in.read((char*) records.data(), records.size() * sizeof(TraceRecord));
+    ASSERT_TRUE(in.good());
+    ASSERT_EQ(in.peek(), EOF);
+
+    ASSERT_EQ(records[1].pc, 0x0302);
+    ASSERT_EQ(records[1].x, 3);
+    ASSERT_EQ(records[1].cycle, 2u);
+    ASSERT_EQ(records[7].opcode, 0xEA);
+    remove(path);
+}
+
+TEST(Tracer, LosslessWithoutWriterDrops)
+{
+    Tracer tracer("/nonexistent/nes-trace-test.log", TRACE_TEXT, true);
+    ASSERT_FALSE(tracer.is_open());
+
+    unique_ptr<CPU> cpu(new CPU());
+    cpu->set_mem8(0x0300, 0x4C);    // JMP $0300
+    cpu->set_mem8(0x0301, 0x00);
+    cpu->set_mem8(0x0302, 0x03);
+    cpu->set_pc(0x0300);
+    cpu->set_tracer(&tracer);
+
+    /* Twice the ring's worth of instructions: without a writer this used to spin forever */
+    cpu->run(2 * TRACE_RING_SIZE * 3);
+
+    ASSERT_GE(tracer.get_dropped(), TRACE_RING_SIZE - 1);
+    ASSERT_EQ(tracer.get_written(), 0u);
+}
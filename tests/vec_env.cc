@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "../src/vec_env.h"
+#include "fixtures.h"
+
+TEST(VecEnv, RendersStraightIntoTheBatch)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    VecEnvConfig config;
+    config.frame_skip = 2;
+    config.start_frames = 30;
+    config.threads = 1;
+    VecEnv env(rom, 3, config);
+
+    vector<uint8_t> obs(3 * ENV_OBSERVATION_SIZE, 0xFF);
+    vector<uint8_t> ram(3 * ENV_RAM_SIZE);
+    vector<uint8_t> dones(3, 1);
+    env.reset(obs.data(), ram.data());
+    ASSERT_EQ(memcmp(&obs[ENV_OBSERVATION_SIZE], env.get_start_observation(), ENV_OBSERVATION_SIZE), 0);
+
+    const uint8_t actions[3] = { 0, 0, BUTTON_START };
+    for (int i = 0; i < 10; i++)
+        env.step(actions, obs.data(), ram.data(), dones.data());
+
+    /* Same actions, same results; the rendered frame is the one the PPU kept */
+    ASSERT_EQ(memcmp(&obs[0], &obs[ENV_OBSERVATION_SIZE], ENV_OBSERVATION_SIZE), 0);
+    ASSERT_EQ(memcmp(&ram[0], &ram[ENV_RAM_SIZE], ENV_RAM_SIZE), 0);
+    ASSERT_EQ(env.get_env(1).get_ppu().get_frame_buffer(), &obs[ENV_OBSERVATION_SIZE]);
+    ASSERT_EQ(memcmp(&ram[ENV_RAM_SIZE], env.get_ram_view(1), ENV_RAM_SIZE), 0);
+    ASSERT_EQ(dones, vector<uint8_t>(3, 0));
+    ASSERT_EQ(env.get_env(2).get_controllers().get_buttons(0), BUTTON_START);
+}
+
+TEST(VecEnv, ResetsWhenEpisodesEnd)
+{
+    ROM rom = ROM(SMB_ROM_PATH);
+    VecEnvConfig config;
+    config.frame_skip = 1;
+    config.max_episode_frames = 3;
+    VecEnv env(rom, 2, config);
+
+    vector<uint8_t> ram(2 * ENV_RAM_SIZE);
+    vector<uint8_t> first(2 * ENV_RAM_SIZE);
+    uint8_t actions[2] = { 0, 0 };
+    uint8_t dones[2];
+
+    env.step(actions, nullptr, first.data(), dones);
+    ASSERT_EQ(dones[0], 0);
+    env.step(actions, nullptr, ram.data(), dones);
+    env.step(actions, nullptr, ram.data(), dones);
+    ASSERT_EQ(dones[0], 1);
+    ASSERT_EQ(dones[1], 1);
+
+    /* The episode after the reset plays out like the first */
+    env.step(actions, nullptr, ram.data(), dones);
+    ASSERT_EQ(dones[0], 0);
+    ASSERT_EQ(ram, first);
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "../src/video.h"
+
+static vector<uint8_t> make_frame()
+{
+    vector<uint8_t> frame(FRAME_PIXELS);
+
+    for (size_t i = 0; i < FRAME_PIXELS; i++)
+        frame[i] = (i * 7 + i / FRAME_WIDTH) & 0xFF; // Upper bits must be masked off
+
+    return frame;
+}
+
+TEST(Video, ConvertRGBA)
+{
+    vector<uint8_t> frame = make_frame();
+    VideoConverter converter(1, FILTER_NONE, 0);
+    vector<uint32_t> out(converter.get_width() * converter.get_height());
+    converter.convert(frame.data(), out.data());
+
+    for (size_t i = 0; i < FRAME_PIXELS; i++)
+        ASSERT_EQ(out[i], NES_PALETTE[frame[i] & PALETTE_INDEX_MASK]);
+}
+
+TEST(Video, ConvertRGBA2x)
+{
+    vector<uint8_t> frame = make_frame();
+    VideoConverter converter(2, FILTER_NONE, 0);
+    ASSERT_EQ(converter.get_width(), FRAME_WIDTH * 2);
+    ASSERT_EQ(converter.get_height(), FRAME_HEIGHT * 2);
+    vector<uint32_t> out(converter.get_width() * converter.get_height());
+    converter.convert(frame.data(), out.data());
+
+    for (size_t y = 0; y < converter.get_height(); y++) {
+        for (size_t x = 0; x < converter.get_width(); x++) {
+            uint8_t index = frame[(y / 2) * FRAME_WIDTH + x / 2] & PALETTE_INDEX_MASK;
+            ASSERT_EQ(out[y * converter.get_width() + x], NES_PALETTE[index]);
+        }
+    }
+}
+
+TEST(Video, NTSCThreadedMatchesInline)
+{
+    vector<uint8_t> frame = make_frame();
+    VideoConverter inline_converter(2, FILTER_NTSC, 0);
+    VideoConverter threaded_converter(2, FILTER_NTSC, 3);
+    vector<uint32_t> expected(inline_converter.get_width() * inline_converter.get_height());
+    vector<uint32_t> actual(expected.size());
+    inline_converter.convert(frame.data(), expected.data(), 4);
+    threaded_converter.convert(frame.data(), actual.data(), 4);
+    ASSERT_EQ(expected, actual);
+}
+
+TEST(Video, NTSCGreyStaysGrey)
+{
+    vector<uint8_t> frame(FRAME_PIXELS, 0x10);
+    VideoConverter converter(1, FILTER_NTSC, 0);
+    vector<uint32_t> out(FRAME_PIXELS);
+    converter.convert(frame.data(), out.data());
+    uint32_t px = out[120 * FRAME_WIDTH + 128];
+    int r = px & 0xFF, g = (px >> 8) & 0xFF, b = (px >> 16) & 0xFF;
+    ASSERT_LE(abs(r - g), 2);
+    ASSERT_LE(abs(g - b), 2);
+    ASSERT_GT(r, 0x40);
+}
+
+TEST(Video, PostProcessorDeliversFrames)
+{
+    vector<uint8_t> frame = make_frame();
+    vector<uint32_t> received;
+    uint64_t last_frame = ~0ULL;
+    PostProcessor post(1, FILTER_NONE, 0, [&](const uint32_t* pixels, size_t width, size_t height, uint64_t n) {
+        received.assign(pixels, pixels + width * height);
+        last_frame = n;
+    });
+
+    post.submit(frame.data());
+    post.flush();
+    ASSERT_EQ(post.get_converted() + post.get_dropped(), post.get_submitted());
+    ASSERT_EQ(last_frame, 0ULL);
+    ASSERT_EQ(received.size(), FRAME_PIXELS);
+    ASSERT_EQ(received[1000], NES_PALETTE[frame[1000] & PALETTE_INDEX_MASK]);
+}
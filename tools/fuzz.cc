@@ -0,0 +1,176 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/fuzz.h"
+
+/*
+ * nes-fuzz [-r rom] [-f frames] [-n runs] [-s seed] [files...]: fuzzes the CPU with code, or with
+ * -r the cartridge's controller input from frames frames after power-on, in one process. Files are
+ * replayed once each. Without files, inputs that reach new edges are kept and mutated for runs
+ * runs, and execs/s and coverage are reported.
+ *
+ * Built with -DNES_LIBFUZZER -fsanitize=fuzzer (clang) this is a libFuzzer target instead, with
+ * the coverage map among libFuzzer's extra counters; NES_FUZZ_ROM picks the controller target.
+ */
+
+#ifdef NES_LIBFUZZER
+__attribute__((section("__libfuzzer_extra_counters")))
+#endif
+static uint8_t coverage[COVERAGE_MAP_SIZE];
+
+static unique_ptr<ROM> rom;
+static unique_ptr<FuzzHarness> harness;
+
+static void create_harness(const char* rom_path, unsigned start_frames)
+{
+    if (!rom_path) {
+        harness.reset(new FuzzHarness(coverage));
+        return;
+    }
+
+    rom.reset(new ROM(rom_path));
+    harness.reset(new FuzzHarness(*rom, start_frames, coverage));
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    harness->run(data, size);
+    return 0;
+}
+
+#ifdef NES_LIBFUZZER
+
+extern "C" int LLVMFuzzerInitialize(__attribute__((unused)) int* argc, __attribute__((unused)) char*** argv)
+{
+    create_harness(getenv("NES_FUZZ_ROM"), 30);
+    return 0;
+}
+
+#else
+
+static vector<uint8_t> mutate(const vector<uint8_t>& input, size_t max_size, mt19937& rng)
+{
+    vector<uint8_t> out = input;
+    unsigned ops = 1 + rng() % 4;
+
+    for (unsigned i = 0; i < ops; i++) {
+        size_t at = out.empty() ? 0 : rng() % out.size();
+
+        switch (rng() % 4) {
+            case 0:
+                if (!out.empty())
+                    out[at] ^= 1 << (rng() % 8);
+                break;
+            case 1:
+                if (!out.empty())
+                    out[at] = rng();
+                break;
+            case 2:
+                if (out.size() < max_size)
+                    out.insert(out.begin() + at, (uint8_t) rng());
+                break;
+            default:
+                if (!out.empty())
+                    out.erase(out.begin() + at);
+                break;
+        }
+    }
+
+    return out;
+}
+
+/* Adds this run's edges to seen, returning how many it had not seen before */
+static size_t merge_coverage(vector<uint8_t>& seen)
+{
+    size_t fresh = 0;
+
+    for (size_t i = 0; i < COVERAGE_MAP_SIZE; i++) {
+        if (coverage[i] && !seen[i]) {
+            seen[i] = 1;
+            fresh++;
+        }
+    }
+
+    return fresh;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rom_path = nullptr;
+    unsigned start_frames = 30;
+    uint64_t runs = 100000;
+    unsigned seed = 1;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rom_path = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+            start_frames = stoul(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            runs = stoull(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = stoul(argv[++i]);
+        else if (argv[i][0] == '-') {
+            cerr << "Usage: " << argv[0] << " [-r rom] [-f frames] [-n runs] [-s seed] [files...]\n";
+            return 2;
+        } else
+            files.push_back(argv[i]);
+    }
+
+    create_harness(rom_path, start_frames);
+
+    for (const string& path : files) {
+        ifstream in(path, ios::binary);
+        if (!in) {
+            cerr << "ERROR: Cannot open " << path << ".\n";
+            return 1;
+        }
+
+        vector<uint8_t> input((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        cout << path << ": " << input.size() << " bytes, " << harness->get_dirty_count() << " pages written\n";
+    }
+
+    if (!files.empty())
+        return 0;
+
+    size_t max_size = rom_path ? FUZZ_MAX_FRAMES : FUZZ_MAX_CODE;
+    vector<vector<uint8_t>> corpus(1);
+    vector<uint8_t> seen(COVERAGE_MAP_SIZE);
+    size_t edges = 0;
+    mt19937 rng(seed);
+    auto start = chrono::steady_clock::now();
+
+    for (uint64_t run = 0; run < runs; run++) {
+        vector<uint8_t> input = mutate(corpus[rng() % corpus.size()], max_size, rng);
+
+        memset(coverage, 0, sizeof(coverage));
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+
+        size_t fresh = merge_coverage(seen);
+        if (fresh) {
+            edges += fresh;
+            corpus.push_back(input);
+        }
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    const FuzzStats& stats = harness->get_stats();
+
+    cout << "execs " << stats.execs << "  execs/s " << (uint64_t) (stats.execs / seconds) << "  edges " << edges
+         << "  corpus " << corpus.size() << "  pages restored/exec "
+         << (stats.execs ? (double) stats.pages_restored / stats.execs : 0.0) << "\n";
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/state_file.h"
+#include "../src/thread_pool.h"
+
+/*
+ * nes-state [-j threads] files...: validates state files, in parallel.
+ * nes-state [-j threads] [-z] -o dir files...: validates them and converts them into dir,
+ * compressed with -z and uncompressed, for use in place, without.
+ * nes-state -r rom [-f frames] [-z] -o file: writes the state frames frames after power-on.
+ */
+
+static bool save_from_rom(const string& rom_path, unsigned frames, const string& out, unsigned compress)
+{
+    ROM rom = ROM(rom_path);
+    unique_ptr<NES> nes(new NES());
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+
+    if (!nes->load(rom))
+        return false;
+
+    for (unsigned i = 0; i < frames; i++)
+        nes->emulate_frame(false, false);
+
+    nes->save_state(*snap);
+    return write_state_file(out, *snap, compress);
+}
+
+static string describe(StateFile& file)
+{
+    const StateFileHeader& h = file.get_header();
+    ostringstream s;
+
+    s << h.file_size << " bytes,";
+    for (size_t i = 0; i < NUM_STATE_SECTIONS; i++) {
+        const StateSection& section = h.sections[i];
+        s << " " << STATE_SECTION_NAMES[i] << " " << section.stored_size;
+        if (section.flags & SECTION_COMPRESSED)
+            s << "/" << section.size;
+    }
+
+    return s.str();
+}
+
+/* Fills report with one line about path, errors included; false if the file is damaged or could not be written */
+static bool process(const string& path, const string& out_dir, unsigned compress, string& report)
+{
+    string errors;
+    StateFile file(path, &errors);
+
+    if (!file.is_open() || !file.validate()) {
+        report = path + ": invalid" + (errors.empty() ? "" : ", " + errors);
+        return false;
+    }
+
+    report = path + ": ok, " + describe(file);
+    if (out_dir.empty())
+        return true;
+
+    unique_ptr<NESSnapshot> snap(new NESSnapshot());
+    size_t slash = path.find_last_of('/');
+    string out = out_dir + "/" + (slash == string::npos ? path : path.substr(slash + 1));
+
+    if (!file.read(*snap) || !write_state_file(out, *snap, compress, &errors)) {
+        report += " -> " + out + ": failed" + (errors.empty() ? "" : ", " + errors);
+        return false;
+    }
+
+    report += " -> " + out;
+    return true;
+}
+
+static int usage(const char* name)
+{
+    cerr << "Usage: " << name << " [-j threads] [-z] [-o dir] files...\n"
+         << "       " << name << " -r rom [-f frames] [-z] -o file\n";
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    string rom_path;
+    string out;
+    unsigned frames = 0;
+    unsigned compress = COMPRESS_NONE;
+    size_t threads = thread::hardware_concurrency() ? thread::hardware_concurrency() - 1 : 0;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rom_path = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+            frames = stoul(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            out = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threads = stoul(argv[++i]);
+        else if (strcmp(argv[i], "-z") == 0)
+            compress = COMPRESS_ALL;
+        else if (argv[i][0] == '-')
+            return usage(argv[0]);
+        else
+            files.push_back(argv[i]);
+    }
+
+    if (!rom_path.empty() && !out.empty())
+        return save_from_rom(rom_path, frames, out, compress) ? 0 : 1;
+
+    if (files.empty())
+        return usage(argv[0]);
+
+    /* Workers print nothing, errors go into their reports, which are printed in order at the end */
+    ThreadPool pool(threads);
+    vector<string> reports(files.size());
+    vector<uint8_t> ok(files.size());
+
+    pool.parallel_for(files.size(), [&](size_t i) {
+        ok[i] = process(files[i], out, compress, reports[i]);
+    });
+
+    size_t failed = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        cout << reports[i] << "\n";
+        failed += !ok[i];
+    }
+
+    if (failed)
+        cerr << "ERROR: " << failed << " of " << files.size() << " state files failed.\n";
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../src/telemetry.h"
+
+/*
+ * nes-telemetry <name> [-r] [-w seconds]: prints what the emulator publishing as name reports.
+ * -r adds a hex dump of the last RAM copy, -w keeps printing every so many seconds.
+ */
+
+static void print_ram(const TelemetryData& d)
+{
+    cout << "ram (frame " << d.ram_frame << "):\n" << hex << setfill('0');
+
+    for (size_t row = 0; row < RAM_SIZE; row += 32) {
+        cout << setw(4) << row << ":";
+        for (size_t i = row; i < row + 32; i++)
+            cout << " " << setw(2) << unsigned(d.ram[i]);
+        cout << "\n";
+    }
+
+    cout << dec << setfill(' ');
+}
+
+static void print(const TelemetryData& d, bool ram)
+{
+    double mean_us = d.frames ? d.frame_ns_total / 1000.0 / d.frames : 0.0;
+
+    cout << fixed << setprecision(2)
+         << "pid " << d.pid << "  " << SESSION_STATUS_NAMES[d.status] << "  run-ahead " << d.run_ahead_frames << "\n"
+         << "frames " << d.frames << "  cycles " << d.cycles << "  emulated " << d.emulated_mhz << " MHz\n"
+         << "frame time us: last " << d.frame_ns_last / 1000.0 << "  mean " << mean_us
+         << "  min " << (d.frames ? d.frame_ns_min / 1000.0 : 0.0) << "  max " << d.frame_ns_max / 1000.0 << "\n";
+
+    for (size_t i = 0; i < FRAME_TIME_BUCKETS; i++) {
+        if (d.frame_time_hist[i]) {
+            cout << "  >= " << setw(8) << (1ull << i) << " us  " << setw(10) << d.frame_time_hist[i] << "  "
+                 << string(d.frame_time_hist[i] * 40 / d.frames, '#') << "\n";
+        }
+    }
+
+    cout << "syncs: cpu slices " << d.run_slices << "  apu " << d.apu_syncs << "  oam dma " << d.oam_dmas << "\n"
+         << "snapshots: saved " << d.states_saved << " ("
+         << (d.states_saved ? d.save_ns / 1000.0 / d.states_saved : 0.0) << " us each)  loaded " << d.states_loaded
+         << " (" << (d.states_loaded ? d.load_ns / 1000.0 / d.states_loaded : 0.0) << " us each)\n";
+
+    if (ram && d.ram_frame)
+        print_ram(d);
+}
+
+int main(int argc, char** argv)
+{
+    string name;
+    bool ram = false;
+    unsigned watch = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0)
+            ram = true;
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            watch = stoul(argv[++i]);
+        else
+            name = argv[i];
+    }
+
+    if (name.empty()) {
+        cerr << "Usage: " << argv[0] << " <name> [-r] [-w seconds]\n";
+        return 2;
+    }
+
+    TelemetryReader reader(name);
+    TelemetryData data;
+
+    do {
+        if (!reader.read(data))
+            return 1;
+
+        print(data, ram);
+
+        if (watch) {
+            cout << "\n";
+            this_thread::sleep_for(chrono::seconds(watch));
+        }
+    } while (watch && data.status != SESSION_STOPPED);
+
+    return 0;
+}